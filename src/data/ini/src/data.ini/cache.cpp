@@ -0,0 +1,391 @@
+#include "ini.h"
+#include "hash.h"
+
+#include <atomic>
+#include <ctime>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			/*
+			* 缓存文件格式（本机字节序，只在同一台机器上复用）：
+			* magic | 源文件大小 | 源文件修改时间 | 源文件内容哈希 | 缓存写入时间 | 解析返回值 | 源文件路径 | 数据长度 | 数据哈希 | 数据
+			*/
+
+			static const char CACHE_MAGIC[8] = { 'T', 'F', 'C', 'I', 'N', 'I', 'C', '4' };
+
+
+			struct INICacheHeader
+			{
+				uint64_t size;
+				int64_t mtime;         // 纳秒
+				uint64_t contentHash;
+				int64_t writtenAt;     // 秒
+				int32_t errorValue;
+				std::string path;
+				size_t payloadOffset;
+				uint64_t payloadSize;
+				uint64_t payloadHash;
+			};
+
+
+			static bool statFile(const std::string& filePath, uint64_t& size, int64_t& mtime)
+			{
+#ifdef _WIN32
+				WIN32_FILE_ATTRIBUTE_DATA attr;
+				if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &attr))
+				{
+					return false;
+				}
+				size = (static_cast<uint64_t>(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+
+				// FILETIME 以 100 纳秒为单位，从 1601 年起算
+				uint64_t ticks = (static_cast<uint64_t>(attr.ftLastWriteTime.dwHighDateTime) << 32) | attr.ftLastWriteTime.dwLowDateTime;
+				mtime = static_cast<int64_t>(ticks - 116444736000000000ULL) * 100;
+#else
+				struct stat st;
+				if (stat(filePath.c_str(), &st) != 0)
+				{
+					return false;
+				}
+				size = static_cast<uint64_t>(st.st_size);
+				mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+				return true;
+			}
+
+
+			static void appendU32(std::string& out, uint32_t value)
+			{
+				out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+
+			static void appendU64(std::string& out, uint64_t value)
+			{
+				out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+
+			static void appendString(std::string& out, const std::string& value)
+			{
+				appendU32(out, static_cast<uint32_t>(value.size()));
+				out.append(value);
+			}
+
+
+			// 带边界检查的顺序读取器，缓存文件损坏时只会返回 false
+			struct INICacheReader
+			{
+				const char* data;
+				size_t size;
+				size_t pos;
+
+				template <typename T>
+				bool read(T& value)
+				{
+					if (size - pos < sizeof(T))
+					{
+						return false;
+					}
+					memcpy(&value, data + pos, sizeof(T));
+					pos += sizeof(T);
+					return true;
+				}
+
+				bool readString(std::string& value)
+				{
+					uint32_t len;
+					if (!read(len) || size - pos < len)
+					{
+						return false;
+					}
+					value.assign(data + pos, len);
+					pos += len;
+					return true;
+				}
+			};
+
+
+			static bool parseHeader(const std::string& cache, INICacheHeader& header)
+			{
+				INICacheReader reader = { cache.data(), cache.size(), 0 };
+
+				if (cache.size() < sizeof(CACHE_MAGIC) || memcmp(cache.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+				{
+					return false;
+				}
+				reader.pos = sizeof(CACHE_MAGIC);
+
+				if (!reader.read(header.size) || !reader.read(header.mtime) || !reader.read(header.contentHash)
+					|| !reader.read(header.writtenAt) || !reader.read(header.errorValue) || !reader.readString(header.path)
+					|| !reader.read(header.payloadSize) || !reader.read(header.payloadHash))
+				{
+					return false;
+				}
+
+				header.payloadOffset = reader.pos;
+				return cache.size() - header.payloadOffset == header.payloadSize;
+			}
+
+
+			static std::string cacheFileName(const std::string& cacheDir, const std::string& filePath)
+			{
+				char name[32] = { 0 };
+				snprintf(name, sizeof(name), "%016llx.inic", static_cast<unsigned long long>(hashBytes(filePath.data(), filePath.size())));
+
+				if (cacheDir == "" || cacheDir[cacheDir.length() - 1] == '/' || cacheDir[cacheDir.length() - 1] == '\\')
+				{
+					return cacheDir + name;
+				}
+				return cacheDir + "/" + name;
+			}
+
+
+			static void writeCache(const std::string& cachePath, const std::string& filePath, uint64_t size, int64_t mtime, uint64_t contentHash, int errorValue, const std::string& payload)
+			{
+				std::string data(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+				appendU64(data, size);
+				appendU64(data, static_cast<uint64_t>(mtime));
+				appendU64(data, contentHash);
+				appendU64(data, static_cast<uint64_t>(time(NULL)));
+				appendU32(data, static_cast<uint32_t>(errorValue));
+				appendString(data, filePath);
+				appendU64(data, payload.size());
+				appendU64(data, hashBytes(payload.data(), payload.size()));
+				data += payload;
+
+				// 先写临时文件再改名，其他进程不会读到写了一半的缓存。
+				// 临时文件名带上进程号和进程内的序号，多个进程或线程同时写同一份缓存时各写各的
+				static std::atomic<uint32_t> tempCounter(0);
+#ifdef _WIN32
+				unsigned long pid = GetCurrentProcessId();
+#else
+				unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+				std::string tempPath = cachePath + "." + std::to_string(pid) + "." + std::to_string(tempCounter++) + ".tmp";
+				std::ofstream ofs(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+				if (!ofs.is_open())
+				{
+					return;
+				}
+				ofs.write(data.data(), data.size());
+				ofs.close();
+				if (!ofs)
+				{
+					std::remove(tempPath.c_str());
+					return;
+				}
+
+#ifdef _WIN32
+				std::remove(cachePath.c_str());
+#endif
+				if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+				{
+					std::remove(tempPath.c_str());
+				}
+			}
+
+
+			std::string INIFile::serializeCache()
+			{
+				std::string payload;
+
+				appendU32(payload, static_cast<uint32_t>(encoding));
+				appendU32(payload, multilineEnabled ? 1 : 0);
+				appendU32(payload, static_cast<uint32_t>(sectionsCache.size() - removedSections));
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					if (sect->removed)
+					{
+						continue;
+					}
+
+					appendString(payload, sect->getName());
+					appendString(payload, sect->getComment());
+					appendString(payload, sect->getRightComment());
+					appendU32(payload, static_cast<uint32_t>(sect->line));
+					appendU32(payload, static_cast<uint32_t>(sect->length()));
+					appendU32(payload, sect->valueLayouts.empty() ? 0 : 1);
+
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
+					{
+						appendString(payload, item->key);
+						appendString(payload, item->value);
+						appendString(payload, item->comment);
+						appendString(payload, item->rightComment);
+						appendU32(payload, static_cast<uint32_t>(item->line));
+
+						const INIValueLayout* layout = sect->valueLayout(item);
+						if (layout != NULL)
+						{
+							appendString(payload, layout->indent);
+							appendU32(payload, static_cast<uint32_t>(layout->breaks.size()));
+							for (auto it = layout->breaks.begin(); it != layout->breaks.end(); ++it)
+							{
+								appendU64(payload, *it);
+							}
+						}
+					}
+				}
+				return payload;
+			}
+
+
+			bool INIFile::restoreCache(const std::string& filePath, const char* data, size_t size)
+			{
+				INICacheReader reader = { data, size, 0 };
+				std::vector<INISection> sections;
+				uint32_t sourceEncoding;
+				uint32_t multiline;
+				uint32_t sectionCount;
+
+				// 按不同的选项解析的结果不能复用
+				if (!reader.read(sourceEncoding) || !reader.read(multiline) || multiline != (multilineEnabled ? 1u : 0u) || !reader.read(sectionCount))
+				{
+					return false;
+				}
+
+				for (uint32_t i = 0; i < sectionCount; ++i)
+				{
+					INISection sect;
+					std::string name, comment, rightComment;
+					uint32_t line;
+					uint32_t itemCount;
+					uint32_t hasLayouts;
+
+					if (!reader.readString(name) || !reader.readString(comment) || !reader.readString(rightComment) || !reader.read(line) || !reader.read(itemCount)
+						|| !reader.read(hasLayouts))
+					{
+						return false;
+					}
+					sect.setName(name);
+					sect.setComment(comment);
+					sect.setRightComment(rightComment);
+					sect.line = line;
+
+					for (uint32_t j = 0; j < itemCount; ++j)
+					{
+						INIItem item;
+						uint32_t itemLine;
+						if (!reader.readString(item.key) || !reader.readString(item.value) || !reader.readString(item.comment) || !reader.readString(item.rightComment)
+							|| !reader.read(itemLine))
+						{
+							return false;
+						}
+						item.line = itemLine;
+
+						INIValueLayout layout;
+						if (hasLayouts)
+						{
+							uint32_t breakCount;
+							if (!reader.readString(layout.indent) || !reader.read(breakCount) || (size - reader.pos) / sizeof(uint64_t) < breakCount)
+							{
+								return false;
+							}
+							layout.breaks.resize(breakCount);
+							for (uint32_t k = 0; k < breakCount; ++k)
+							{
+								uint64_t position = 0;
+								reader.read(position);
+								layout.breaks[k] = static_cast<size_t>(position);
+							}
+						}
+						sect.pushItem(std::move(item), std::move(layout));
+					}
+					sections.push_back(std::move(sect));
+				}
+
+				if (reader.pos != size)
+				{
+					return false;
+				}
+
+				// 缓存完整可用后才替换当前内容
+				replaceSections(sections, filePath, static_cast<INIEncoding>(sourceEncoding));
+				return true;
+			}
+
+
+			void INIFile::replaceSections(std::vector<INISection>& sections, const std::string& filePath, INIEncoding sourceEncoding)
+			{
+				INIWatchSnapshot snapshot = snapshotWatched();
+				release();
+				path = filePath;
+				encoding = sourceEncoding;
+				sectionsCache.swap(sections);
+				if (sectionTreeEnabled)
+				{
+					rebuildSectionTree();
+				}
+				notifyReload(snapshot);
+			}
+
+
+			int INIFile::loadCached(std::string filePath, std::string cacheDir)
+			{
+				uint64_t size;
+				int64_t mtime;
+				std::string cachePath = cacheFileName(cacheDir, filePath);
+				std::string cache;
+				INICacheHeader header;
+				bool haveCache;
+				int errorValue;
+
+				if (!statFile(filePath, size, mtime))
+				{
+					return load(filePath);
+				}
+
+				haveCache = readFile(cachePath, cache) == RET_OK && parseHeader(cache, header) && header.path == filePath
+					&& hashBytes(cache.data() + header.payloadOffset, static_cast<size_t>(header.payloadSize)) == header.payloadHash;
+
+				// 快速路径：大小和修改时间都没变，不读源文件。
+				// 若源文件在缓存写入的同一秒内被修改过，修改时间不可信，需要校验内容哈希
+				if (haveCache && header.size == size && header.mtime == mtime && mtime / 1000000000 < header.writtenAt)
+				{
+					errorValue = header.errorValue;
+					if (restoreCache(filePath, cache.data() + header.payloadOffset, static_cast<size_t>(header.payloadSize)))
+					{
+						return errorValue;
+					}
+				}
+
+				std::string content;
+				if (readFile(filePath, content) != RET_OK)
+				{
+					return load(filePath);
+				}
+				uint64_t contentHash = hashBytes(content.data(), content.size());
+
+				// 只是修改时间变了而内容没变，复用缓存并刷新其中的文件标识
+				if (haveCache && header.size == content.size() && header.contentHash == contentHash)
+				{
+					errorValue = header.errorValue;
+					if (restoreCache(filePath, cache.data() + header.payloadOffset, static_cast<size_t>(header.payloadSize)))
+					{
+						writeCache(cachePath, filePath, content.size(), mtime, contentHash, errorValue, cache.substr(header.payloadOffset));
+						return errorValue;
+					}
+				}
+
+				errorValue = loadFromMemory(filePath, content);
+				writeCache(cachePath, filePath, content.size(), mtime, contentHash, errorValue, serializeCache());
+				return errorValue;
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,747 @@
+#include "writer.h"
+#include "encoding.h"
+
+#include <cstring>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 写入内存的输出，接口与 INIStreamWriter 相同
+			class INIStringWriter
+			{
+			public:
+				INIStringWriter(std::string& _out) : out(_out) {}
+
+				inline void write(const char* data, size_t size)
+				{
+					out.append(data, size);
+				}
+
+				inline void write(const std::string& text)
+				{
+					out.append(text);
+				}
+
+				inline void put(char c)
+				{
+					out += c;
+				}
+
+			private:
+				std::string& out;
+
+			};
+
+
+			// 各种输出中需要转义的字节，查表代替逐个比较
+			struct INIEscapeTable
+			{
+				bool json[256];
+				bool flatValue[256];
+				bool flatName[256];   // 段名
+				bool flatKey[256];    // 键名
+
+				INIEscapeTable()
+				{
+					for (int c = 0; c < 256; ++c)
+					{
+						json[c] = c < 0x20 || c == '"' || c == '\\';
+						flatValue[c] = c == '\\' || c == '\n' || c == '\r';
+						flatName[c] = flatValue[c] || c == '=';
+						flatKey[c] = flatName[c] || c == '.';
+					}
+				}
+			};
+
+			static const INIEscapeTable escapeTable;
+
+
+			static const uint64_t ONES = 0x0101010101010101ULL;
+			static const uint64_t HIGHS = 0x8080808080808080ULL;
+
+
+			// 8 个字节中是否有等于 c 的
+			static inline bool hasByte(uint64_t word, unsigned char c)
+			{
+				uint64_t x = word ^ (ONES * c);
+				return ((x - ONES) & ~x & HIGHS) != 0;
+			}
+
+
+			// 8 个字节中是否有小于 n 的，n 不超过 128
+			static inline bool hasLess(uint64_t word, unsigned char n)
+			{
+				return ((word - ONES * n) & ~word & HIGHS) != 0;
+			}
+
+
+			/*
+			* 从 p 开始跳过一定不需要转义的字节，每次检查 8 个字节
+			* 返回的位置之后仍需逐个查表，这里只排除整块都不可能转义的情况
+			*/
+			static inline const char* skipPlain(const char* p, const char* end, bool json)
+			{
+				uint64_t word;
+				while (end - p >= 8)
+				{
+					memcpy(&word, p, sizeof(word));
+					bool candidate = json
+						? hasLess(word, 0x20) || hasByte(word, '"') || hasByte(word, '\\')
+						: hasByte(word, '\\') || hasByte(word, '\n') || hasByte(word, '\r') || hasByte(word, '=') || hasByte(word, '.');
+					if (candidate)
+					{
+						break;
+					}
+					p += 8;
+				}
+				return p;
+			}
+
+
+			// 不需要转义的字节连续写出，只有遇到需要转义的字节时才中断
+			template <typename Writer>
+			static void writeJsonString(Writer& writer, const std::string& text)
+			{
+				static const char hex[] = "0123456789abcdef";
+				const char* p = text.data();
+				const char* end = p + text.size();
+				const char* run = p;
+
+				writer.put('"');
+				while ((p = skipPlain(p, end, true)) < end)
+				{
+					unsigned char c = static_cast<unsigned char>(*p++);
+					if (!escapeTable.json[c])
+					{
+						continue;
+					}
+
+					writer.write(run, p - 1 - run);
+					run = p;
+					switch (c)
+					{
+					case '"': writer.write("\\\"", 2); break;
+					case '\\': writer.write("\\\\", 2); break;
+					case '\n': writer.write("\\n", 2); break;
+					case '\r': writer.write("\\r", 2); break;
+					case '\t': writer.write("\\t", 2); break;
+					default:
+					{
+						char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+						writer.write(escaped, sizeof(escaped));
+						break;
+					}
+					}
+				}
+				writer.write(run, end - run);
+				writer.put('"');
+			}
+
+
+			// 扁平列表中的段名、键或值，escapes 是 escapeTable 中对应的表
+			template <typename Writer>
+			static void writeFlatText(Writer& writer, const std::string& text, const bool* escapes)
+			{
+				const char* p = text.data();
+				const char* end = p + text.size();
+				const char* run = p;
+
+				while ((p = skipPlain(p, end, false)) < end)
+				{
+					char c = *p++;
+					if (!escapes[static_cast<unsigned char>(c)])
+					{
+						continue;
+					}
+
+					writer.write(run, p - 1 - run);
+					run = p;
+					writer.put('\\');
+					writer.put(c == '\n' ? 'n' : c == '\r' ? 'r' : c);
+				}
+				writer.write(run, end - run);
+			}
+
+
+			template <typename Writer>
+			void INIFile::writeJson(Writer& writer)
+			{
+				bool firstSection = true;
+
+				writer.put('{');
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					if (sect->removed || (sect->name.empty() && sect->length() == 0))
+					{
+						continue;
+					}
+
+					writer.write(firstSection ? "\n  " : ",\n  ", firstSection ? 3 : 4);
+					firstSection = false;
+					writeJsonString(writer, sect->name);
+					writer.write(": {", 3);
+
+					bool firstItem = true;
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
+					{
+						writer.write(firstItem ? "\n    " : ",\n    ", firstItem ? 5 : 6);
+						firstItem = false;
+						writeJsonString(writer, item->key);
+						writer.write(": ", 2);
+						writeJsonString(writer, interpolationEnabled ? resolveValue(sect->name, item->key, item->value) : item->value);
+					}
+					if (!firstItem)
+					{
+						writer.write("\n  ", 3);
+					}
+					writer.put('}');
+				}
+				writer.write("\n}\n", 3);
+			}
+
+
+			template <typename Writer>
+			void INIFile::writeFlat(Writer& writer)
+			{
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					if (sect->removed)
+					{
+						continue;
+					}
+
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
+					{
+						if (!sect->name.empty())
+						{
+							writeFlatText(writer, sect->name, escapeTable.flatName);
+							writer.put('.');
+						}
+						writeFlatText(writer, item->key, escapeTable.flatKey);
+						writer.put('=');
+						writeFlatText(writer, interpolationEnabled ? resolveValue(sect->name, item->key, item->value) : item->value, escapeTable.flatValue);
+						writer.put('\n');
+					}
+				}
+			}
+
+
+			int INIFile::saveAsJson(std::string filePath)
+			{
+				INIStreamWriter writer(INI_ENCODING_UTF8);
+				if (!writer.open(filePath))
+				{
+					return ERR_OPEN_FILE_FAILED;
+				}
+				writeJson(writer);
+				return writer.close() ? RET_OK : ERR_WRITE_FILE_FAILED;
+			}
+
+
+			int INIFile::saveAsFlat(std::string filePath)
+			{
+				INIStreamWriter writer(INI_ENCODING_UTF8);
+				if (!writer.open(filePath))
+				{
+					return ERR_OPEN_FILE_FAILED;
+				}
+				writeFlat(writer);
+				return writer.close() ? RET_OK : ERR_WRITE_FILE_FAILED;
+			}
+
+
+			std::string INIFile::toJson()
+			{
+				std::string out;
+				INIStringWriter writer(out);
+				writeJson(writer);
+				return out;
+			}
+
+
+			std::string INIFile::toFlat()
+			{
+				std::string out;
+				INIStringWriter writer(out);
+				writeFlat(writer);
+				return out;
+			}
+
+
+			// 顺序读取 JSON 文本，空白中的换行计入行号
+			struct INIJsonReader
+			{
+				const char* p;
+				const char* end;
+				size_t line;
+
+				void skipSpace()
+				{
+					for (; p < end; ++p)
+					{
+						if (*p == '\n')
+						{
+							line++;
+						}
+						else if (*p != ' ' && *p != '\t' && *p != '\r')
+						{
+							break;
+						}
+					}
+				}
+
+				bool consume(char c)
+				{
+					skipSpace();
+					if (p < end && *p == c)
+					{
+						p++;
+						return true;
+					}
+					return false;
+				}
+
+				static int hexValue(char c)
+				{
+					if (c >= '0' && c <= '9') return c - '0';
+					if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+					if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+					return -1;
+				}
+
+				bool readHex4(uint32_t& code)
+				{
+					if (end - p < 4)
+					{
+						return false;
+					}
+					code = 0;
+					for (int i = 0; i < 4; ++i)
+					{
+						int digit = hexValue(*p++);
+						if (digit < 0)
+						{
+							return false;
+						}
+						code = code * 16 + digit;
+					}
+					return true;
+				}
+
+				static void appendUtf8(std::string& out, uint32_t code)
+				{
+					if (code < 0x80)
+					{
+						out += static_cast<char>(code);
+					}
+					else if (code < 0x800)
+					{
+						out += static_cast<char>(0xC0 | (code >> 6));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					else if (code < 0x10000)
+					{
+						out += static_cast<char>(0xE0 | (code >> 12));
+						out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					else
+					{
+						out += static_cast<char>(0xF0 | (code >> 18));
+						out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+						out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+						out += static_cast<char>(0x80 | (code & 0x3F));
+					}
+				}
+
+				// 当前位置是 " 时读出整个字符串，不需要转义的部分整段追加
+				bool readString(std::string& out)
+				{
+					out.clear();
+					if (!consume('"'))
+					{
+						return false;
+					}
+
+					for (;;)
+					{
+						const char* run = p;
+						while (p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+						{
+							p++;
+						}
+						out.append(run, p - run);
+						if (p >= end || static_cast<unsigned char>(*p) < 0x20)
+						{
+							return false;
+						}
+						if (*p++ == '"')
+						{
+							return true;
+						}
+
+						if (p >= end)
+						{
+							return false;
+						}
+						char c = *p++;
+						uint32_t code;
+						switch (c)
+						{
+						case '"': out += '"'; break;
+						case '\\': out += '\\'; break;
+						case '/': out += '/'; break;
+						case 'b': out += '\b'; break;
+						case 'f': out += '\f'; break;
+						case 'n': out += '\n'; break;
+						case 'r': out += '\r'; break;
+						case 't': out += '\t'; break;
+						case 'u':
+							if (!readHex4(code))
+							{
+								return false;
+							}
+							// 代理对合成一个码点，落单的代理项替换为 U+FFFD
+							if (code >= 0xD800 && code < 0xDC00)
+							{
+								uint32_t low;
+								if (end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+								{
+									const char* save = p;
+									p += 2;
+									if (readHex4(low) && low >= 0xDC00 && low < 0xE000)
+									{
+										code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+									}
+									else
+									{
+										p = save;
+										code = 0xFFFD;
+									}
+								}
+								else
+								{
+									code = 0xFFFD;
+								}
+							}
+							else if (code >= 0xDC00 && code < 0xE000)
+							{
+								code = 0xFFFD;
+							}
+							appendUtf8(out, code);
+							break;
+						default:
+							return false;
+						}
+					}
+				}
+
+				// 数字、true、false、null，按原文保存，null 为空串
+				bool readScalar(std::string& out)
+				{
+					out.clear();
+					if (end - p >= 4 && memcmp(p, "null", 4) == 0)
+					{
+						p += 4;
+						return true;
+					}
+					if (end - p >= 4 && memcmp(p, "true", 4) == 0)
+					{
+						out.assign(p, 4);
+						p += 4;
+						return true;
+					}
+					if (end - p >= 5 && memcmp(p, "false", 5) == 0)
+					{
+						out.assign(p, 5);
+						p += 5;
+						return true;
+					}
+
+					const char* begin = p;
+					if (p < end && *p == '-')
+					{
+						p++;
+					}
+					const char* digits = p;
+					while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'))
+					{
+						p++;
+					}
+					if (p == digits || *digits < '0' || *digits > '9')
+					{
+						return false;
+					}
+
+					// 用 strtod 校验完整的数字语法
+					std::string text(begin, p - begin);
+					char* parsed = NULL;
+					strtod(text.c_str(), &parsed);
+					if (parsed != text.c_str() + text.size())
+					{
+						return false;
+					}
+					out.swap(text);
+					return true;
+				}
+			};
+
+
+			int INIFile::parseJson(const char* data, size_t size, std::vector<INISection>& sections)
+			{
+				INIJsonReader reader = { data, data + size, 1 };
+				std::vector<size_t> open;  // 尚未结束的对象对应的段，0 是顶层对象对应的无名段
+				std::string name;
+				INIItem item;
+
+				sections.resize(1);
+				sections[0].setName("");
+				if (!reader.consume('{'))
+				{
+					return ERR_INVALID_JSON;
+				}
+				open.push_back(0);
+
+				bool expectMember = false;  // 刚读过 ','，下一个必须是成员
+				while (!open.empty())
+				{
+					if (!expectMember && reader.consume('}'))
+					{
+						open.pop_back();
+					}
+					else
+					{
+						reader.skipSpace();
+						size_t line = reader.line;
+						if (!reader.readString(name) || !reader.consume(':'))
+						{
+							return ERR_INVALID_JSON;
+						}
+
+						reader.skipSpace();
+						if (reader.p < reader.end && *reader.p == '{')
+						{
+							// 对象成为段，嵌套的对象以 . 接在上一级段名之后；顶层的 "" 就是无名段
+							reader.p++;
+							expectMember = false;
+							if (open.size() == 1 && name.empty())
+							{
+								open.push_back(0);
+								continue;
+							}
+							INISection sect;
+							sect.setName(open.size() == 1 ? name : sections[open.back()].name + "." + name);
+							sect.line = line;
+							sections.push_back(std::move(sect));
+							open.push_back(sections.size() - 1);
+							continue;
+						}
+
+						bool ok = reader.p < reader.end && *reader.p == '"' ? reader.readString(item.value) : reader.readScalar(item.value);
+						if (!ok)
+						{
+							return ERR_INVALID_JSON;
+						}
+						item.key.swap(name);
+						item.line = line;
+						sections[open.back()].pushItem(std::move(item));
+						item = INIItem();
+					}
+
+					if (open.empty())
+					{
+						break;
+					}
+					expectMember = reader.consume(',');
+					if (!expectMember)
+					{
+						reader.skipSpace();
+						if (reader.p >= reader.end || *reader.p != '}')
+						{
+							return ERR_INVALID_JSON;
+						}
+					}
+				}
+
+				reader.skipSpace();
+				return reader.p == reader.end ? RET_OK : ERR_INVALID_JSON;
+			}
+
+
+			int INIFile::parseFlat(const char* data, size_t size, std::vector<INISection>& sections)
+			{
+				std::unordered_map<std::string, size_t> positions;  // 段名到 sections 中位置
+				std::string name;
+				const char* end = data + size;
+				size_t lineNumber = 0;
+
+				sections.resize(1);
+				sections[0].setName("");
+				positions.emplace("", 0);
+				for (const char* p = data; p < end; )
+				{
+					const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+					if (lineEnd == NULL)
+					{
+						lineEnd = end;
+					}
+					const char* next = lineEnd + 1;
+					lineNumber++;
+					if (lineEnd > p && lineEnd[-1] == '\r')
+					{
+						lineEnd--;
+					}
+					if (p == lineEnd)
+					{
+						p = next;
+						continue;
+					}
+
+					// 名称中转义的字符原样保留，只记下最后一个未转义的 . 的位置
+					name.clear();
+					size_t dot = std::string::npos;
+					for (; p < lineEnd && *p != '='; ++p)
+					{
+						if (*p == '\\' && p + 1 < lineEnd)
+						{
+							p++;
+							name += *p == 'n' ? '\n' : *p == 'r' ? '\r' : *p;
+							continue;
+						}
+						if (*p == '.')
+						{
+							dot = name.size();
+						}
+						name += *p;
+					}
+					if (p >= lineEnd)
+					{
+						return ERR_PARSE_KEY_VALUE_FAILED;
+					}
+					p++;
+
+					INIItem item;
+					item.line = lineNumber;
+					item.value.reserve(lineEnd - p);
+					for (const char* run = p; ; )
+					{
+						while (p < lineEnd && *p != '\\')
+						{
+							p++;
+						}
+						item.value.append(run, p - run);
+						if (p + 1 >= lineEnd)
+						{
+							if (p < lineEnd)
+							{
+								item.value += '\\';
+							}
+							break;
+						}
+						p++;
+						item.value += *p == 'n' ? '\n' : *p == 'r' ? '\r' : *p;
+						run = ++p;
+					}
+
+					std::string sectionName;
+					if (dot == std::string::npos)
+					{
+						item.key = name;
+					}
+					else
+					{
+						sectionName.assign(name, 0, dot);
+						item.key.assign(name, dot + 1, std::string::npos);
+					}
+
+					auto found = positions.find(sectionName);
+					if (found == positions.end())
+					{
+						INISection sect;
+						sect.setName(sectionName);
+						sect.line = lineNumber;
+						sections.push_back(std::move(sect));
+						found = positions.emplace(sectionName, sections.size() - 1).first;
+					}
+					sections[found->second].pushItem(std::move(item));
+					p = next;
+				}
+				return RET_OK;
+			}
+
+
+			// UTF-16 先整体转成 UTF-8，UTF-8 只需跳过 BOM
+			static const std::string& decodeText(const std::string& content, std::string& decoded, size_t& begin)
+			{
+				INIEncoding encoding = detectEncoding(content.data(), content.size(), &begin);
+				if (encoding == INI_ENCODING_UTF16LE || encoding == INI_ENCODING_UTF16BE)
+				{
+					utf16ToUtf8(content.data() + begin, content.size() - begin, encoding == INI_ENCODING_UTF16BE, decoded);
+					begin = 0;
+					return decoded;
+				}
+				return content;
+			}
+
+
+			int INIFile::loadJsonFromMemory(const std::string& content)
+			{
+				std::string decoded;
+				size_t begin = 0;
+				const std::string& text = decodeText(content, decoded, begin);
+
+				std::vector<INISection> sections;
+				int ret = parseJson(text.data() + begin, text.size() - begin, sections);
+				if (ret == RET_OK)
+				{
+					replaceSections(sections, "", INI_ENCODING_UTF8);
+				}
+				return ret;
+			}
+
+
+			int INIFile::loadFlatFromMemory(const std::string& content)
+			{
+				std::string decoded;
+				size_t begin = 0;
+				const std::string& text = decodeText(content, decoded, begin);
+
+				std::vector<INISection> sections;
+				int ret = parseFlat(text.data() + begin, text.size() - begin, sections);
+				if (ret == RET_OK)
+				{
+					replaceSections(sections, "", INI_ENCODING_UTF8);
+				}
+				return ret;
+			}
+
+
+			int INIFile::loadJson(std::string filePath)
+			{
+				std::string content;
+				if (readFile(filePath, content) != RET_OK)
+				{
+					return ERR_OPEN_FILE_FAILED;
+				}
+				return loadJsonFromMemory(content);
+			}
+
+
+			int INIFile::loadFlat(std::string filePath)
+			{
+				std::string content;
+				if (readFile(filePath, content) != RET_OK)
+				{
+					return ERR_OPEN_FILE_FAILED;
+				}
+				return loadFlatFromMemory(content);
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,435 @@
+#include "diff.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 重名的键只有第一个参与比较
+			static inline bool isFirstItem(INISection& sect, INISection::INIItemIterator item)
+			{
+				return &*sect.findItem(item->key) == &*item;
+			}
+
+
+			static inline INIItem* lookupItem(INISection* sect, const std::string& key)
+			{
+				if (sect == NULL)
+				{
+					return NULL;
+				}
+				INISection::INIItemIterator item = sect->findItem(key);
+				return item == sect->end() ? NULL : &*item;
+			}
+
+
+			// 按顺序逐项比较，包括注释
+			static bool sameSection(INISection& a, INISection& b)
+			{
+				if (a.length() != b.length() || a.getComment() != b.getComment() || a.getRightComment() != b.getRightComment())
+				{
+					return false;
+				}
+				for (INISection::INIItemIterator i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j)
+				{
+					if (i->key != j->key || i->value != j->value || i->comment != j->comment || i->rightComment != j->rightComment)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+
+			/*
+			* 单个值或注释的三方合并：只有对方改动而我方未改动时才取对方的，
+			* 双方改成不同内容时设置 conflicted，其余情况保留我方
+			*/
+			static bool takeTheirs(const std::string& base, const std::string& ours, const std::string& theirs, bool& conflicted)
+			{
+				conflicted = false;
+				if (theirs == base || ours == theirs)
+				{
+					return false;
+				}
+				if (ours == base)
+				{
+					return true;
+				}
+				conflicted = true;
+				return false;
+			}
+
+
+			static inline INIDifference makeDifference(INIDiffType type, const std::string& section, const std::string& key, const std::string& oldValue, const std::string& newValue)
+			{
+				INIDifference difference = { type, section, key, oldValue, newValue };
+				return difference;
+			}
+
+
+			static inline INIMergeConflict makeConflict(INIConflictType type, const std::string& section, const std::string& key, const std::string& baseValue, const std::string& oursValue, const std::string& theirsValue)
+			{
+				INIMergeConflict conflict = { type, section, key, baseValue, oursValue, theirsValue };
+				return conflict;
+			}
+
+
+			// 键的注释和行尾注释，值由调用者处理
+			static void mergeItemComments(INIItem& base, INIItem& ours, INIItem& theirs, const std::string& section, INIMergeResult& result)
+			{
+				bool conflicted;
+				if (takeTheirs(base.comment, ours.comment, theirs.comment, conflicted))
+				{
+					result.applied.push_back(makeDifference(INI_DIFF_COMMENT_CHANGED, section, ours.key, ours.comment, theirs.comment));
+					ours.comment = theirs.comment;
+				}
+				else if (conflicted)
+				{
+					result.conflicts.push_back(makeConflict(INI_CONFLICT_COMMENT, section, ours.key, base.comment, ours.comment, theirs.comment));
+				}
+
+				if (takeTheirs(base.rightComment, ours.rightComment, theirs.rightComment, conflicted))
+				{
+					result.applied.push_back(makeDifference(INI_DIFF_RIGHT_COMMENT_CHANGED, section, ours.key, ours.rightComment, theirs.rightComment));
+					ours.rightComment = theirs.rightComment;
+				}
+				else if (conflicted)
+				{
+					result.conflicts.push_back(makeConflict(INI_CONFLICT_COMMENT, section, ours.key, base.rightComment, ours.rightComment, theirs.rightComment));
+				}
+			}
+
+
+			static void mergeSectionComments(INISection& base, INISection& ours, INISection& theirs, INIMergeResult& result)
+			{
+				bool conflicted;
+				std::string name = ours.getName();
+				std::string baseText = base.getComment();
+				std::string ourText = ours.getComment();
+				std::string theirText = theirs.getComment();
+
+				if (takeTheirs(baseText, ourText, theirText, conflicted))
+				{
+					result.applied.push_back(makeDifference(INI_DIFF_COMMENT_CHANGED, name, "", ourText, theirText));
+					ours.setComment(theirText);
+				}
+				else if (conflicted)
+				{
+					result.conflicts.push_back(makeConflict(INI_CONFLICT_COMMENT, name, "", baseText, ourText, theirText));
+				}
+
+				baseText = base.getRightComment();
+				ourText = ours.getRightComment();
+				theirText = theirs.getRightComment();
+				if (takeTheirs(baseText, ourText, theirText, conflicted))
+				{
+					result.applied.push_back(makeDifference(INI_DIFF_RIGHT_COMMENT_CHANGED, name, "", ourText, theirText));
+					ours.setRightComment(theirText);
+				}
+				else if (conflicted)
+				{
+					result.conflicts.push_back(makeConflict(INI_CONFLICT_COMMENT, name, "", baseText, ourText, theirText));
+				}
+			}
+
+
+			std::unordered_map<std::string, size_t> INIFile::hashSections()
+			{
+				std::unordered_map<std::string, size_t> index;
+				index.reserve(sectionsCache.size() - removedSections);
+				for (size_t i = 0; i < sectionsCache.size(); ++i)
+				{
+					if (!sectionsCache[i].removed)
+					{
+						index.emplace(sectionsCache[i].getName(), i);
+					}
+				}
+				return index;
+			}
+
+
+			std::vector<INIDifference> INIFile::diff(INIFile& other)
+			{
+				std::vector<INIDifference> differences;
+				std::unordered_map<std::string, size_t> mine = hashSections();
+				std::unordered_map<std::string, size_t> theirs = other.hashSections();
+
+				for (size_t i = 0; i < sectionsCache.size(); ++i)
+				{
+					INISection& sect = sectionsCache[i];
+					std::string name = sect.getName();
+					if (sect.removed || mine.find(name)->second != i)
+					{
+						continue;
+					}
+
+					auto match = theirs.find(name);
+					if (match == theirs.end())
+					{
+						differences.push_back(makeDifference(INI_DIFF_SECTION_REMOVED, name, "", "", ""));
+						continue;
+					}
+					INISection& target = other.sectionsCache[match->second];
+
+					if (sect.getComment() != target.getComment())
+					{
+						differences.push_back(makeDifference(INI_DIFF_COMMENT_CHANGED, name, "", sect.getComment(), target.getComment()));
+					}
+					if (sect.getRightComment() != target.getRightComment())
+					{
+						differences.push_back(makeDifference(INI_DIFF_RIGHT_COMMENT_CHANGED, name, "", sect.getRightComment(), target.getRightComment()));
+					}
+
+					for (INISection::INIItemIterator item = sect.begin(); item != sect.end(); ++item)
+					{
+						if (!isFirstItem(sect, item))
+						{
+							continue;
+						}
+
+						INIItem* counterpart = lookupItem(&target, item->key);
+						if (counterpart == NULL)
+						{
+							differences.push_back(makeDifference(INI_DIFF_KEY_REMOVED, name, item->key, item->value, ""));
+							continue;
+						}
+						if (item->value != counterpart->value)
+						{
+							differences.push_back(makeDifference(INI_DIFF_KEY_CHANGED, name, item->key, item->value, counterpart->value));
+						}
+						if (item->comment != counterpart->comment)
+						{
+							differences.push_back(makeDifference(INI_DIFF_COMMENT_CHANGED, name, item->key, item->comment, counterpart->comment));
+						}
+						if (item->rightComment != counterpart->rightComment)
+						{
+							differences.push_back(makeDifference(INI_DIFF_RIGHT_COMMENT_CHANGED, name, item->key, item->rightComment, counterpart->rightComment));
+						}
+					}
+
+					for (INISection::INIItemIterator item = target.begin(); item != target.end(); ++item)
+					{
+						if (isFirstItem(target, item) && lookupItem(&sect, item->key) == NULL)
+						{
+							differences.push_back(makeDifference(INI_DIFF_KEY_ADDED, name, item->key, "", item->value));
+						}
+					}
+				}
+
+				for (size_t i = 0; i < other.sectionsCache.size(); ++i)
+				{
+					INISection& sect = other.sectionsCache[i];
+					std::string name = sect.getName();
+					if (!sect.removed && theirs.find(name)->second == i && mine.find(name) == mine.end())
+					{
+						differences.push_back(makeDifference(INI_DIFF_SECTION_ADDED, name, "", "", ""));
+					}
+				}
+				return differences;
+			}
+
+
+			/*
+			* 按对方的文件顺序逐段合并，再处理对方删除的段：
+			* 我方新增段只追加在末尾（无名段例外，先于其余步骤插入到首位），
+			* 删除放在最后一次完成，因此合并过程中我方已有段的位置不变
+			*/
+			INIMergeResult INIFile::merge(INIFile& base, INIFile& theirs)
+			{
+				INIMergeResult result;
+				std::unordered_map<std::string, size_t> baseIndex = base.hashSections();
+				std::unordered_map<std::string, size_t> theirIndex = theirs.hashSections();
+
+				// 复制对方新增的段，每个键只保留第一个
+				auto addSection = [this, &result](INISection& from) {
+					INISection copy;
+					std::string name = from.getName();
+					copy.setName(name);
+					copy.setComment(from.getComment());
+					copy.setRightComment(from.getRightComment());
+					for (INISection::INIItemIterator item = from.begin(); item != from.end(); ++item)
+					{
+						if (isFirstItem(from, item))
+						{
+							copy.pushItem(*item);
+						}
+					}
+
+					size_t position = name.empty() ? 0 : sectionsCache.size();
+					sectionsCache.insert(sectionsCache.begin() + position, std::move(copy));
+					attachSection(position);
+
+					result.applied.push_back(makeDifference(INI_DIFF_SECTION_ADDED, name, "", "", ""));
+					INISection& added = sectionsCache[position];
+					updateFingerprint(0, added.fingerprint());
+					for (INISection::INIItemIterator item = added.begin(); item != added.end(); ++item)
+					{
+						notify(INI_KEY_SET, name, item->key, "", item->value);
+					}
+				};
+
+				auto theirEmpty = theirIndex.find("");
+				if (theirEmpty != theirIndex.end() && baseIndex.find("") == baseIndex.end() && findSection("") == sectionsCache.end())
+				{
+					addSection(theirs.sectionsCache[theirEmpty->second]);
+				}
+				std::unordered_map<std::string, size_t> ourIndex = hashSections();
+
+				for (size_t i = 0; i < theirs.sectionsCache.size(); ++i)
+				{
+					INISection& target = theirs.sectionsCache[i];
+					std::string name = target.getName();
+					if (target.removed || theirIndex.find(name)->second != i)
+					{
+						continue;
+					}
+
+					auto baseFound = baseIndex.find(name);
+					auto ourFound = ourIndex.find(name);
+					INISection* origin = baseFound == baseIndex.end() ? NULL : &base.sectionsCache[baseFound->second];
+
+					if (ourFound == ourIndex.end())
+					{
+						if (origin == NULL)
+						{
+							addSection(target);
+						}
+						else if (!sameSection(*origin, target))
+						{
+							result.conflicts.push_back(makeConflict(INI_CONFLICT_DELETED_BY_OURS, name, "", "", "", ""));
+						}
+						continue;
+					}
+
+					INISection& sect = sectionsCache[ourFound->second];
+					uint64_t digest = sect.fingerprint();
+					if (origin != NULL)
+					{
+						mergeSectionComments(*origin, sect, target, result);
+					}
+
+					for (INISection::INIItemIterator item = target.begin(); item != target.end(); ++item)
+					{
+						if (!isFirstItem(target, item))
+						{
+							continue;
+						}
+
+						const std::string& key = item->key;
+						INIItem* before = lookupItem(origin, key);
+						INIItem* ours = lookupItem(&sect, key);
+
+						// 对方新增的键
+						if (before == NULL)
+						{
+							if (ours == NULL)
+							{
+								sect.pushItem(*item);
+								result.applied.push_back(makeDifference(INI_DIFF_KEY_ADDED, name, key, "", item->value));
+								notify(INI_KEY_SET, name, key, "", item->value);
+							}
+							else if (ours->value != item->value)
+							{
+								result.conflicts.push_back(makeConflict(INI_CONFLICT_VALUE, name, key, "", ours->value, item->value));
+							}
+							continue;
+						}
+
+						if (ours == NULL)
+						{
+							if (before->value != item->value)
+							{
+								result.conflicts.push_back(makeConflict(INI_CONFLICT_DELETED_BY_OURS, name, key, before->value, "", item->value));
+							}
+							continue;
+						}
+
+						bool conflicted;
+						if (takeTheirs(before->value, ours->value, item->value, conflicted))
+						{
+							std::string oldValue = ours->value;
+							sect.setValue(sect.findItem(key), item->value);
+							result.applied.push_back(makeDifference(INI_DIFF_KEY_CHANGED, name, key, oldValue, item->value));
+							notify(INI_KEY_SET, name, key, oldValue, item->value);
+						}
+						else if (conflicted)
+						{
+							result.conflicts.push_back(makeConflict(INI_CONFLICT_VALUE, name, key, before->value, ours->value, item->value));
+						}
+						mergeItemComments(*before, *ours, *item, name, result);
+					}
+
+					// 对方删除的键
+					if (origin == NULL)
+					{
+						updateFingerprint(digest, sect.fingerprint());
+						continue;
+					}
+
+					for (INISection::INIItemIterator item = origin->begin(); item != origin->end(); ++item)
+					{
+						if (!isFirstItem(*origin, item) || lookupItem(&target, item->key) != NULL)
+						{
+							continue;
+						}
+
+						INISection::INIItemIterator ours = sect.findItem(item->key);
+						if (ours == sect.end())
+						{
+							continue;
+						}
+						if (ours->value != item->value)
+						{
+							result.conflicts.push_back(makeConflict(INI_CONFLICT_DELETED_BY_THEIRS, name, item->key, item->value, ours->value, ""));
+							continue;
+						}
+
+						std::string oldValue = ours->value;
+						sect.eraseItem(ours);
+						result.applied.push_back(makeDifference(INI_DIFF_KEY_REMOVED, name, item->key, oldValue, ""));
+						notify(INI_KEY_DELETED, name, item->key, oldValue, "");
+					}
+					updateFingerprint(digest, sect.fingerprint());
+				}
+
+				// 对方删除的段，我方改动过的不删除
+				std::vector<std::string> removed;
+				for (size_t i = 0; i < base.sectionsCache.size(); ++i)
+				{
+					INISection& origin = base.sectionsCache[i];
+					std::string name = origin.getName();
+					if (origin.removed || baseIndex.find(name)->second != i || theirIndex.find(name) != theirIndex.end())
+					{
+						continue;
+					}
+
+					auto ourFound = ourIndex.find(name);
+					if (ourFound == ourIndex.end())
+					{
+						continue;
+					}
+					if (sameSection(origin, sectionsCache[ourFound->second]))
+					{
+						removed.push_back(name);
+					}
+					else
+					{
+						result.conflicts.push_back(makeConflict(INI_CONFLICT_DELETED_BY_THEIRS, name, "", "", "", ""));
+					}
+				}
+
+				for (auto name = removed.begin(); name != removed.end(); ++name)
+				{
+					deleteSection(*name);
+					result.applied.push_back(makeDifference(INI_DIFF_SECTION_REMOVED, *name, "", "", ""));
+				}
+				return result;
+			}
+
+
+		};
+	};
+};
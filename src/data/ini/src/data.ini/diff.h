@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_DIFF_H_
+#define _TFC_DATA_FORMAT_INI_DIFF_H_
+
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 两个文件之间的一处差异
+			enum INIDiffType
+			{
+				INI_DIFF_SECTION_ADDED,
+				INI_DIFF_SECTION_REMOVED,
+				INI_DIFF_KEY_ADDED,
+				INI_DIFF_KEY_REMOVED,
+				INI_DIFF_KEY_CHANGED,
+				INI_DIFF_COMMENT_CHANGED,       // key 为空时是段的注释
+				INI_DIFF_RIGHT_COMMENT_CHANGED  // key 为空时是段的行尾注释
+			};
+
+
+			/*
+			* oldValue 和 newValue 是值或注释的原文；
+			* 整个段增删时 key 为空，两者也为空，段内的键不再逐个列出
+			*/
+			struct INIDifference
+			{
+				INIDiffType type;
+				std::string section;
+				std::string key;
+				std::string oldValue;
+				std::string newValue;
+			};
+
+
+			enum INIConflictType
+			{
+				INI_CONFLICT_VALUE,             // 双方改成了不同的值，或新增了同名但值不同的键
+				INI_CONFLICT_DELETED_BY_OURS,   // 我方删除了对方修改过的键或段
+				INI_CONFLICT_DELETED_BY_THEIRS, // 对方删除了我方修改过的键或段
+				INI_CONFLICT_COMMENT            // 双方改成了不同的注释
+			};
+
+
+			// 冲突处保留我方的内容，三方的原文留给调用者处理；key 为空时指整个段或段的注释
+			struct INIMergeConflict
+			{
+				INIConflictType type;
+				std::string section;
+				std::string key;
+				std::string baseValue;
+				std::string oursValue;
+				std::string theirsValue;
+			};
+
+
+			struct INIMergeResult
+			{
+				std::vector<INIDifference> applied;        // 从对方合入我方的变更
+				std::vector<INIMergeConflict> conflicts;
+
+				bool clean() const
+				{
+					return conflicts.empty();
+				}
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_DIFF_H_
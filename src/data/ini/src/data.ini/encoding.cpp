@@ -0,0 +1,297 @@
+#include "encoding.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define INI_ENCODING_SSE2
+#endif
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+			INIEncoding detectEncoding(const char* data, size_t size, size_t* bomSize)
+			{
+				const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+				*bomSize = 0;
+
+				if (size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+				{
+					*bomSize = 3;
+					return INI_ENCODING_UTF8_BOM;
+				}
+				if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+				{
+					*bomSize = 2;
+					return INI_ENCODING_UTF16LE;
+				}
+				if (size >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+				{
+					*bomSize = 2;
+					return INI_ENCODING_UTF16BE;
+				}
+
+				// INI 文件总是以 ASCII 字符开头，UTF-16 下其中一个字节必然为 0
+				if (size >= 2 && size % 2 == 0)
+				{
+					if (p[0] != 0 && p[1] == 0)
+					{
+						return INI_ENCODING_UTF16LE;
+					}
+					if (p[0] == 0 && p[1] != 0)
+					{
+						return INI_ENCODING_UTF16BE;
+					}
+				}
+				return INI_ENCODING_UTF8;
+			}
+
+
+			std::string encodingBom(INIEncoding encoding)
+			{
+				switch (encoding)
+				{
+				case INI_ENCODING_UTF8_BOM:
+					return "\xEF\xBB\xBF";
+				case INI_ENCODING_UTF16LE:
+					return "\xFF\xFE";
+				case INI_ENCODING_UTF16BE:
+					return "\xFE\xFF";
+				default:
+					return "";
+				}
+			}
+
+
+			static inline uint32_t readUnit(const unsigned char* p, bool bigEndian)
+			{
+				return bigEndian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+			}
+
+
+			static inline char* writeUnit(char* out, uint32_t unit, bool bigEndian)
+			{
+				if (bigEndian)
+				{
+					*out++ = static_cast<char>(unit >> 8);
+					*out++ = static_cast<char>(unit & 0xFF);
+				}
+				else
+				{
+					*out++ = static_cast<char>(unit & 0xFF);
+					*out++ = static_cast<char>(unit >> 8);
+				}
+				return out;
+			}
+
+
+			static inline char* writeUtf8(char* out, uint32_t cp)
+			{
+				if (cp < 0x80)
+				{
+					*out++ = static_cast<char>(cp);
+				}
+				else if (cp < 0x800)
+				{
+					*out++ = static_cast<char>(0xC0 | (cp >> 6));
+					*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				else if (cp < 0x10000)
+				{
+					*out++ = static_cast<char>(0xE0 | (cp >> 12));
+					*out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+					*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				else
+				{
+					*out++ = static_cast<char>(0xF0 | (cp >> 18));
+					*out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+					*out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+					*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				return out;
+			}
+
+
+			void utf16ToUtf8(const char* data, size_t size, bool bigEndian, std::string& out)
+			{
+				const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+				size_t units = size / 2;
+				size_t i = 0;
+				size_t start = out.size();
+
+				// 先按全 ASCII 分配，遇到多字节字符空间不够时再倍增
+				out.resize(start + units + 64);
+				char* dst = &out[0] + start;
+				char* end = &out[0] + out.size();
+				auto grow = [&]() {
+					size_t used = dst - (&out[0] + start);
+					out.resize(out.size() + std::max(out.size() - start, static_cast<size_t>(64)));
+					dst = &out[0] + start + used;
+					end = &out[0] + out.size();
+				};
+
+				while (i < units)
+				{
+#ifdef INI_ENCODING_SSE2
+					// 一次处理 16 个单元：全部小于 0x80 时直接压缩成 16 个字节
+					const __m128i highMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+					while (i + 16 <= units && end - dst >= 16)
+					{
+						__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 2));
+						__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 2 + 16));
+						if (bigEndian)
+						{
+							a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+							b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+						}
+
+						__m128i high = _mm_and_si128(_mm_or_si128(a, b), highMask);
+						if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+						{
+							break;
+						}
+
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(a, b));
+						dst += 16;
+						i += 16;
+					}
+					if (i >= units)
+					{
+						break;
+					}
+#endif
+
+					// 逐个处理非 ASCII 单元，遇到下一段 ASCII 时回到向量路径。
+					// 16 个单元最多产生 16 * 3 + 1 个字节
+					if (end - dst < 64)
+					{
+						grow();
+					}
+					size_t stop = std::min(units, i + 16);
+					for (; i < stop; ++i)
+					{
+						uint32_t unit = readUnit(p + i * 2, bigEndian);
+
+						if (unit >= 0xD800 && unit <= 0xDBFF)
+						{
+							uint32_t low = i + 1 < units ? readUnit(p + i * 2 + 2, bigEndian) : 0;
+							if (low >= 0xDC00 && low <= 0xDFFF)
+							{
+								dst = writeUtf8(dst, 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+								++i;
+								continue;
+							}
+							unit = 0xFFFD;
+						}
+						else if (unit >= 0xDC00 && unit <= 0xDFFF)
+						{
+							unit = 0xFFFD;
+						}
+						dst = writeUtf8(dst, unit);
+					}
+				}
+
+				// 文件被截断时末尾会剩下半个单元，与落单的代理项一样替换为 U+FFFD，不悄悄丢掉
+				if (size % 2 != 0)
+				{
+					if (end - dst < 3)
+					{
+						grow();
+					}
+					dst = writeUtf8(dst, 0xFFFD);
+				}
+
+				out.resize(dst - &out[0]);
+			}
+
+
+			void utf8ToUtf16(const char* data, size_t size, bool bigEndian, std::string& out)
+			{
+				const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+				size_t i = 0;
+				size_t start = out.size();
+
+				// 每个 UTF-8 字节最多对应 2 个字节的 UTF-16
+				out.resize(start + size * 2);
+				char* dst = &out[0] + start;
+				char* const first = dst;
+
+				while (i < size)
+				{
+#ifdef INI_ENCODING_SSE2
+					// 16 个字节全是 ASCII 时直接扩展为 16 个单元
+					while (i + 16 <= size)
+					{
+						__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+						if (_mm_movemask_epi8(v) != 0)
+						{
+							break;
+						}
+
+						__m128i lo = bigEndian ? _mm_unpacklo_epi8(_mm_setzero_si128(), v) : _mm_unpacklo_epi8(v, _mm_setzero_si128());
+						__m128i hi = bigEndian ? _mm_unpackhi_epi8(_mm_setzero_si128(), v) : _mm_unpackhi_epi8(v, _mm_setzero_si128());
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), lo);
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), hi);
+						dst += 32;
+						i += 16;
+					}
+					if (i >= size)
+					{
+						break;
+					}
+#endif
+
+					size_t stop = std::min(size, i + 16);
+					while (i < stop)
+					{
+						uint32_t c = p[i];
+						uint32_t cp = 0xFFFD;
+						size_t len = 1;
+
+						if (c < 0x80)
+						{
+							cp = c;
+						}
+						else if (c >= 0xC2 && c <= 0xF4)
+						{
+							size_t need = c >= 0xF0 ? 3 : (c >= 0xE0 ? 2 : 1);
+							uint32_t value = c & (0x3F >> need);
+							size_t j = 1;
+							for (; j <= need && i + j < size && (p[i + j] & 0xC0) == 0x80; ++j)
+							{
+								value = (value << 6) | (p[i + j] & 0x3F);
+							}
+
+							// 拒绝过长编码、代理项和超出范围的码点
+							if (j == need + 1
+								&& !(need == 2 && value < 0x800) && !(need == 3 && (value < 0x10000 || value > 0x10FFFF))
+								&& !(value >= 0xD800 && value <= 0xDFFF))
+							{
+								cp = value;
+							}
+							len = j;
+						}
+
+						if (cp >= 0x10000)
+						{
+							cp -= 0x10000;
+							dst = writeUnit(dst, 0xD800 + (cp >> 10), bigEndian);
+							dst = writeUnit(dst, 0xDC00 + (cp & 0x3FF), bigEndian);
+						}
+						else
+						{
+							dst = writeUnit(dst, cp, bigEndian);
+						}
+						i += len;
+					}
+				}
+
+				out.resize(start + (dst - first));
+			}
+
+
+		};
+	};
+};
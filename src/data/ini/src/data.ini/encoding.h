@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_ENCODING_H_
+#define _TFC_DATA_FORMAT_INI_ENCODING_H_
+
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 根据 BOM 判断编码，没有 BOM 时按前两个字节里的 0 推测 UTF-16，否则视为 UTF-8
+			INIEncoding detectEncoding(const char* data, size_t size, size_t* bomSize);
+
+			// 返回编码对应的 BOM，UTF-8 无 BOM 时为空串
+			std::string encodingBom(INIEncoding encoding);
+
+			// UTF-16 转 UTF-8，非法的代理项和末尾落单的字节替换为 U+FFFD，结果追加到 out
+			void utf16ToUtf8(const char* data, size_t size, bool bigEndian, std::string& out);
+
+			// UTF-8 转 UTF-16，非法的字节序列替换为 U+FFFD，结果追加到 out
+			void utf8ToUtf16(const char* data, size_t size, bool bigEndian, std::string& out);
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_ENCODING_H_
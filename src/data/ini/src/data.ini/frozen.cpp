@@ -0,0 +1,582 @@
+#include "frozen.h"
+#include "hash.h"
+
+#include <unordered_set>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			static const char FROZEN_MAGIC[8] = { 'T', 'F', 'C', 'I', 'N', 'I', 'F', '1' };
+
+
+			// 带位移 d 的哈希；salt 用来把同名键按所属段区分开
+			static inline uint64_t frozenHash(const char* data, size_t size, uint64_t salt, uint32_t d)
+			{
+				uint64_t h = hashBytes(data, size, INI_HASH_SEED ^ salt ^ (d * 0x9E3779B97F4A7C15ULL));
+
+				// FNV 的低位分布较差，再做一次混合
+				h ^= h >> 33;
+				h *= 0xFF51AFD7ED558CCDULL;
+				h ^= h >> 33;
+				return h;
+			}
+
+
+			static inline uint64_t sectionSalt(uint32_t section)
+			{
+				return (static_cast<uint64_t>(section) + 1) * 0xC2B2AE3D27D4EB4FULL;
+			}
+
+
+			/*
+			* 用“哈希-位移”法构建最小完美哈希：
+			* 先按 hash(key, 0) 把键分到 n 个桶里，从最大的桶开始为每个桶寻找位移 d，
+			* 使桶内所有键的 hash(key, d) 落到互不相同的空槽上；只有一个键的桶直接放进空槽，
+			* 位移表里记为 -(槽位 + 1)
+			*/
+			template <typename HashFn>
+			static void buildPerfectHash(uint32_t n, HashFn hash, std::vector<int32_t>& disp, std::vector<uint32_t>& slots)
+			{
+				std::vector<std::vector<uint32_t>> buckets(n);
+				std::vector<bool> used(n, false);
+				std::vector<uint32_t> order;
+
+				disp.assign(n, 0);
+				slots.assign(n, 0);
+
+				for (uint32_t i = 0; i < n; ++i)
+				{
+					buckets[hash(i, 0) % n].push_back(i);
+				}
+
+				for (uint32_t b = 0; b < n; ++b)
+				{
+					order.push_back(b);
+				}
+				std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+					return buckets[a].size() > buckets[b].size();
+				});
+
+				size_t next = 0;
+				for (; next < order.size(); ++next)
+				{
+					std::vector<uint32_t>& bucket = buckets[order[next]];
+					if (bucket.size() <= 1)
+					{
+						break;
+					}
+
+					std::vector<uint32_t> taken;
+					for (uint32_t d = 1; ; ++d)
+					{
+						taken.clear();
+						for (auto key = bucket.begin(); key != bucket.end(); ++key)
+						{
+							uint32_t slot = static_cast<uint32_t>(hash(*key, d) % n);
+							if (used[slot] || std::find(taken.begin(), taken.end(), slot) != taken.end())
+							{
+								break;
+							}
+							taken.push_back(slot);
+						}
+
+						if (taken.size() == bucket.size())
+						{
+							for (size_t i = 0; i < bucket.size(); ++i)
+							{
+								used[taken[i]] = true;
+								slots[taken[i]] = bucket[i];
+							}
+							disp[order[next]] = static_cast<int32_t>(d);
+							break;
+						}
+					}
+				}
+
+				// 剩下的单键桶直接放进空槽
+				uint32_t freeSlot = 0;
+				for (; next < order.size(); ++next)
+				{
+					std::vector<uint32_t>& bucket = buckets[order[next]];
+					if (bucket.empty())
+					{
+						break;
+					}
+
+					while (used[freeSlot])
+					{
+						freeSlot++;
+					}
+					used[freeSlot] = true;
+					slots[freeSlot] = bucket[0];
+					disp[order[next]] = -static_cast<int32_t>(freeSlot) - 1;
+				}
+			}
+
+
+			// 按 8 字节对齐追加一张表，返回其偏移
+			template <typename T>
+			static uint32_t appendTable(std::vector<char>& image, const std::vector<T>& table)
+			{
+				while (image.size() % 8 != 0)
+				{
+					image.push_back('\0');
+				}
+
+				uint32_t offset = static_cast<uint32_t>(image.size());
+				if (!table.empty())
+				{
+					const char* bytes = reinterpret_cast<const char*>(table.data());
+					image.insert(image.end(), bytes, bytes + table.size() * sizeof(T));
+				}
+				return offset;
+			}
+
+
+			INIFrozenFile INIFile::freeze()
+			{
+				compactSections();
+				return INIFrozenFile::build(sectionsCache, path);
+			}
+
+
+			INIFrozenFile::INIFrozenFile()
+			{
+				std::vector<INISection> none;
+				*this = build(none, "");
+			}
+
+
+			INIFrozenFile::INIFrozenFile(std::shared_ptr<const void> owner, const char* image)
+				: storage(owner), base(image)
+			{
+			}
+
+
+			// 表 [offset, offset + count * width) 是否落在镜像内
+			static inline bool tableInRange(uint32_t offset, uint32_t count, size_t width, uint32_t size)
+			{
+				return offset <= size && static_cast<uint64_t>(count) * width <= size - offset;
+			}
+
+
+			// 字符串 [offset, offset + length] 是否落在镜像内，且以 '\0' 结尾
+			static inline bool stringInRange(const char* data, uint32_t offset, uint32_t length, uint32_t size)
+			{
+				return offset < size && length < size - offset && data[offset + length] == '\0';
+			}
+
+
+			// 位移表和槽位表中的值都要落在 [0, count) 内
+			static bool hashInRange(const int32_t* disp, const uint32_t* slots, uint32_t count)
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (slots[i] >= count || (disp[i] < 0 && -static_cast<int64_t>(disp[i]) - 1 >= count))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+
+			INIFrozenFile INIFrozenFile::attach(std::shared_ptr<const void> owner, const char* data, size_t size)
+			{
+				if (size < sizeof(INIFrozenHeader))
+				{
+					throw INIException(ERR_INVALID_IMAGE, "frozen image is truncated");
+				}
+
+				INIFrozenHeader head;
+				memcpy(&head, data, sizeof(head));
+				if (memcmp(head.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC)) != 0)
+				{
+					throw INIException(ERR_INVALID_IMAGE, "not a frozen INI image");
+				}
+				if (head.size > size
+					|| !tableInRange(head.sections, head.sectionCount, sizeof(INIFrozenSection), head.size)
+					|| !tableInRange(head.items, head.itemCount, sizeof(INIFrozenItem), head.size)
+					|| !tableInRange(head.sectionDisp, head.sectionCount, sizeof(int32_t), head.size)
+					|| !tableInRange(head.sectionSlots, head.sectionCount, sizeof(uint32_t), head.size)
+					|| !tableInRange(head.itemDisp, head.itemCount, sizeof(int32_t), head.size)
+					|| !tableInRange(head.itemSlots, head.itemCount, sizeof(uint32_t), head.size)
+					|| (head.sections | head.items | head.sectionDisp | head.sectionSlots | head.itemDisp | head.itemSlots) % 4 != 0)
+				{
+					throw INIException(ERR_INVALID_IMAGE, "frozen image is corrupted");
+				}
+
+				// 表内的偏移、下标也逐个检查一遍，之后的查找不再做任何边界检查
+				const INIFrozenSection* sections = reinterpret_cast<const INIFrozenSection*>(data + head.sections);
+				const INIFrozenItem* items = reinterpret_cast<const INIFrozenItem*>(data + head.items);
+				bool valid = stringInRange(data, head.path.offset, head.path.size, head.size)
+					&& hashInRange(reinterpret_cast<const int32_t*>(data + head.sectionDisp), reinterpret_cast<const uint32_t*>(data + head.sectionSlots), head.sectionCount)
+					&& hashInRange(reinterpret_cast<const int32_t*>(data + head.itemDisp), reinterpret_cast<const uint32_t*>(data + head.itemSlots), head.itemCount);
+
+				for (uint32_t i = 0; valid && i < head.sectionCount; ++i)
+				{
+					const INIFrozenSection& sect = sections[i];
+					valid = stringInRange(data, sect.name.offset, sect.name.size, head.size)
+						&& stringInRange(data, sect.comment.offset, sect.comment.size, head.size)
+						&& stringInRange(data, sect.rightComment.offset, sect.rightComment.size, head.size)
+						&& static_cast<uint64_t>(sect.firstItem) + sect.itemCount <= head.itemCount;
+				}
+
+				for (uint32_t i = 0; valid && i < head.itemCount; ++i)
+				{
+					const INIFrozenItem& item = items[i];
+					valid = stringInRange(data, item.key.offset, item.key.size, head.size)
+						&& stringInRange(data, item.value.offset, item.value.size, head.size)
+						&& stringInRange(data, item.comment.offset, item.comment.size, head.size)
+						&& stringInRange(data, item.rightComment.offset, item.rightComment.size, head.size)
+						&& item.section < head.sectionCount;
+				}
+
+				if (!valid)
+				{
+					throw INIException(ERR_INVALID_IMAGE, "frozen image is corrupted");
+				}
+
+				return INIFrozenFile(owner, data);
+			}
+
+
+			INIFrozenFile INIFrozenFile::build(std::vector<INISection>& sections, const std::string& path)
+			{
+				std::vector<INIFrozenSection> sectionTable;
+				std::vector<INIFrozenItem> itemTable;
+				std::vector<char> pool;
+				std::unordered_set<std::string> sectionNames;
+
+				auto intern = [&pool](const std::string& value) {
+					INIFrozenRef ref;
+					ref.offset = static_cast<uint32_t>(pool.size());
+					ref.size = static_cast<uint32_t>(value.size());
+					pool.insert(pool.end(), value.begin(), value.end());
+					pool.push_back('\0');
+					return ref;
+				};
+
+				// 重复的段和键只保留第一个，与 INIFile 的查找结果一致
+				for (auto sect = sections.begin(); sect != sections.end(); ++sect)
+				{
+					if (!sectionNames.insert(sect->getName()).second)
+					{
+						continue;
+					}
+
+					INIFrozenSection frozen;
+					std::unordered_set<std::string> keys;
+					frozen.name = intern(sect->getName());
+					frozen.comment = intern(sect->getComment());
+					frozen.rightComment = intern(sect->getRightComment());
+					frozen.firstItem = static_cast<uint32_t>(itemTable.size());
+
+					for (auto item = sect->begin(); item != sect->end(); ++item)
+					{
+						if (!keys.insert(item->key).second)
+						{
+							continue;
+						}
+
+						INIFrozenItem frozenItem;
+						frozenItem.key = intern(item->key);
+						frozenItem.value = intern(item->value);
+						frozenItem.comment = intern(item->comment);
+						frozenItem.rightComment = intern(item->rightComment);
+						frozenItem.section = static_cast<uint32_t>(sectionTable.size());
+						itemTable.push_back(frozenItem);
+					}
+
+					frozen.itemCount = static_cast<uint32_t>(itemTable.size()) - frozen.firstItem;
+					sectionTable.push_back(frozen);
+				}
+				INIFrozenRef pathRef = intern(path);
+
+				uint32_t sectionCount = static_cast<uint32_t>(sectionTable.size());
+				uint32_t itemCount = static_cast<uint32_t>(itemTable.size());
+				std::vector<int32_t> sectionDisp, itemDisp;
+				std::vector<uint32_t> sectionSlots, itemSlots;
+
+				buildPerfectHash(sectionCount, [&](uint32_t i, uint32_t d) {
+					const INIFrozenRef& name = sectionTable[i].name;
+					return frozenHash(pool.data() + name.offset, name.size, 0, d);
+				}, sectionDisp, sectionSlots);
+
+				buildPerfectHash(itemCount, [&](uint32_t i, uint32_t d) {
+					const INIFrozenRef& key = itemTable[i].key;
+					return frozenHash(pool.data() + key.offset, key.size, sectionSalt(itemTable[i].section), d);
+				}, itemDisp, itemSlots);
+
+				// 拼装成一整块：头部、各张表、字符串池
+				std::shared_ptr<std::vector<char>> image = std::make_shared<std::vector<char>>(sizeof(INIFrozenHeader), '\0');
+				INIFrozenHeader head;
+				memset(&head, 0, sizeof(head));
+				memcpy(head.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC));
+				head.sectionCount = sectionCount;
+				head.itemCount = itemCount;
+				head.sections = appendTable(*image, sectionTable);
+				head.items = appendTable(*image, itemTable);
+				head.sectionDisp = appendTable(*image, sectionDisp);
+				head.sectionSlots = appendTable(*image, sectionSlots);
+				head.itemDisp = appendTable(*image, itemDisp);
+				head.itemSlots = appendTable(*image, itemSlots);
+
+				uint32_t poolOffset = appendTable(*image, pool);
+				for (auto it = sectionTable.begin(); it != sectionTable.end(); ++it)
+				{
+					it->name.offset += poolOffset;
+					it->comment.offset += poolOffset;
+					it->rightComment.offset += poolOffset;
+				}
+				for (auto it = itemTable.begin(); it != itemTable.end(); ++it)
+				{
+					it->key.offset += poolOffset;
+					it->value.offset += poolOffset;
+					it->comment.offset += poolOffset;
+					it->rightComment.offset += poolOffset;
+				}
+				if (!sectionTable.empty())
+				{
+					memcpy(image->data() + head.sections, sectionTable.data(), sectionTable.size() * sizeof(INIFrozenSection));
+				}
+				if (!itemTable.empty())
+				{
+					memcpy(image->data() + head.items, itemTable.data(), itemTable.size() * sizeof(INIFrozenItem));
+				}
+
+				head.path = pathRef;
+				head.path.offset += poolOffset;
+				head.size = static_cast<uint32_t>(image->size());
+				memcpy(image->data(), &head, sizeof(head));
+
+				return INIFrozenFile(image, image->data());
+			}
+
+
+			const INIFrozenFile::INIFrozenHeader* INIFrozenFile::header() const
+			{
+				return at<INIFrozenHeader>(0);
+			}
+
+
+			const INIFrozenFile::INIFrozenSection* INIFrozenFile::findSection(const char* section, size_t sectionLen) const
+			{
+				const INIFrozenHeader* head = header();
+				uint32_t n = head->sectionCount;
+				if (n == 0)
+				{
+					return NULL;
+				}
+
+				int32_t d = at<int32_t>(head->sectionDisp)[frozenHash(section, sectionLen, 0, 0) % n];
+				uint32_t slot = d < 0 ? static_cast<uint32_t>(-d - 1) : static_cast<uint32_t>(frozenHash(section, sectionLen, 0, d) % n);
+				const INIFrozenSection* sect = at<INIFrozenSection>(head->sections) + at<uint32_t>(head->sectionSlots)[slot];
+
+				// 完美哈希只保证已有的键不冲突，不存在的键也会落到某个槽上，需要比较一次
+				if (sect->name.size != sectionLen || memcmp(base + sect->name.offset, section, sectionLen) != 0)
+				{
+					return NULL;
+				}
+				return sect;
+			}
+
+
+			const INIFrozenFile::INIFrozenItem* INIFrozenFile::findItem(const char* section, size_t sectionLen, const char* key, size_t keyLen) const
+			{
+				const INIFrozenHeader* head = header();
+				const INIFrozenSection* sect = findSection(section, sectionLen);
+				uint32_t n = head->itemCount;
+				if (sect == NULL || n == 0)
+				{
+					return NULL;
+				}
+
+				uint64_t salt = sectionSalt(static_cast<uint32_t>(sect - at<INIFrozenSection>(head->sections)));
+				int32_t d = at<int32_t>(head->itemDisp)[frozenHash(key, keyLen, salt, 0) % n];
+				uint32_t slot = d < 0 ? static_cast<uint32_t>(-d - 1) : static_cast<uint32_t>(frozenHash(key, keyLen, salt, d) % n);
+				const INIFrozenItem* item = at<INIFrozenItem>(head->items) + at<uint32_t>(head->itemSlots)[slot];
+
+				if (item->key.size != keyLen || memcmp(base + item->key.offset, key, keyLen) != 0
+					|| at<INIFrozenSection>(head->sections) + item->section != sect)
+				{
+					return NULL;
+				}
+				return item;
+			}
+
+
+			std::string INIFrozenFile::str(const INIFrozenRef& ref) const
+			{
+				return std::string(base + ref.offset, ref.size);
+			}
+
+
+			const char* INIFrozenFile::getValue(const char* section, size_t sectionLen, const char* key, size_t keyLen, size_t* valueLen) const
+			{
+				const INIFrozenItem* item = findItem(section, sectionLen, key, keyLen);
+				if (item == NULL)
+				{
+					return NULL;
+				}
+				if (valueLen != NULL)
+				{
+					*valueLen = item->value.size;
+				}
+				return base + item->value.offset;
+			}
+
+
+			const char* INIFrozenFile::getValue(const std::string& section, const std::string& key, size_t* valueLen) const
+			{
+				return getValue(section.data(), section.size(), key.data(), key.size(), valueLen);
+			}
+
+
+			const char* INIFrozenFile::getValue(const char* section, const char* key, size_t* valueLen) const
+			{
+				return getValue(section, strlen(section), key, strlen(key), valueLen);
+			}
+
+
+			const char* INIFrozenFile::getComment(const std::string& section, const std::string& key) const
+			{
+				if (key == "")
+				{
+					const INIFrozenSection* sect = findSection(section.data(), section.size());
+					return sect == NULL ? NULL : base + sect->comment.offset;
+				}
+
+				const INIFrozenItem* item = findItem(section.data(), section.size(), key.data(), key.size());
+				return item == NULL ? NULL : base + item->comment.offset;
+			}
+
+
+			const char* INIFrozenFile::getRightComment(const std::string& section, const std::string& key) const
+			{
+				if (key == "")
+				{
+					const INIFrozenSection* sect = findSection(section.data(), section.size());
+					return sect == NULL ? NULL : base + sect->rightComment.offset;
+				}
+
+				const INIFrozenItem* item = findItem(section.data(), section.size(), key.data(), key.size());
+				return item == NULL ? NULL : base + item->rightComment.offset;
+			}
+
+
+			std::string INIFrozenFile::getStringValue(const std::string& section, const std::string& key) const
+			{
+				size_t len;
+				const char* value = getValue(section, key, &len);
+				if (value == NULL)
+				{
+					throw INIException(ERR_NOT_FOUND_KEY, std::string("not found key `") + key + "`");
+				}
+				return std::string(value, len);
+			}
+
+
+			std::string INIFrozenFile::getStringValueOrDefault(const std::string& section, const std::string& key, const std::string& defaultValue) const
+			{
+				size_t len;
+				const char* value = getValue(section, key, &len);
+				if (value == NULL || len == 0)
+				{
+					return defaultValue;
+				}
+				return std::string(value, len);
+			}
+
+
+			bool INIFrozenFile::hasSection(const std::string& section) const
+			{
+				return findSection(section.data(), section.size()) != NULL;
+			}
+
+
+			bool INIFrozenFile::hasKey(const std::string& section, const std::string& key) const
+			{
+				return findItem(section.data(), section.size(), key.data(), key.size()) != NULL;
+			}
+
+
+			size_t INIFrozenFile::sectionCount() const
+			{
+				return header()->sectionCount;
+			}
+
+
+			std::vector<std::string> INIFrozenFile::getSectionNames() const
+			{
+				std::vector<std::string> names;
+				const INIFrozenSection* sections = at<INIFrozenSection>(header()->sections);
+				for (uint32_t i = 0; i < header()->sectionCount; ++i)
+				{
+					names.push_back(str(sections[i].name));
+				}
+				return names;
+			}
+
+
+			std::vector<std::string> INIFrozenFile::getKeys(const std::string& section) const
+			{
+				std::vector<std::string> keys;
+				const INIFrozenSection* sect = findSection(section.data(), section.size());
+				if (sect == NULL)
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+
+				const INIFrozenItem* items = at<INIFrozenItem>(header()->items) + sect->firstItem;
+				for (uint32_t i = 0; i < sect->itemCount; ++i)
+				{
+					keys.push_back(str(items[i].key));
+				}
+				return keys;
+			}
+
+
+			std::vector<std::pair<std::string, std::string>> INIFrozenFile::getEntries(const std::string& section) const
+			{
+				std::vector<std::pair<std::string, std::string>> entries;
+				const INIFrozenSection* sect = findSection(section.data(), section.size());
+				if (sect == NULL)
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+
+				const INIFrozenItem* items = at<INIFrozenItem>(header()->items) + sect->firstItem;
+				for (uint32_t i = 0; i < sect->itemCount; ++i)
+				{
+					entries.push_back({ str(items[i].key), str(items[i].value) });
+				}
+				return entries;
+			}
+
+
+			std::string INIFrozenFile::getPath() const
+			{
+				return str(header()->path);
+			}
+
+
+			const char* INIFrozenFile::data() const
+			{
+				return base;
+			}
+
+
+			size_t INIFrozenFile::size() const
+			{
+				return header()->size;
+			}
+
+
+		};
+	};
+};
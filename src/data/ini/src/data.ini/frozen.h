@@ -0,0 +1,136 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_FROZEN_H_
+#define _TFC_DATA_FORMAT_INI_FROZEN_H_
+
+#include "ini.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			/*
+			* 冻结后的只读 INI 文件
+			* 所有内容打包在一块连续内存里，内部只使用相对偏移，可以整体复制或映射；
+			* 段名和 (段, 键) 由冻结时构建的最小完美哈希索引，查找不分配内存
+			*/
+			class INIFrozenFile
+			{
+			public:
+				INIFrozenFile();
+
+				// 由 INIFile::freeze() 调用
+				static INIFrozenFile build(std::vector<INISection>& sections, const std::string& path);
+
+				/*
+				* 直接使用 data 处已有的一份镜像（如映射进来的文件或共享内存），不复制；
+				* owner 持有这块内存，最后一个引用它的 INIFrozenFile 销毁时一并释放。
+				* 附加时检查镜像的标识、大小、各张表的范围以及表内每个偏移和下标，不对时抛出 ERR_INVALID_IMAGE；
+				* 检查只做这一次，附加之后镜像不能再被改写
+				*/
+				static INIFrozenFile attach(std::shared_ptr<const void> owner, const char* data, size_t size);
+
+			public:
+
+				/*
+				* 获取内容，未找到时返回 NULL，返回的字符串以 '\0' 结尾
+				*/
+
+				const char* getValue(const char* section, size_t sectionLen, const char* key, size_t keyLen, size_t* valueLen = NULL) const;
+				const char* getValue(const std::string& section, const std::string& key, size_t* valueLen = NULL) const;
+				const char* getValue(const char* section, const char* key, size_t* valueLen = NULL) const;
+
+				const char* getComment(const std::string& section, const std::string& key) const;
+				const char* getRightComment(const std::string& section, const std::string& key) const;
+
+				// 未找到时抛出 INIException，与 INIFile 一致
+				std::string getStringValue(const std::string& section, const std::string& key) const;
+				std::string getStringValueOrDefault(const std::string& section, const std::string& key, const std::string& defaultValue) const;
+
+				bool hasSection(const std::string& section) const;
+				bool hasKey(const std::string& section, const std::string& key) const;
+
+				// 按文件顺序访问
+				size_t sectionCount() const;
+				std::vector<std::string> getSectionNames() const;
+				std::vector<std::string> getKeys(const std::string& section) const;
+				std::vector<std::pair<std::string, std::string>> getEntries(const std::string& section) const;
+
+				std::string getPath() const;
+
+				// 整块内容
+				const char* data() const;
+				size_t size() const;
+
+			private:
+				struct INIFrozenRef
+				{
+					uint32_t offset;
+					uint32_t size;
+				};
+
+				struct INIFrozenSection
+				{
+					INIFrozenRef name;
+					INIFrozenRef comment;
+					INIFrozenRef rightComment;
+					uint32_t firstItem;
+					uint32_t itemCount;
+				};
+
+				struct INIFrozenItem
+				{
+					INIFrozenRef key;
+					INIFrozenRef value;
+					INIFrozenRef comment;
+					INIFrozenRef rightComment;
+					uint32_t section;
+				};
+
+				struct INIFrozenHeader
+				{
+					char magic[8];
+					uint32_t size;
+					uint32_t sectionCount;
+					uint32_t itemCount;
+					uint32_t sections;      // INIFrozenSection[sectionCount]
+					uint32_t items;         // INIFrozenItem[itemCount]
+					uint32_t sectionDisp;   // int32_t[sectionCount]，最小完美哈希的位移表
+					uint32_t sectionSlots;  // uint32_t[sectionCount]，槽位 -> 段下标
+					uint32_t itemDisp;      // int32_t[itemCount]
+					uint32_t itemSlots;     // uint32_t[itemCount]，槽位 -> 项下标
+					INIFrozenRef path;
+				};
+
+				template <typename T>
+				const T* at(uint32_t offset) const
+				{
+					return reinterpret_cast<const T*>(base + offset);
+				}
+
+				INIFrozenFile(std::shared_ptr<const void> owner, const char* image);
+
+				const INIFrozenHeader* header() const;
+				const INIFrozenSection* findSection(const char* section, size_t sectionLen) const;
+				const INIFrozenItem* findItem(const char* section, size_t sectionLen, const char* key, size_t keyLen) const;
+				std::string str(const INIFrozenRef& ref) const;
+
+			private:
+				std::shared_ptr<const void> storage;
+				const char* base;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_FROZEN_H_
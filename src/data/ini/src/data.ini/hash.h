@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_HASH_H_
+#define _TFC_DATA_FORMAT_INI_HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			const uint64_t INI_HASH_SEED = 14695981039346656037ULL;
+
+			// 64 位 FNV-1a 哈希，seed 传入上一次的结果即可分段连续计算
+			inline uint64_t hashBytes(const char* data, size_t size, uint64_t seed = INI_HASH_SEED)
+			{
+				uint64_t h = seed;
+				for (size_t i = 0; i < size; ++i)
+				{
+					h ^= static_cast<unsigned char>(data[i]);
+					h *= 1099511628211ULL;
+				}
+				return h;
+			}
+
+
+			// 64 位整数的雪崩混合，使相加组合的哈希不会因输入相近而相互抵消
+			inline uint64_t mixHash(uint64_t h)
+			{
+				h ^= h >> 30;
+				h *= 0xbf58476d1ce4e5b9ULL;
+				h ^= h >> 27;
+				h *= 0x94d049bb133111ebULL;
+				h ^= h >> 31;
+				return h;
+			}
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_HASH_H_
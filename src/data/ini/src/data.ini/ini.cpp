@@ -1,4 +1,6 @@
 #include "ini.h"
+#include "encoding.h"
+#include "writer.h"
 
 namespace tfc
 {
@@ -6,6 +8,9 @@ namespace tfc
 	{
 		namespace ini
 		{
+			static const size_t NO_SECTION = static_cast<size_t>(-1);
+
+
 			void INIFile::customBooleans(std::string b0, std::string b1)
 			{
 				beBooleans.push_back({ b0, b1 });
@@ -19,6 +24,11 @@ namespace tfc
 
 				for (INISectionIterator it = sectionsCache.begin(); it != sectionsCache.end(); ++it)
 				{
+					if (it->removed)
+					{
+						continue;
+					}
+
 					printf("comment :[\n%s]\n", it->getComment().c_str());
 					printf("section :\n[%s]\n", it->getName().c_str());
 					if (it->getRightComment() != "")
@@ -26,7 +36,7 @@ namespace tfc
 						printf("rightComment:\n%s", it->getRightComment().c_str());
 					}
 
-					for (INISection::INIItemIterator i = it->getItems().begin(); i != it->getItems().end(); ++i)
+					for (INISection::INIItemIterator i = it->begin(); i != it->end(); ++i)
 					{
 						printf("    comment :[\n%s]\n", i->comment.c_str());
 						printf("    parm    :%s=%s\n", i->key.c_str(), i->value.c_str());
@@ -42,31 +52,75 @@ namespace tfc
 			}
 
 
-			ININativeValue INIFile::getValue(std::string section, std::string key)
+			INISection& INIFile::requireSection(const std::string& section)
 			{
-				INISection sect;
-				ININativeValue nativeValue;
-				
-				sect = getSection(section);
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+				return *sect;
+			}
 
-				for (auto it = sect.begin(); it != sect.end(); ++it)
+
+			const std::string* INIFile::lookupRawValue(const std::string& section, const std::string& key, bool required)
+			{
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
 				{
-					if (it->key == key)
+					if (!required)
+					{
+						return NULL;
+					}
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+
+				INISection::INIItemIterator it = sect->findItem(key);
+				if (it == sect->end())
+				{
+					if (!required)
 					{
-						std::cout << it->key << std::endl;
-						nativeValue.value = it->value;
-						nativeValue.comment = it->comment;
-						return nativeValue;
+						return NULL;
 					}
+					throw INIException(ERR_NOT_FOUND_KEY, std::string("not found key `") + key + "`");
 				}
+				return &it->value;
+			}
+
 
-				throw INIException(ERR_NOT_FOUND_KEY, std::string("not found key `") + key + "`");
+			const std::string* INIFile::lookupValue(const std::string& section, const std::string& key, bool required)
+			{
+				const std::string* raw = lookupRawValue(section, key, required);
+				if (raw != NULL && interpolationEnabled)
+				{
+					return &resolveValue(section, key, *raw);
+				}
+				return raw;
+			}
+
+
+			bool INIFile::matchBoolean(const std::string& value, bool& result)
+			{
+				for (auto i = beBooleans.begin(); i != beBooleans.end(); ++i)
+				{
+					if (value == i->first)
+					{
+						result = true;
+						return true;
+					}
+					else if (value == i->second)
+					{
+						result = false;
+						return true;
+					}
+				}
+				return false;
 			}
 
 
 			void INIFile::setValue(std::string section, std::string key, std::string value, std::string comment)
 			{
-				INISection sect;
+				INISectionIterator sect;
 				std::string comt = comment;
 
 				if (comt != "")
@@ -74,17 +128,15 @@ namespace tfc
 					comt = '\n' + comt;
 				}
 
-				try
-				{
-					sect = getSection(section);
-				}
-				catch (const std::exception&)
+				sect = findSection(section);
+				if (sect == sectionsCache.end())
 				{
 
-					//βڣ½һ
+					//如果段不存在，新建一个
+					INISection newSection;
 					try
 					{
-						sect = INISection();
+						newSection = INISection();
 					}
 					catch (const std::exception&)
 					{
@@ -92,36 +144,50 @@ namespace tfc
 					}
 					
 
-					sect.setName(section);
-					if (sect.getName() == "")
+					newSection.setName(section);
+					if (newSection.getName() == "")
 					{
 
-						// ȷsectionʼλλ
-						sectionsCache.insert(sectionsCache.begin(), sect);
+						// 确保空section始终位于首位
+						sect = sectionsCache.insert(sectionsCache.begin(), newSection);
 					}
 					else
 					{
-						sectionsCache.push_back(sect);
+						sect = sectionsCache.insert(sectionsCache.end(), newSection);
 					}
+					attachSection(sect - sectionsCache.begin());
+					updateFingerprint(0, sect->fingerprint());
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end(); ++it)
+				uint64_t before = sect->fingerprint();
+				INISection::INIItemIterator it = sect->findItem(key);
+				if (it != sect->end())
 				{
-					if (it->key == key)
+					std::string oldValue = it->value;
+					sect->setValue(it, value);
+
+					// 只更新值的调用不传注释，保留原有的注释
+					if (!comt.empty())
 					{
-						it->value = value;
 						it->comment = comt;
-						return;
 					}
+					updateFingerprint(before, sect->fingerprint());
+					if (oldValue != value)
+					{
+						notify(INI_KEY_SET, section, key, oldValue, value);
+					}
+					return;
 				}
 
-				// ûз key
+				// 没有发现 key
 				INIItem item;
 				item.key = key;
 				item.value = value;
 				item.comment = comt;
 
-				sect.pushItem(item);
+				sect->pushItem(item);
+				updateFingerprint(before, sect->fingerprint());
+				notify(INI_KEY_SET, section, key, "", value);
 			}
 
 
@@ -139,10 +205,9 @@ namespace tfc
 
 			INISection INIFile::updateSection(std::string cleanLine, std::string comment, std::string rightComment)
 			{
-				debug()
 				INISection newSection;
 
-				// 
+				// 查找右中括号
 				size_t index = cleanLine.find_first_of(']');
 
 				if (index == std::string::npos) {
@@ -151,28 +216,29 @@ namespace tfc
 
 				int len = index - 1;
 
-				// Ϊգһ
+				// 若段名为空，继续下一行
 				if (len <= 0) {
 					throw INIException(ERR_SECTION_EMPTY, std::string("section name is empty"));
 				}
 
-				// ȡ
+				// 取段名
 				std::string s(cleanLine, 1, len);
-				trim(s);
+				s = trim(s);
 
-				// Ϊ
+				// 段名不允许为空
 				if (s == "")
 				{
 					throw INIException(ERR_SECTION_ALREADY_EXISTS, "invalid empty section name");
 				}
 
-				// 
+				// 填充段名
 				newSection.setName(s);
 
-				// οͷע
+				// 填充段开头的注释
 				newSection.setComment(comment);
 				newSection.setRightComment(rightComment);
 				sectionsCache.push_back(newSection);
+				attachSection(sectionsCache.size() - 1);
 				return newSection;
 			}
 
@@ -209,8 +275,8 @@ namespace tfc
 					left = std::string(line, 0, pos);
 					right = std::string(line, pos + 1);
 
-					trim(left);
-					trim(right);
+					left = trim(left);
+					right = trim(right);
 
 					pair.first = left;
 					pair.second = right;
@@ -220,7 +286,7 @@ namespace tfc
 					left = line;
 					right = "";
 
-					trim(left);
+					left = trim(left);
 
 					pair.first = left;
 					pair.second = right;
@@ -321,6 +387,14 @@ namespace tfc
 			void INIFile::release()
 			{
 				sectionsCache.clear();
+				removedSections = 0;
+				fileHashValid = false;
+				clearResolved();
+				sectionIndexValid = false;
+				if (sectionTreeEnabled)
+				{
+					rebuildSectionTree();
+				}
 				path = "";
 			}
 
@@ -330,7 +404,7 @@ namespace tfc
 				beBooleans.push_back({ "true", "false" });
 				beBooleans.push_back({ "yes", "no" });
 				beBooleans.push_back({ "on", "off" });
-				beBooleans.push_back({ "0", "1" });
+				beBooleans.push_back({ "1", "0" });
 			}
 
 
@@ -340,57 +414,122 @@ namespace tfc
 			}
 
 
+			int INIFile::readFile(std::string filePath, std::string& content)
+			{
+				std::ifstream ifs(filePath, std::ios::in | std::ios::binary);
+				if (!ifs.is_open()) {
+					return ERR_OPEN_FILE_FAILED;
+				}
+
+				// 一次读入整个文件，避免逐行读取的多次系统调用
+				ifs.seekg(0, std::ios::end);
+				std::streamoff size = ifs.tellg();
+				ifs.seekg(0, std::ios::beg);
+
+				if (size > 0)
+				{
+					content.resize(static_cast<size_t>(size));
+					ifs.read(&content[0], size);
+					content.resize(static_cast<size_t>(ifs.gcount()));
+				}
+				else
+				{
+					content.clear();
+				}
+
+				ifs.close();
+				return RET_OK;
+			}
+
+
 			int INIFile::load(std::string filePath)
 			{
-				debug();
-				int errorValue;
-				std::string line;       // ע͵
-				std::string cleanLine;  // ȥעͺ
+				std::string content;
+
+				if (readFile(filePath, content) != RET_OK)
+				{
+					INIWatchSnapshot snapshot = snapshotWatched();
+					release();
+					path = filePath;
+					notifyReload(snapshot);
+					return ERR_OPEN_FILE_FAILED;
+				}
+
+				return loadFromMemory(filePath, content);
+			}
+
+
+			int INIFile::loadFromMemory(std::string filePath, const std::string& content)
+			{
+				int errorValue = RET_OK;
+				std::string line;       // 带注释的行
+				std::string cleanLine;  // 去掉注释后的行
 				std::string comment;
 				std::string rightComment;
-				INISection currSection;  // ʼһֶָ
+				INISection currSection;  // 初始化一个字段指针
+				std::string decoded;
+				const std::string* text = &content;
+				size_t lineBegin = 0;
+				size_t lineNumber = 0;
+
+				// 重新加载前记下被订阅段的内容，加载完后只通知真正变化的键
+				INIWatchSnapshot snapshot = snapshotWatched();
 
 				release();
 
 				path = filePath;
-				std::ifstream ifs(path);
-				if (!ifs.is_open()) {
-					return ERR_OPEN_FILE_FAILED;
+
+				// UTF-16 先整体转成 UTF-8 再解析，UTF-8 只需跳过 BOM
+				encoding = detectEncoding(content.data(), content.size(), &lineBegin);
+				if (encoding == INI_ENCODING_UTF16LE || encoding == INI_ENCODING_UTF16BE)
+				{
+					utf16ToUtf8(content.data() + lineBegin, content.size() - lineBegin, encoding == INI_ENCODING_UTF16BE, decoded);
+					text = &decoded;
+					lineBegin = 0;
 				}
 
-				//Ĭ϶Σ ""
+				//增加默认段，即 无名段""
 				currSection.setName("");
 				sectionsCache.push_back(currSection);
+				attachSection(0);
+
+				// 每次读取一行内容到line
+				while (lineBegin < text->size()) {
+					size_t lineEnd = text->find('\n', lineBegin);
+					if (lineEnd == std::string::npos) {
+						lineEnd = text->size();
+					}
 
-				// ÿζȡһݵline
-				while (std::getline(ifs, line)) {
-					trim(line);
+					line = trim(text->substr(lineBegin, lineEnd - lineBegin));
+					lineBegin = lineEnd + 1;
+					lineNumber++;
 
-					// step 0дΪ0˵ǿУӵcommentע͵һ
+					// step 0，空行处理，如果长度为0，说明是空行，添加到comment，当作是注释的一部分
 					if (line.length() <= 0) {
 						comment += '\n';
 						continue;
 					}
 
 					// step 1
-					// ײעͣβǷע
-					// עͿͷӵcommentǰѭcontinue
+					// 如果行首不是注释，查找行尾是否存在注释
+					// 如果该行以注释开头，添加到comment，跳过当前循环，continue
 					if (isCommentLine(line)) {
 						comment += line + '\n';
 						continue;
 					}
 
-					// ײעͣβǷעͣڣиУעӵrightComment
+					// 如果行首不是注释，查找行尾是否存在注释，若存在，切割该行，将注释内容添加到rightComment
 					auto commentContent = split(line, "#");
 					cleanLine = commentContent.first;
 					rightComment = commentContent.second;
 
-					// step 2жlineǷΪλ
-					//οͷ [
+					// step 2，判断line内容是否为段或键
+					//段开头查找 [
 					if (cleanLine[0] == '[') {
 						try
 						{
 							updateSection(cleanLine, comment, rightComment);
+							sectionsCache.back().line = lineNumber;
 							errorValue = RET_OK;
 						}
 						catch (INIException& e)
@@ -399,271 +538,311 @@ namespace tfc
 						}
 					}
 					else {
-						std::cout << "errorValue = addEntry(cleanLine, comment, rightComment, currSection);" << std::endl;
-						// Ǽֵӵsectionεitems
-						currSection.pushItem(addEntry(cleanLine, comment, rightComment));
+						// 如果该行是键值，添加到当前段（即最后一个段）的items容器
+						INIItem item = addEntry(cleanLine, comment, rightComment);
+						item.line = lineNumber;
+						if (multilineEnabled)
+						{
+							INIValueLayout layout;
+							lineBegin = readContinuation(*text, lineBegin, lineNumber, item.value, layout);
+							sectionsCache.back().pushItem(std::move(item), std::move(layout));
+						}
+						else
+						{
+							sectionsCache.back().pushItem(std::move(item));
+						}
 					}
 
-					sectionsCache.push_back(currSection);
-
-					// comment
+					// comment清零
 					comment = "";
 					rightComment = "";
 				}
 
-				ifs.close();
+				notifyReload(snapshot);
 				return errorValue;
 			}
 
 
+			std::future<int> INIFile::loadAsync(std::string filePath)
+			{
+				return std::async(std::launch::async, [this, filePath]() {
+					return load(filePath);
+				});
+			}
+
+
 			int INIFile::save(std::string)
 			{
 				return saveAs(path);
 			}
 
 
-			int INIFile::saveAs(std::string)
+			int INIFile::saveAs(std::string filePath)
+			{
+				return saveAs(filePath, encoding);
+			}
+
+
+			int INIFile::saveAs(std::string filePath, INIEncoding _encoding)
 			{
-				std::string data = "";
+				INIStreamWriter writer(_encoding);
+				if (!writer.open(filePath))
+				{
+					return ERR_OPEN_FILE_FAILED;
+				}
 
-				// section
+				// 直接写出段和项中的字符串，不拼接临时串
 				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
 				{
-					if (sect->getComment() != "")
+					if (sect->removed)
 					{
-						data += sect->getComment();
+						continue;
 					}
 
-					if (sect->getName() != "")
-					{
-						data += std::string("[") + sect->getName() + std::string("]");
-						data += '\n';
-					}
+					writer.write(sect->comment);
 
-					if (sect->getRightComment() != "")
+					if (!sect->name.empty())
 					{
-						data += " #" + sect->getRightComment();
+						writer.put('[');
+						writer.write(sect->name);
+						writer.put(']');
+
+						if (!sect->rightComment.empty())
+						{
+							writer.write(" #", 2);
+							writer.write(sect->rightComment);
+						}
+						writer.put('\n');
 					}
 
-					//  item 
-					for (INISection::INIItemIterator item = sect->getItems().begin(); item != sect->getItems().end(); ++item)
+					// 写出 item 数据
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
 					{
-						if (item->comment != "")
+						if (!item->comment.empty())
 						{
-							data += item->comment;
-							if (data[data.length() - 1] != '\n')
+							writer.write(item->comment);
+							if (writer.last() != '\n')
 							{
-								data += '\n';
+								writer.put('\n');
 							}
 						}
 
-						data += item->key + "=" + item->value;
+						writer.write(item->key);
+						writer.put('=');
+						writer.writeValue(item->value, item->rightComment, sect->valueLayout(item));
 
-						if (item->rightComment != "")
+						if (writer.last() != '\n')
 						{
-							data += " #" + item->rightComment;
-						}
-
-						if (data[data.length() - 1] != '\n')
-						{
-							data += '\n';
+							writer.put('\n');
 						}
 					}
 				}
 
-				std::ofstream ofs(path);
-				ofs << data;
-				ofs.close();
-				return 0;
+				if (!writer.close())
+				{
+					return ERR_WRITE_FILE_FAILED;
+				}
+				return RET_OK;
 			}
 
 
-			std::string INIFile::getStringValue(std::string section, std::string key)
+			INIEncoding INIFile::getEncoding()
 			{
-				return getValue(section, key).value;
+				return encoding;
 			}
 
 
-			std::string INIFile::getStringValue(std::string key)
+			void INIFile::setEncoding(INIEncoding _encoding)
 			{
-				return getValue("", key).value;
+				encoding = _encoding;
 			}
 
 
-			std::string INIFile::getStringValueOrDefault(std::string section, std::string key, std::string defaultValue)
+			std::string INIFile::getStringValue(const std::string& section, const std::string& key)
 			{
-				std::string s = getStringValue(section, key);
-				if (s == "")
+				return *lookupValue(section, key, true);
+			}
+
+
+			std::string INIFile::getStringValue(const std::string& key)
+			{
+				return getStringValue("", key);
+			}
+
+
+			std::string INIFile::getStringValueOrDefault(const std::string& section, const std::string& key, const std::string& defaultValue)
+			{
+				const std::string* value = lookupValue(section, key, false);
+				if (value == NULL || value->empty())
 				{
 					return defaultValue;
 				}
-				return s;
+				return *value;
 			}
 
-			std::string INIFile::getStringValueOrDefault(std::string key, std::string defaultValue)
+			std::string INIFile::getStringValueOrDefault(const std::string& key, const std::string& defaultValue)
 			{
 				return getStringValueOrDefault("", key, defaultValue);
 			}
 
 
-			int INIFile::getIntValue(std::string section, std::string key)
+			int INIFile::getIntValue(const std::string& section, const std::string& key)
 			{
-				return atoi(getValue(section, key).value.data());
+				return atoi(lookupValue(section, key, true)->c_str());
 			}
 
 
-			int INIFile::getIntValue(std::string key)
+			int INIFile::getIntValue(const std::string& key)
 			{
 				return getIntValue("", key);
 			}
 
-			int INIFile::getIntValueOrDefault(std::string section, std::string key, int defaultValue)
+			int INIFile::getIntValueOrDefault(const std::string& section, const std::string& key, int defaultValue)
 			{
-				return getIntValue(section, key) || defaultValue;
+				const std::string* value = lookupValue(section, key, false);
+				if (value == NULL || value->empty())
+				{
+					return defaultValue;
+				}
+				return atoi(value->c_str());
 			}
 
-			int INIFile::getIntValueOrDefault(std::string key, int defaultValue)
+			int INIFile::getIntValueOrDefault(const std::string& key, int defaultValue)
 			{
 				return getIntValueOrDefault("", key, defaultValue);
 			}
 
 
-			double INIFile::getDoubleValue(std::string section, std::string key)
+			double INIFile::getDoubleValue(const std::string& section, const std::string& key)
 			{
-				return atof(getValue(section, key).value.data());
+				return atof(lookupValue(section, key, true)->c_str());
 			}
 
 
-			double INIFile::getDoubleValue(std::string key)
+			double INIFile::getDoubleValue(const std::string& key)
 			{
 				return getDoubleValue("", key);
 			}
 
-			double INIFile::getDoubleValueOrDefault(std::string section, std::string key, double defaultValue)
+			double INIFile::getDoubleValueOrDefault(const std::string& section, const std::string& key, double defaultValue)
 			{
-				return getDoubleValue(section, key) || defaultValue;
+				const std::string* value = lookupValue(section, key, false);
+				if (value == NULL || value->empty())
+				{
+					return defaultValue;
+				}
+				return atof(value->c_str());
 			}
 
-			double INIFile::getDoubleValueOrDefault(std::string key, double defaultValue)
+			double INIFile::getDoubleValueOrDefault(const std::string& key, double defaultValue)
 			{
 				return getDoubleValueOrDefault("", key, defaultValue);
 			}
 
 
-			bool INIFile::getBoolValue(std::string section, std::string key)
+			bool INIFile::getBoolValue(const std::string& section, const std::string& key)
 			{
-				std::string value;
-				
-				getValue(section, key).value;
-				for (auto i = beBooleans.begin(); i != beBooleans.end(); ++i)
+				const std::string& value = *lookupValue(section, key, true);
+				bool result;
+				if (!matchBoolean(value, result))
 				{
-					if (value == i->first)
-					{
-						return true;
-					}
-					else if (value == i->second)
-					{
-						return false;
-					}
+					throw INIException(ERR_PARSE_KEY_VALUE_FAILED, value + " is not an expected boolean value");
 				}
-				throw INIException(ERR_PARSE_KEY_VALUE_FAILED, value + "is not an expected boolean value");
+				return result;
 			}
 
 
-			bool INIFile::getBoolValue(std::string key)
+			bool INIFile::getBoolValue(const std::string& key)
 			{
 				return getBoolValue("", key);
 			}
 
-			bool INIFile::getBoolValueOrDefault(std::string section, std::string key, bool defaultValue)
+			bool INIFile::getBoolValueOrDefault(const std::string& section, const std::string& key, bool defaultValue)
 			{
-				bool value;
-				try
-				{
-					value = getBoolValue(section, key);
-				}
-				catch (INIException& e)
+				const std::string* value = lookupValue(section, key, false);
+				bool result;
+				if (value == NULL || !matchBoolean(*value, result))
 				{
 					return defaultValue;
 				}
-				return value;
+				return result;
 			}
 
-			bool INIFile::getBoolValueOrDefault(std::string key, bool defaultValue)
+			bool INIFile::getBoolValueOrDefault(const std::string& key, bool defaultValue)
 			{
 				return getBoolValueOrDefault("", key, defaultValue);
 			}
 
-			std::string INIFile::getComment(std::string section, std::string key)
+			std::string INIFile::getRawStringValue(const std::string& section, const std::string& key)
 			{
-				INISection sect = getSection(section);
+				return *lookupRawValue(section, key, true);
+			}
+
+
+			std::string INIFile::getComment(const std::string& section, const std::string& key)
+			{
+				INISection& sect = requireSection(section);
 
 				if (key == "")
 				{
-					return sect.getComment();
+					return sect.comment;
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end(); ++it)
+				INISection::INIItemIterator it = sect.findItem(key);
+				if (it != sect.end())
 				{
-					if (it->key == key)
-					{
-						return it->comment;
-					}
+					return it->comment;
 				}
 
 				throw INIException(ERR_NOT_FOUND_KEY, std::string("key `") + key + std::string("` was not found"));
 			}
 
-			std::string INIFile::getRightComment(std::string section, std::string key)
+			std::string INIFile::getRightComment(const std::string& section, const std::string& key)
 			{
-				INISection sect = getSection(section);
+				INISection& sect = requireSection(section);
 
 				if (key == "")
 				{
-					return sect.getRightComment();
+					return sect.rightComment;
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end(); ++it)
+				INISection::INIItemIterator it = sect.findItem(key);
+				if (it != sect.end())
 				{
-					if (it->key == key)
-					{
-						return sect.getRightComment();
-					}
+					return it->rightComment;
 				}
 
 				throw INIException(ERR_NOT_FOUND_KEY, std::string("key `") + key + std::string("` was not found"));
 			}
 
 
-			std::vector<std::string> INIFile::getKeys(std::string section)
+			std::vector<std::string> INIFile::getKeys(const std::string& section)
 			{
-				return getSection(section).getKeys();				
+				return requireSection(section).getKeys();
 			}
 
 
-			std::vector<std::string> INIFile::getValues(std::string section)
+			std::vector<std::string> INIFile::getValues(const std::string& section)
 			{
-				return getSection(section).getValues();
+				return requireSection(section).getValues();
 			}
 
 
-			std::vector<std::pair<std::string, std::string>> INIFile::getEntries(std::string _section)
+			std::vector<std::pair<std::string, std::string>> INIFile::getEntries(const std::string& section)
 			{
-				INISection section = getSection(_section);
-				return section.getEntries();
+				return requireSection(section).getEntries();
 			}
 
 
-			std::vector<INIItem> INIFile::getItems(std::string _section)
+			std::vector<INIItem> INIFile::getItems(const std::string& section)
 			{
-				INISection section = getSection(_section);
-				return section.getItems();
+				return requireSection(section).getItems();
 			}
 
 
-			int INIFile::getItemsLength(std::string section)
+			int INIFile::getItemsLength(const std::string& section)
 			{
-				return getSection(section).length();
+				return requireSection(section).length();
 			}
 
 
@@ -673,44 +852,48 @@ namespace tfc
 			}
 			
 
-			INISection INIFile::getSection(std::string section)
+			INISection INIFile::getSection(const std::string& section)
 			{
-				debug();
-				std::cout << "---- INIFile::getSection ----" << std::endl;
-				std::cout << sectionsCache.size() << std::endl;
-				std::cout << sectionsCache.at(1).getKeys().size() << std::endl;
-				for (INISectionIterator i = sectionsCache.begin(); i != sectionsCache.end(); ++i)
-				{
-					std::cout << section << std::endl;
-					std::cout << i->getValues().size() << std::endl;
-					if (i->getName() == section)
-					{
-						std::cout << i->getKeys().size() << std::endl;
-						return *i;
-					}
-				}
-				debug();
-				throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				return requireSection(section);
 			}
 
 
-			std::vector<INISection> INIFile::getSections()
+			INIFile::INISectionIterator INIFile::findSection(const std::string& section)
 			{
-				std::vector<INISection> sections;
+				if (sectionTreeEnabled)
+				{
+					return findSectionInTree(section);
+				}
+				// 偶尔查找时逐个比较即可，频繁查找（如批量删除）时建立索引，之后追加和删除段都会就地维护它
+				if (!sectionIndexValid && ++sectionScans > INI_INDEX_MIN_SCANS)
+				{
+					buildSectionIndex();
+				}
+				if (sectionIndexValid)
+				{
+					return findSectionInIndex(section);
+				}
+
 				for (INISectionIterator i = sectionsCache.begin(); i != sectionsCache.end(); ++i)
 				{
-					sections.push_back(*i);
+					if (i->name == section && !i->removed)
+					{
+						return i;
+					}
 				}
-				return sections;
+				return sectionsCache.end();
 			}
 
 
-			std::vector<INISection> INIFile::getSections(std::string section, ...)
+			std::vector<INISection> INIFile::getSections()
 			{
 				std::vector<INISection> sections;
 				for (INISectionIterator i = sectionsCache.begin(); i != sectionsCache.end(); ++i)
 				{
-					sections.push_back(*i);
+					if (!i->removed)
+					{
+						sections.push_back(*i);
+					}
 				}
 				return sections;
 			}
@@ -721,33 +904,33 @@ namespace tfc
 				std::vector<std::string> sectionNames;
 				for (INISectionIterator i = sectionsCache.begin(); i != sectionsCache.end(); ++i)
 				{
-					sectionNames.push_back(i->getName());
+					if (!i->removed)
+					{
+						sectionNames.push_back(i->getName());
+					}
 				}
 				return sectionNames;
 			}
 
 
-			bool INIFile::hasSection(std::string section)
+			bool INIFile::hasSection(const std::string& section)
 			{
-				try
-				{
-					getSection(section);
-				}
-				catch (INIException&)
-				{
-					return false;
-				}
-				return true;
+				return findSection(section) != sectionsCache.end();
 			}
 
 
-			bool INIFile::hasKey(std::string section, std::string key)
+			bool INIFile::hasKey(const std::string& section, const std::string& key)
 			{
-				return getSection(section).hasKey(key);
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+				return sect->hasKey(key);
 			}
 
 
-			bool INIFile::hasKey(std::string key)
+			bool INIFile::hasKey(const std::string& key)
 			{
 				return hasKey("", key);
 			}
@@ -790,15 +973,19 @@ namespace tfc
 
 			void INIFile::setComment(std::string section, std::string key, std::string comment)
 			{
-				INISection sect = getSection(section);
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
 
 				if (key == "")
 				{
-					sect.setComment(comment);
+					sect->setComment(comment);
 					return;
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end(); ++it)
+				for (INISection::INIItemIterator it = sect->begin(); it != sect->end(); ++it)
 				{
 					if (it->key == key)
 					{
@@ -813,15 +1000,19 @@ namespace tfc
 
 			void INIFile::setRightComment(std::string section, const std::string key, std::string rightComment)
 			{
-				INISection sect = getSection(section);
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
 
 				if (key == "")
 				{
-					sect.setRightComment(rightComment);
+					sect->setRightComment(rightComment);
 					return;
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end(); ++it)
+				for (INISection::INIItemIterator it = sect->begin(); it != sect->end(); ++it)
 				{
 					if (it->key == key)
 					{
@@ -836,45 +1027,53 @@ namespace tfc
 
 			void INIFile::deleteSection(std::string section)
 			{
-				for (INISectionIterator it = sectionsCache.begin(); it != sectionsCache.end(); )
+				INISectionIterator it = findSection(section);
+				if (it == sectionsCache.end())
 				{
-					if (it->getName() == section)
-					{
-						it = sectionsCache.erase(it);
-						break;
-					}
-					else
-					{
-						it++;
-					}
+					return;
 				}
+
+				size_t position = it - sectionsCache.begin();
+				detachSection(position);
+
+				// 逐个键的通知只有订阅者和插值缓存需要，需要时把段整个移出留作通知，不复制其中的键值
+				bool notifyKeys = !watchers.empty() || !resolvedValues.empty() || !dependents.empty();
+				INISection removed;
+				if (notifyKeys)
+				{
+					removed = std::move(*it);
+				}
+				markSectionRemoved(position);
+				compactSectionsIfNeeded();
+
+				// 先通知段内每个键被删除，再通知整个段被删除
+				for (INISection::INIItemIterator item = removed.begin(); item != removed.end(); ++item)
+				{
+					notify(INI_KEY_DELETED, section, item->key, item->value, "");
+				}
+				notify(INI_SECTION_DELETED, section, "", "", "");
 			}
 
 
 			void INIFile::deleteKey(std::string section, std::string key)
 			{
-				INISection sect;
-				try
-				{
-					sect = getSection(section);
-				}
-				catch (const std::exception&)
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
 				{
 					return;
 				}
 
-				for (INISection::INIItemIterator it = sect.begin(); it != sect.end();)
+				INISection::INIItemIterator it = sect->findItem(key);
+				if (it == sect->end())
 				{
-					if (it->key == key)
-					{
-						it = sect.eraseItem(it);
-						break;
-					}
-					else
-					{
-						it++;
-					}
+					return;
 				}
+
+				std::string oldValue = it->value;
+				uint64_t before = sect->fingerprint();
+				sect->eraseItem(it);
+				updateFingerprint(before, sect->fingerprint());
+				notify(INI_KEY_DELETED, section, key, oldValue, "");
 			}
 
 
@@ -896,6 +1095,128 @@ namespace tfc
 			}
 
 
+			void INIFile::markSectionRemoved(size_t position)
+			{
+				INISection& sect = sectionsCache[position];
+				updateFingerprint(sect.fingerprint(), 0);
+				sect = INISection();
+				sect.removed = true;
+				removedSections++;
+			}
+
+
+			void INIFile::compactSectionsIfNeeded()
+			{
+				if (removedSections >= INI_COMPACT_MIN && removedSections * INI_COMPACT_RATIO >= sectionsCache.size())
+				{
+					compactSections();
+				}
+			}
+
+
+			// 保持文件顺序一次前移，前缀树中保存的是编号，只需同步 sectionIds
+			void INIFile::compactSections()
+			{
+				if (removedSections == 0)
+				{
+					return;
+				}
+
+				// 记下每个位置前移之后的位置，按名称排序的索引照此改写，不必重新排序
+				std::vector<size_t> moved;
+				if (sectionIndexValid)
+				{
+					moved.assign(sectionsCache.size(), NO_SECTION);
+				}
+
+				size_t kept = 0;
+				for (size_t i = 0; i < sectionsCache.size(); ++i)
+				{
+					if (sectionsCache[i].removed)
+					{
+						continue;
+					}
+					if (sectionIndexValid)
+					{
+						moved[i] = kept;
+					}
+					if (kept != i)
+					{
+						sectionsCache[kept] = std::move(sectionsCache[i]);
+						if (sectionTreeEnabled)
+						{
+							sectionIds[kept] = sectionIds[i];
+						}
+					}
+					kept++;
+				}
+				sectionsCache.resize(kept);
+				if (sectionTreeEnabled)
+				{
+					sectionIds.resize(kept);
+				}
+
+				removedSections = 0;
+				if (sectionIndexValid)
+				{
+					size_t count = 0;
+					for (size_t i = 0; i < sectionIndex.size(); ++i)
+					{
+						size_t position = moved[sectionIndex[i].second];
+						if (position == NO_SECTION)
+						{
+							continue;
+						}
+						if (count != i)
+						{
+							sectionIndex[count].first = std::move(sectionIndex[i].first);
+						}
+						sectionIndex[count].second = position;
+						count++;
+					}
+					sectionIndex.resize(count);
+				}
+			}
+
+
+			void INIFile::updateFingerprint(uint64_t before, uint64_t after)
+			{
+				if (fileHashValid)
+				{
+					fileHash += after - before;
+				}
+			}
+
+
+			uint64_t INIFile::fingerprint()
+			{
+				if (!fileHashValid)
+				{
+					fileHash = 0;
+					for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+					{
+						if (!sect->removed)
+						{
+							fileHash += sect->fingerprint();
+						}
+					}
+					fileHashValid = true;
+				}
+				return fileHash;
+			}
+
+
+			uint64_t INIFile::fingerprint(const std::string& section)
+			{
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+				return sect->fingerprint();
+			}
+
+
 		};
 	};
 };
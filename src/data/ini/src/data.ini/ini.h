@@ -7,30 +7,64 @@
 
 #define RET_OK 0
 
-// ûҵƥ `]'
+// 没有找到匹配的 `]'
 #define ERR_UNMATCHED_BRACKETS 2
 
-// Ϊ
+// 段为空
 #define ERR_SECTION_EMPTY 3
 
-// Ѿ
+// 段名已经存在
 #define ERR_SECTION_ALREADY_EXISTS 4
 
-// key valueʧ
+// 解析key value失败
 #define ERR_PARSE_KEY_VALUE_FAILED 5
 
-// ļʧ
+// 打开文件失败
 #define ERR_OPEN_FILE_FAILED 6
 
-// ڴ治
+// 内存不足
 #define ERR_NO_ENOUGH_MEMORY 7
 
-// ûҵӦkey
+// 没有找到对应的key
 #define ERR_NOT_FOUND_KEY 8
 
-// ûҵӦsection
+// 没有找到对应的section
 #define ERR_NOT_FOUND_SECTION 9
 
+// 段名或键名的查询模式无效
+#define ERR_INVALID_PATTERN 10
+
+// 插值时出现循环引用
+#define ERR_INTERPOLATION_CYCLE 11
+
+// 写入文件失败，如磁盘已满
+#define ERR_WRITE_FILE_FAILED 12
+
+// 冻结镜像不完整或已损坏
+#define ERR_INVALID_IMAGE 13
+
+// 创建、打开或映射共享内存失败
+#define ERR_SHARED_MEMORY_FAILED 14
+
+// 值不是合法的数值，或带有不认识的单位
+#define ERR_INVALID_NUMBER 15
+
+// 数值超出要读取的类型的范围
+#define ERR_NUMBER_OUT_OF_RANGE 16
+
+// JSON 格式错误，或含有不能对应到段和键的数组
+#define ERR_INVALID_JSON 17
+
+// 删除的项和段先留作墓碑，数量达到 INI_COMPACT_MIN 且不少于总数的 1/INI_COMPACT_RATIO 时压缩
+#define INI_COMPACT_MIN 16
+#define INI_COMPACT_RATIO 4
+
+// 索引失效后逐个比较查找段的次数超过 INI_INDEX_MIN_SCANS 时，建立按段名排序的索引
+#define INI_INDEX_MIN_SCANS 8
+
+// 项数达到此值的段在查找键时建立键名索引
+#define INI_KEY_INDEX_MIN 16
+
 #include <cstdlib>
 #include <cstdio>
 #include <cctype>
@@ -41,6 +75,16 @@
 #include <fstream>
 #include <algorithm>
 #include <exception>
+#include <functional>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <iterator>
+#include <cstddef>
+#include <chrono>
+
+#include "hash.h"
 
 namespace tfc
 {
@@ -66,7 +110,7 @@ namespace tfc
 			};
 
 
-			// ֱ洢õֵע
+			// 分别存储解析得到的值和注释
 			struct ININativeValue
 			{
 				std::string value;
@@ -78,31 +122,220 @@ namespace tfc
 			{
 				std::string key;
 				std::string value;
-				std::string comment;  // ÿעָͣϷ
+				std::string comment;  // 每个键的注释，都是指该行上方的内容
 				std::string rightComment;
+				size_t line = 0;  // 在源文件中的行号，从 1 开始；不是从文件加载的项为 0
+			};
+
+
+			// 变更通知的类型
+			enum INIChangeType
+			{
+				INI_KEY_SET,          // 键被新增或值被修改
+				INI_KEY_DELETED,      // 键被删除
+				INI_SECTION_DELETED   // 整个段被删除，此时 key 为空
+			};
+
+
+			// 文件编码，load 时自动识别，save 时按原编码写回
+			enum INIEncoding
+			{
+				INI_ENCODING_UTF8,
+				INI_ENCODING_UTF8_BOM,
+				INI_ENCODING_UTF16LE,
+				INI_ENCODING_UTF16BE
+			};
+
+
+			struct INIChange
+			{
+				INIChangeType type;
+				std::string section;
+				std::string key;
+				std::string oldValue;
+				std::string newValue;
 			};
 
 
+			using INIWatcher = std::function<void(const INIChange&)>;
+
+
+			// 按单位读取的数值的种类
+			enum ININumberKind
+			{
+				INI_NUMBER_NONE,
+				INI_NUMBER_INT64,
+				INI_NUMBER_UINT64,
+				INI_NUMBER_SIZE,
+				INI_NUMBER_DURATION   // 纳秒
+			};
+
+
+			// 缓存的解析结果，无符号的值按位存放
+			struct INIParsedNumber
+			{
+				ININumberKind kind = INI_NUMBER_NONE;
+				int64_t value = 0;
+			};
+
+
+			// 多行值在源文件中的写法，saveAs 按此写回；值中的换行总是写成缩进的续行
+			struct INIValueLayout
+			{
+				std::string indent;          // 第一个续行的缩进
+				std::vector<size_t> breaks;  // 以反斜杠续行处下一行的内容在 value 中的起点，递增
+			};
+
+
+			class INIFrozenFile;
+			class INIQuery;
+			struct INIDifference;
+			struct INIMergeResult;
+			struct INIMemoryUsage;
+			class INISchema;
+			class INISchemaKey;
+			struct INISchemaError;
+
+
 			class INISection
 			{
 			public:
-				using INIItemIterator = std::vector<INIItem>::iterator;  // һָԪصָ
+
+				/*
+				* 指向键元素的迭代器
+				* 被删除的项先留作墓碑，迭代时自动跳过，墓碑足够多时才整体压缩
+				*/
+				class INIItemIterator
+				{
+				public:
+					using iterator_category = std::forward_iterator_tag;
+					using value_type = INIItem;
+					using difference_type = std::ptrdiff_t;
+					using pointer = INIItem*;
+					using reference = INIItem&;
+
+					INIItemIterator() : owner(NULL), index(0) {}
+
+					INIItem& operator*() const
+					{
+						return owner->items[index];
+					}
+
+					INIItem* operator->() const
+					{
+						return &owner->items[index];
+					}
+
+					INIItemIterator& operator++()
+					{
+						index++;
+						skip();
+						return *this;
+					}
+
+					INIItemIterator operator++(int)
+					{
+						INIItemIterator old = *this;
+						++*this;
+						return old;
+					}
+
+					bool operator==(const INIItemIterator& other) const
+					{
+						return owner == other.owner && index == other.index;
+					}
+
+					bool operator!=(const INIItemIterator& other) const
+					{
+						return !(*this == other);
+					}
+
+				private:
+					friend class INISection;
+
+					INIItemIterator(INISection* _owner, size_t _index) : owner(_owner), index(_index)
+					{
+						skip();
+					}
+
+					void skip()
+					{
+						if (owner->removedCount == 0)
+						{
+							return;
+						}
+						while (index < owner->items.size() && owner->removedItems[index])
+						{
+							index++;
+						}
+					}
+
+					INISection* owner;
+					size_t index;
+				};
 
 				INIItemIterator begin();
 				INIItemIterator end();
 
 			private:
 				std::string name;
-				std::string comment;  // ÿεעָͣϷ
+				std::string comment;  // 每个段的注释，都是指该行上方的内容
 				std::string rightComment;
-				std::vector<INIItem> items;  // ֵ飬һοжֵvector
+				std::vector<INIItem> items;  // 键值项数组，一个段可以有多个键值，所有用vector来储存
+				size_t line = 0;             // 段头所在的行号，无名段和不是从文件加载的段为 0
+
+				// 与 items 一一对应的删除标记，没有墓碑时为空
+				std::vector<char> removedItems;
+				size_t removedCount = 0;
+
+				// 项数达到 INI_KEY_INDEX_MIN 时按需建立的键名索引，重名的键只记录第一个
+				std::unordered_map<std::string, size_t> keyIndex;
+				bool keyIndexValid = false;
+				bool duplicateKeys = false;
+
+				// 与 items 一一对应的数值缓存，第一次按单位读取本段的值时建立
+				std::vector<INIParsedNumber> parsedNumbers;
+
+				// 与 items 一一对应的多行值写法，加载到多行值时才建立
+				std::vector<INIValueLayout> valueLayouts;
+
+				// 整个段已被 INIFile 删除，只是还没有从 sectionsCache 中压缩掉
+				bool removed = false;
+				friend class INIFile;
+
+				// 所有项的 (键, 值) 哈希之和，增删改一项只需加减一次
+				uint64_t contentHash = 0;
+				uint64_t nameHash = INI_HASH_SEED;
+
+				void buildKeyIndex();
+
+				// 收回多余的容量，丢弃键名索引
+				void shrink();
+
+				INIParsedNumber& parsedNumber(INIItemIterator item);
+
+				// 加载时带上多行值的写法；没有记录写法时 valueLayout 返回 NULL
+				void pushItem(INIItem item, INIValueLayout layout);
+				const INIValueLayout* valueLayout(INIItemIterator item);
+
+				/*
+				* 通过迭代器直接改写的值不经过 setValue，哈希和缓存都不会更新。
+				* 改写之前取 itemHashes()，之后交给 rehash()：重新计算 contentHash，
+				* 值有变化的项丢弃数值缓存和续行位置，有任何变化时丢弃键名索引
+				*/
+				std::vector<uint64_t> itemHashes();
+				void rehash(const std::vector<uint64_t>& before);
 
 			public:
-				bool hasKey(std::string key);
+				bool hasKey(const std::string& key);
 				size_t length();
 
+				// 第一个名为 key 的项，没有时返回 end()；不要通过迭代器修改 key
+				INIItemIterator findItem(const std::string& key);
+
 				std::string getName();
 				void setName(std::string _name);
+				size_t getLine();
 				std::string getComment();
 				void setComment(std::string _comment);
 				std::string getRightComment();
@@ -110,8 +343,25 @@ namespace tfc
 
 				std::vector<INIItem> getItems();
 				void pushItem(INIItem item);
+
+				// 只标记墓碑，返回下一项；触发压缩时其余迭代器失效
 				INIItemIterator eraseItem(INIItemIterator item);
 
+				// 立即清除所有墓碑
+				void compact();
+
+				// 修改项的值并更新指纹；直接通过迭代器修改 value 不会更新指纹
+				void setValue(INIItemIterator item, const std::string& value);
+
+				/*
+				* 段名和所有 (键, 值) 的指纹，与键的顺序和注释无关，O(1) 取得
+				* 内容相同的段指纹相同，不同时几乎不会相同
+				*/
+				uint64_t fingerprint();
+
+				// 本段占用的内存，包括段对象本身，需要包含 memory.h
+				INIMemoryUsage memoryUsage();
+
 				std::vector<std::pair<std::string, std::string>> getEntries();
 				std::vector<std::string> getKeys();
 				std::vector<std::string> getValues();
@@ -127,104 +377,323 @@ namespace tfc
 			public:
 
 				/*
-				* ļ
+				* 基本文件操作
 				*/
 
 				int load(std::string filePath);
+
+				// 从内存中的文件内容加载，filePath 仅用于之后的 save；content 可以是带 BOM 的 UTF-8 或 UTF-16
+				int loadFromMemory(std::string filePath, const std::string& content);
+
+				// 通过磁盘解析缓存加载：文件未变化时直接复用 cacheDir 中的解析结果，否则解析文本并更新缓存
+				int loadCached(std::string filePath, std::string cacheDir);
+
+				// 在后台线程中加载，加载完成前不能访问本对象
+				std::future<int> loadAsync(std::string filePath);
+
+				// 把整个文件读入 content，失败时返回 ERR_OPEN_FILE_FAILED
+				static int readFile(std::string filePath, std::string& content);
+
 				int save(std::string);
 				int saveAs(std::string);
+				int saveAs(std::string filePath, INIEncoding encoding);
+
+				// load 时识别出的编码，save 和 saveAs 默认按此编码写回
+				INIEncoding getEncoding();
+				void setEncoding(INIEncoding _encoding);
 
 			public:
 
 				/*
-				* ȡ INI ļ
+				* 导出为 JSON 或扁平的 段名.键=值 列表，直接从段和项写入输出缓冲区，不经过中间的副本
+				* JSON 是两层的对象 {"段名": {"键": "值"}}，值都是字符串；无名段有键时以 "" 为段名，
+				* 重名的段和键按原样输出。扁平列表每行一项，无名段的项只写键；段名和键中的 \ 和 = 以及键中的 .
+				* 前面加 \ 转义，值中的 \ 和换行写成 \\ \n \r。开启插值时导出展开后的值，注释不导出
 				*/
-				std::string getStringValue(std::string section, std::string key);
-				std::string getStringValue(std::string key);
-				std::string getStringValueOrDefault(std::string section, std::string key, std::string defaultValue);
-				std::string getStringValueOrDefault(std::string key, std::string defaultValue);
+				int saveAsJson(std::string filePath);
+				int saveAsFlat(std::string filePath);
+				std::string toJson();
+				std::string toFlat();
 
-				int getIntValue(std::string section, std::string key);
-				int getIntValue(std::string key);
-				int getIntValueOrDefault(std::string section, std::string key, int defaultValue);
-				int getIntValueOrDefault(std::string key, int defaultValue);
+				/*
+				* 从 JSON 或扁平列表导入，替换当前的全部内容并通知订阅者；格式错误时返回错误码，当前内容不变
+				* JSON 顶层对象中值为对象的成员是段，其中再嵌套的对象是以 . 连接的子段，如 {"db": {"primary": {...}}}
+				* 得到段 db.primary；顶层的其他成员是无名段的键。数字、true、false 按原文保存，null 保存为空串，
+				* 出现数组或语法错误时返回 ERR_INVALID_JSON。扁平列表按最后一个未转义的 . 分开段名和键，
+				* 同名的段合并为一个，忽略空行，没有 = 的行返回 ERR_PARSE_KEY_VALUE_FAILED。
+				* 导入的内容没有对应的 INI 文件，需要用 saveAs 保存
+				*/
+				int loadJson(std::string filePath);
+				int loadJsonFromMemory(const std::string& content);
+				int loadFlat(std::string filePath);
+				int loadFlatFromMemory(const std::string& content);
 
-				double getDoubleValue(std::string section, std::string key);
-				double getDoubleValue(std::string key);
-				double getDoubleValueOrDefault(std::string section, std::string key, double defaultValue);
-				double getDoubleValueOrDefault(std::string key, double defaultValue);
+			public:
+
+				/*
+				* 获取 INI 文件内容
+				* 类型化的读取在命中和未命中时都不分配内存：参数按引用传递，值不复制而是原地解析，
+				* 按名称查找的索引在第一次查找时建立。以下情况仍会分配：返回 std::string 且值超出
+				* 短字符串长度、抛出异常、第一次展开插值，以及以字符串字面量传入而需要构造的临时
+				* std::string 超出短字符串长度。
+				* 带 OrDefault 的版本在段或键不存在、值为空或不能解析为布尔值时返回默认值，不抛出异常
+				*/
+				std::string getStringValue(const std::string& section, const std::string& key);
+				std::string getStringValue(const std::string& key);
+				std::string getStringValueOrDefault(const std::string& section, const std::string& key, const std::string& defaultValue);
+				std::string getStringValueOrDefault(const std::string& key, const std::string& defaultValue);
+
+				int getIntValue(const std::string& section, const std::string& key);
+				int getIntValue(const std::string& key);
+				int getIntValueOrDefault(const std::string& section, const std::string& key, int defaultValue);
+				int getIntValueOrDefault(const std::string& key, int defaultValue);
+
+				double getDoubleValue(const std::string& section, const std::string& key);
+				double getDoubleValue(const std::string& key);
+				double getDoubleValueOrDefault(const std::string& section, const std::string& key, double defaultValue);
+				double getDoubleValueOrDefault(const std::string& key, double defaultValue);
+
+				bool getBoolValue(const std::string& section, const std::string& key);
+				bool getBoolValue(const std::string& key);
+				bool getBoolValueOrDefault(const std::string& section, const std::string& key, bool defaultValue);
+				bool getBoolValueOrDefault(const std::string& key, bool defaultValue);
+
+
+				std::string getComment(const std::string& section, const std::string& key);
+				std::string getRightComment(const std::string& section, const std::string& key);
+
+				// 不做插值展开的原始值
+				std::string getRawStringValue(const std::string& section, const std::string& key);
+
+				/*
+				* 带单位的数值，如 64MB、30s、1.5k、0x1F，第一次读取后解析结果缓存在段内，值被修改时丢弃。
+				* 整数可以带 0x（十六进制）或 0（八进制）前缀；十进制数可以有小数部分，乘上单位后必须是整数。
+				* Int64 和 UInt64 接受单位 k M G T P E（按 1000 进位）和 Ki Mi Gi Ti Pi Ei（按 1024 进位）；
+				* Size 返回字节数，单位 B K KB KiB M MB MiB 直到 E EB EiB，不区分大小写，一律按 1024 进位；
+				* Duration 接受 ns us ms s m min h d，可以连写如 1h30m，只有一个数且不带单位时按秒计。
+				* 格式错误抛出 ERR_INVALID_NUMBER，超出范围（包括无符号的值为负）抛出 ERR_NUMBER_OUT_OF_RANGE；
+				* 带 OrDefault 的版本只在段或键不存在、值为空时返回默认值，格式错误仍然抛出异常
+				*/
+				int64_t getInt64Value(const std::string& section, const std::string& key);
+				int64_t getInt64ValueOrDefault(const std::string& section, const std::string& key, int64_t defaultValue);
+
+				uint64_t getUInt64Value(const std::string& section, const std::string& key);
+				uint64_t getUInt64ValueOrDefault(const std::string& section, const std::string& key, uint64_t defaultValue);
 
-				bool getBoolValue(std::string section, std::string key);
-				bool getBoolValue(std::string key);
-				bool getBoolValueOrDefault(std::string section, std::string key, bool defaultValue);
-				bool getBoolValueOrDefault(std::string key, bool defaultValue);
+				uint64_t getSizeValue(const std::string& section, const std::string& key);
+				uint64_t getSizeValueOrDefault(const std::string& section, const std::string& key, uint64_t defaultValue);
 
+				std::chrono::nanoseconds getDurationValue(const std::string& section, const std::string& key);
+				std::chrono::nanoseconds getDurationValueOrDefault(const std::string& section, const std::string& key, std::chrono::nanoseconds defaultValue);
 
-				std::string getComment(std::string section, std::string key);
-				std::string getRightComment(std::string section, std::string key);
+				// 按上述规则把 text 解析为 kind 类型的数值，无符号的值按位存入 value；返回 RET_OK 或错误码，不抛出异常
+				static int parseNumber(const std::string& text, ININumberKind kind, int64_t& value);
 
 
-				std::vector<std::string> getKeys(std::string section);
-				std::vector<std::string> getValues(std::string section);
-				std::vector<std::pair<std::string, std::string>> getEntries(std::string section);
-				std::vector<INIItem> getItems(std::string section);
-				int getItemsLength(std::string section);
+				std::vector<std::string> getKeys(const std::string& section);
+				std::vector<std::string> getValues(const std::string& section);
+				std::vector<std::pair<std::string, std::string>> getEntries(const std::string& section);
+				std::vector<INIItem> getItems(const std::string& section);
+				int getItemsLength(const std::string& section);
 				int getItemsLength(INISection section);
 
-				INISection getSection(std::string section);
+				INISection getSection(const std::string& section);
 				std::vector<INISection> getSections();
-				std::vector<INISection> getSections(std::string section, ...);
 				std::vector<std::string> getSectionNames();
 
 			public:
 
 				/*
-				*  INI ļǷָ
+				* 按通配符或正则表达式查询段和键，需要包含 query.h
+				* 字符串参数按通配符处理，如 getSections("server.*")；
+				* 模式有字面前缀时只访问按段名排序的索引中以该前缀开头的段
+				*/
+
+				// 名称匹配的段，按文件顺序返回
+				std::vector<INISection> getSections(const INIQuery& sections);
+				std::vector<std::string> getSectionNames(const INIQuery& sections);
+
+				// 段名和键名都匹配的项，按文件顺序返回 (段名, 项)
+				std::vector<std::pair<std::string, INIItem>> getItems(const INIQuery& sections, const INIQuery& keys);
+
+				/*
+				* 不复制地访问匹配的段，visitor 中不能增删或重命名段，也不要改写键名
+				* 值可以通过 setValue 或直接通过迭代器改写：访问之后逐项比较，丢弃过期的缓存，并像 setValue 一样通知订阅者
+				*/
+				void forEachSection(const INIQuery& sections, std::function<void(INISection&)> visitor);
+
+			public:
+
+				/*
+				* 按 '.' 分隔的段名层级访问，如 db 的子树包含 db、db.primary、db.replica.1，但不包含 dbx；
+				* parent 为空时表示整个文件。
+				* 开启段名前缀树后，按名称查找段只需 O(深度)，访问和删除子树不会遍历无关的段；
+				* 未开启时这些接口逐个比较段名
 				*/
 
-				bool hasSection(std::string section);
-				bool hasKey(std::string section, std::string key);
-				bool hasKey(std::string key);
+				void enableSectionTree(bool enable = true);
+				bool isSectionTreeEnabled();
+
+				// 子树中的段，按文件顺序返回
+				std::vector<std::string> getSubsectionNames(const std::string& parent);
+				std::vector<INISection> getSubsections(const std::string& parent);
+
+				// 与 forEachSection 相同，访问之后检查改动并通知订阅者
+				void forEachSubsection(const std::string& parent, std::function<void(INISection&)> visitor);
+
+				// 删除整个子树，每个段按 deleteSection 的方式通知订阅者
+				void deleteSubsections(const std::string& parent);
 
 			public:
 
 				/*
-				*  INI ļ
+				* 值的插值展开：${section:key} 展开为其他键的值，${:key} 引用无名段，
+				* ${NAME} 展开为环境变量（不存在时为空），$$ 表示 $ 本身。
+				* 开启后 getStringValue 等读取接口返回展开后的值并缓存，被引用的键改变时
+				* 只丢弃直接或间接引用它的缓存；环境变量在第一次展开时读取。
+				* 引用的键不存在时抛出 ERR_NOT_FOUND_SECTION 或 ERR_NOT_FOUND_KEY，循环引用抛出 ERR_INTERPOLATION_CYCLE。
+				* getRawStringValue、getItems 等接口以及 save 仍然使用原文
 				*/
 
-				// ֵַ
+				void enableInterpolation(bool enable = true);
+				bool isInterpolationEnabled();
+
+			public:
+
+				/*
+				* 多行值，在 load 之前开启后才会识别：
+				* 以 \ 结尾的键值行与下一行直接拼接，去掉 \ 和下一行的缩进，如 hosts = a, \ 后接一行 b 得到 "a, b"；
+				* 键值行之后以空格或制表符缩进的行是值的后续行，以换行连接，后面仍有缩进的行时其间的空行也属于值。
+				* 后续行整行都是值的内容，不识别其中的注释。各行在原文中的位置先记下，读完整个值后一次拼接。
+				* saveAs 按加载时的断行和缩进写回，值中的换行总是写成缩进的后续行
+				*/
+				void enableMultilineValues(bool enable = true);
+				bool isMultilineValuesEnabled();
+
+			public:
+
+				/*
+				* 检测 INI 文件是否包含指定内容
+				*/
+
+				bool hasSection(const std::string& section);
+				bool hasKey(const std::string& section, const std::string& key);
+				bool hasKey(const std::string& key);
+
+			public:
+
+				/*
+				* 设置 INI 文件内容
+				*/
+
+				// 设置字符串值
 				void setStringValue(const std::string section, const std::string key, const std::string value);
 
-				// ֵ
+				// 设置整数值
 				void setIntValue(const std::string section, const std::string key, int value);
 
-				// øֵ
+				// 设置浮点值
 				void setDoubleValue(const std::string section, const std::string key, double value);
 
-				// òֵ
+				// 设置布尔值
 				void setBoolValue(const std::string section, const std::string key, bool value);
 
-				// עͣkey=""öע
+				// 设置注释，如果key=""则设置段注释
 				void setComment(std::string section, std::string key, std::string comment);
 
-				// βעͣkey=""öεβע
+				// 设置行尾注释，如果key=""则设置段的行尾注释
 				void setRightComment(std::string section, const std::string key, std::string rightComment);
 
 			public:
 
 				/*
-				* ɾ INI ļ
+				* 删除 INI 文件内容
 				*/
 
-				// ɾ
+				// 删除段
 				void deleteSection(std::string section);
 
-				// ɾضεض
+				// 删除特定段的特定项
 				void deleteKey(std::string section, std::string key);
 				void deleteKey(std::string section, INIItem item);
 				void deleteKey(INISection section, INIItem item);
 				void deleteKey(INISection section, std::string key);
 
+				/*
+				* 删除的段和项先留作墓碑，由后续删除按比例触发压缩；这里立即清除所有墓碑，
+				* 并收回各个数组和字符串的多余容量，丢弃可以按需重建的段名和键名索引
+				*/
+				void compact();
+
+			public:
+
+				/*
+				* 内存占用，需要包含 memory.h
+				* 整个文件的占用等于各段之和再加上段数组的多余容量、索引、缓存和订阅
+				*/
+				INIMemoryUsage memoryUsage();
+
+				// 段不存在时抛出 ERR_NOT_FOUND_SECTION
+				INIMemoryUsage memoryUsage(const std::string& section);
+
+			public:
+
+				/*
+				* 按模式检查整个文件，需要包含 schema.h
+				* 只顺序遍历一遍 sectionsCache，每个段和键在模式中各查一次哈希表；
+				* 收集所有错误后一起返回，不抛出异常：先按文件顺序列出各段中的错误，最后是缺少的段；没有错误时返回空数组。
+				* 开启插值时检查展开后的值；检查时解析出的数值写入段内缓存，之后按单位读取不再解析
+				*/
+				std::vector<INISchemaError> validate(const INISchema& schema);
+
+			public:
+
+				// 生成只读的冻结副本，用于加载完成后只读的场景，需要包含 frozen.h
+				INIFrozenFile freeze();
+
+			public:
+
+				/*
+				* 内容指纹，由所有段的指纹相加得到，与段的顺序和注释无关
+				* 加载后第一次调用时计算一遍，之后随 setValue、deleteKey、deleteSection、merge 等修改增量更新，
+				* 用于不经序列化比较两个版本的内容是否相同
+				*/
+				uint64_t fingerprint();
+
+				// 段不存在时抛出 ERR_NOT_FOUND_SECTION
+				uint64_t fingerprint(const std::string& section);
+
+			public:
+
+				/*
+				* 比较与合并，需要包含 diff.h
+				* 段和键都按名称哈希后一一对应，耗时与两个文件的大小成线性；
+				* 重名的段和键只比较第一个，与查找的结果一致
+				*/
+
+				// 从本文件变为 other 需要的变更：先按本文件的顺序列出删除和修改，再按 other 的顺序列出新增
+				std::vector<INIDifference> diff(INIFile& other);
+
+				// 以本文件为我方做三方合并，把 base 到 theirs 的变更合入本文件并通知订阅者；冲突处保留我方
+				INIMergeResult merge(INIFile& base, INIFile& theirs);
+
+			public:
+
+				/*
+				* 订阅 INI 文件内容的变更
+				* setStringValue、deleteKey、deleteSection 以及重新 load 都会触发通知，
+				* 每次变更只按 (段, 键) 索引通知它自己的订阅者
+				*/
+
+				// 订阅特定段的特定键，返回订阅编号
+				int subscribe(std::string section, std::string key, INIWatcher watcher);
+
+				// 订阅整个段，段内任意键的变更都会通知
+				int subscribe(std::string section, INIWatcher watcher);
+
+				// 取消订阅
+				void unsubscribe(int id);
+
 			public:
 				void customBooleans(std::string b0, std::string b1);
 
@@ -235,13 +704,48 @@ namespace tfc
 //#endif // _DEBUG_DATA_INI_
 
 			private:
-				ININativeValue getValue(std::string section, std::string key);
+				// 段不存在时抛出 ERR_NOT_FOUND_SECTION
+				INISection& requireSection(const std::string& section);
+
+				// 键的原始值或展开后的值；不存在时 required 为 true 则抛出异常，否则返回 NULL
+				const std::string* lookupRawValue(const std::string& section, const std::string& key, bool required);
+				const std::string* lookupValue(const std::string& section, const std::string& key, bool required);
+
+				// value 是 beBooleans 中的某个真值或假值时写入 result 并返回 true
+				bool matchBoolean(const std::string& value, bool& result);
+
+				// 按 kind 读取数值；键不存在或值为空时 required 为 true 则抛出异常，否则返回 false
+				bool getNumber(const std::string& section, const std::string& key, ININumberKind kind, bool required, int64_t& value);
+
+				// 按规则检查一项，错误追加到 errors
+				void validateItem(INISection& sect, INISection::INIItemIterator item, const INISchemaKey& rule, std::vector<INISchemaError>& errors);
+
 				void setValue(std::string section, std::string key, std::string value, std::string comment);
 				void setValue(std::string section, std::string key, std::string value);
 				void setValue(std::string key, std::string value);
 				INISection updateSection(std::string cleanLine, std::string comment, std::string rightComment);
 				INIItem addEntry(std::string cleanLine, std::string comment, std::string rightComment);
 
+				// 读取从 lineBegin 开始的续行，拼接到 value 之后；返回下一行的起点
+				size_t readContinuation(const std::string& text, size_t lineBegin, size_t& lineNumber, std::string& value, INIValueLayout& layout);
+
+			private:
+				std::string serializeCache();
+				bool restoreCache(const std::string& filePath, const char* data, size_t size);
+
+				// 整体换成 sections 并通知订阅者，用于从缓存或其他格式加载
+				void replaceSections(std::vector<INISection>& sections, const std::string& filePath, INIEncoding sourceEncoding);
+
+			private:
+				template <typename Writer>
+				void writeJson(Writer& writer);
+				template <typename Writer>
+				void writeFlat(Writer& writer);
+
+				// 解析整个文本到 sections，sections[0] 是无名段；成功时返回 RET_OK
+				static int parseJson(const char* data, size_t size, std::vector<INISection>& sections);
+				static int parseFlat(const char* data, size_t size, std::vector<INISection>& sections);
+
 			private:
 				INIItem parse(std::string line);
 				std::pair<std::string, std::string> split(std::string line, std::string seq);
@@ -260,6 +764,8 @@ namespace tfc
 				void release();
 				std::vector<INISection> sectionsCache;
 				std::string path;
+				INIEncoding encoding = INI_ENCODING_UTF8;
+				bool multilineEnabled = false;
 				INISection defaultSection;
 
 				std::vector<std::pair<std::string, std::string>> beBooleans;
@@ -267,6 +773,120 @@ namespace tfc
 			private:
 				using INISectionIterator = std::vector<INISection>::iterator;
 
+				INISectionIterator findSection(const std::string& section);
+
+				// sectionsCache 中已删除但尚未压缩的段数
+				size_t removedSections = 0;
+
+				// 所有段的指纹之和，fileHashValid 为 false 时在下次取指纹时重新计算
+				uint64_t fileHash = 0;
+				bool fileHashValid = false;
+
+				// 某个段的指纹从 before 变为 after，新增的段 before 为 0，删除的段 after 为 0
+				void updateFingerprint(uint64_t before, uint64_t after);
+
+				// 把 position 处的段标记为墓碑，调用前先取走需要的内容
+				void markSectionRemoved(size_t position);
+				void compactSections();
+				void compactSectionsIfNeeded();
+
+				// 按 (段名, 在 sectionsCache 中的位置) 排序的索引，查询时按需建立；
+				// 之后追加段和压缩时就地更新，只有段插到开头时失效
+				std::vector<std::pair<std::string, size_t>> sectionIndex;
+				bool sectionIndexValid = false;
+				size_t sectionScans = 0;
+
+				void buildSectionIndex();
+				INISectionIterator findSectionInIndex(const std::string& section);
+
+				// 段名到第一个同名段位置的哈希表，用于比较与合并
+				std::unordered_map<std::string, size_t> hashSections();
+				std::vector<size_t> findSections(const INIQuery& query);
+
+			private:
+
+				// 段名前缀树的节点，sections 是名称正好等于该路径的段的编号，按文件顺序递增
+				struct INISectionNode
+				{
+					std::unordered_map<std::string, size_t> children;
+					std::vector<uint64_t> sections;
+				};
+
+				// 前缀树只保存段的编号，sectionIds 与 sectionsCache 一一对应且递增，
+				// 删除段时其余段的编号不变，由编号二分查找即可得到当前位置
+				bool sectionTreeEnabled = false;
+				std::vector<INISectionNode> sectionNodes;  // 0 号为根节点，对应段名 ""
+				std::vector<size_t> freeNodes;
+				std::vector<uint64_t> sectionIds;
+				uint64_t nextSectionId = 0;
+				std::string lookupComponent;  // findNode 拆出的一级名称，重复使用以免每次查找都分配
+
+				// sectionsCache 中 position 处的段刚被加入，或即将被标记为墓碑
+				void attachSection(size_t position);
+				void detachSection(size_t position);
+
+				void rebuildSectionTree();
+				size_t findNode(const std::string& name, bool create);
+				void releaseNode(size_t node);
+				void pruneNodes(const std::string& name);
+				INISectionIterator findSectionInTree(const std::string& section);
+				std::vector<size_t> findSubsections(const std::string& parent);
+
+			private:
+
+				// 展开后的值，dependencies 是它直接引用的键
+				struct INIResolvedValue
+				{
+					std::string value;
+					std::vector<std::string> dependencies;
+				};
+
+				// 以 段名 + '\0' + 键名 标识一个键
+				bool interpolationEnabled = false;
+				std::unordered_map<std::string, INIResolvedValue> resolvedValues;
+				std::unordered_map<std::string, std::unordered_set<std::string>> dependents;  // 被引用的键 -> 引用它的键
+				std::vector<std::string> resolving;  // 正在展开的键，用于发现循环引用
+				std::string lookupId;                // 查找缓存时拼接标识用，重复使用以免每次读取都分配
+
+				const std::string& resolveValue(const std::string& section, const std::string& key, const std::string& raw);
+				void expandValue(const std::string& section, const std::string& key, const std::string& raw, INIResolvedValue& resolved);
+				void invalidateResolved(const std::string& section, const std::string& key);
+				void clearResolved();
+
+			private:
+				struct INIWatchEntry
+				{
+					int id;
+					INIWatcher watcher;
+				};
+
+				// 每个被订阅的段对应一个槽，键订阅再按键名索引
+				struct INIWatchSlot
+				{
+					std::vector<INIWatchEntry> sectionWatchers;
+					std::unordered_map<std::string, std::vector<INIWatchEntry>> keyWatchers;
+				};
+
+				// 重新加载前被订阅段的内容快照
+				using INIWatchSnapshot = std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>>;
+
+				void notify(INIChangeType type, const std::string& section, const std::string& key, const std::string& oldValue, const std::string& newValue);
+				INIWatchSnapshot snapshotWatched();
+				void notifyReload(const INIWatchSnapshot& snapshot);
+
+				// 按一个段前后的内容逐个通知有变化的键
+				void notifyChanges(const std::string& section, const std::vector<std::pair<std::string, std::string>>& before, const std::vector<std::pair<std::string, std::string>>& after);
+
+				/*
+				* forEachSection 和 forEachSubsection 访问一个段：visitor 可能绕过 setValue 直接改写值，
+				* 之后整段重新计算哈希和缓存，有变化时丢弃插值缓存并通知订阅者
+				*/
+				void visitSection(size_t position, const std::function<void(INISection&)>& visitor);
+
+				std::unordered_map<std::string, INIWatchSlot> watchers;
+				std::unordered_map<int, std::pair<std::string, std::string>> watchIds;
+				int nextWatchId = 1;
+
 			};
 
 
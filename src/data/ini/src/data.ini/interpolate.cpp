@@ -0,0 +1,238 @@
+#include "ini.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			static inline std::string makeKeyId(const std::string& section, const std::string& key)
+			{
+				std::string id = section;
+				id += '\0';
+				id += key;
+				return id;
+			}
+
+
+			// 在 id 原有的容量中拼出标识，容量足够时不分配内存
+			static inline void assignKeyId(std::string& id, const std::string& section, const std::string& key)
+			{
+				id.assign(section);
+				id += '\0';
+				id += key;
+			}
+
+
+			// 用于错误信息，形如 [section] key
+			static std::string describeKeyId(const std::string& id)
+			{
+				size_t split = id.find('\0');
+				return "[" + id.substr(0, split) + "] " + id.substr(split + 1);
+			}
+
+
+			static std::string readEnvironment(const std::string& name)
+			{
+#ifdef _WIN32
+				DWORD size = GetEnvironmentVariableA(name.c_str(), NULL, 0);
+				if (size == 0)
+				{
+					return "";
+				}
+				std::string value(size, '\0');
+				size = GetEnvironmentVariableA(name.c_str(), &value[0], size);
+				value.resize(size);
+				return value;
+#else
+				const char* value = getenv(name.c_str());
+				return value == NULL ? "" : value;
+#endif
+			}
+
+
+			void INIFile::enableInterpolation(bool enable)
+			{
+				interpolationEnabled = enable;
+				clearResolved();
+			}
+
+
+			bool INIFile::isInterpolationEnabled()
+			{
+				return interpolationEnabled;
+			}
+
+
+			// 不含 $ 的值不需要展开也不进入缓存，读取它与读取原始值相同
+			const std::string& INIFile::resolveValue(const std::string& section, const std::string& key, const std::string& raw)
+			{
+				if (raw.find('$') == std::string::npos)
+				{
+					return raw;
+				}
+
+				assignKeyId(lookupId, section, key);
+				auto cached = resolvedValues.find(lookupId);
+				if (cached != resolvedValues.end())
+				{
+					return cached->second.value;
+				}
+
+				// 展开引用的键时会重用 lookupId
+				std::string id = lookupId;
+
+				if (std::find(resolving.begin(), resolving.end(), id) != resolving.end())
+				{
+					std::string chain;
+					for (auto it = std::find(resolving.begin(), resolving.end(), id); it != resolving.end(); ++it)
+					{
+						chain += describeKeyId(*it) + " -> ";
+					}
+					resolving.clear();
+					throw INIException(ERR_INTERPOLATION_CYCLE, "interpolation cycle: " + chain + describeKeyId(id));
+				}
+
+				INIResolvedValue resolved;
+				resolving.push_back(id);
+				try
+				{
+					expandValue(section, key, raw, resolved);
+				}
+				catch (...)
+				{
+					resolving.clear();
+					throw;
+				}
+				resolving.pop_back();
+
+				for (auto dep = resolved.dependencies.begin(); dep != resolved.dependencies.end(); ++dep)
+				{
+					dependents[*dep].insert(id);
+				}
+				return resolvedValues.emplace(std::move(id), std::move(resolved)).first->second.value;
+			}
+
+
+			void INIFile::expandValue(const std::string& section, const std::string& key, const std::string& raw, INIResolvedValue& resolved)
+			{
+				std::string& out = resolved.value;
+				out.reserve(raw.size());
+
+				size_t i = 0;
+				while (i < raw.size())
+				{
+					size_t dollar = raw.find('$', i);
+					if (dollar == std::string::npos || dollar + 1 >= raw.size())
+					{
+						out.append(raw, i, std::string::npos);
+						break;
+					}
+					out.append(raw, i, dollar - i);
+
+					if (raw[dollar + 1] == '$')
+					{
+						out += '$';
+						i = dollar + 2;
+						continue;
+					}
+
+					// 不成对的 ${ 和单独的 $ 原样保留
+					size_t close = raw[dollar + 1] == '{' ? raw.find('}', dollar + 2) : std::string::npos;
+					if (close == std::string::npos)
+					{
+						out += '$';
+						i = dollar + 1;
+						continue;
+					}
+
+					std::string name(raw, dollar + 2, close - dollar - 2);
+					size_t colon = name.find(':');
+					if (colon == std::string::npos)
+					{
+						out += readEnvironment(name);
+					}
+					else
+					{
+						std::string refSection = name.substr(0, colon);
+						std::string refKey = name.substr(colon + 1);
+						std::string where = " referenced by " + describeKeyId(makeKeyId(section, key));
+
+						INISectionIterator sect = findSection(refSection);
+						if (sect == sectionsCache.end())
+						{
+							throw INIException(ERR_NOT_FOUND_SECTION, "section `" + refSection + "`" + where + " was not found");
+						}
+						INISection::INIItemIterator item = sect->findItem(refKey);
+						if (item == sect->end())
+						{
+							throw INIException(ERR_NOT_FOUND_KEY, "key `" + refKey + "` in section `" + refSection + "`" + where + " was not found");
+						}
+
+						// 先复制原文，展开被引用的值时可能新建缓存或压缩段
+						std::string refRaw = item->value;
+						out += resolveValue(refSection, refKey, refRaw);
+						resolved.dependencies.push_back(makeKeyId(refSection, refKey));
+					}
+					i = close + 1;
+				}
+			}
+
+
+			// 丢弃这个键以及所有直接或间接引用它的键的缓存
+			void INIFile::invalidateResolved(const std::string& section, const std::string& key)
+			{
+				if (dependents.empty() && resolvedValues.empty())
+				{
+					return;
+				}
+
+				std::vector<std::string> pending(1, makeKeyId(section, key));
+				while (!pending.empty())
+				{
+					std::string id = std::move(pending.back());
+					pending.pop_back();
+
+					auto cached = resolvedValues.find(id);
+					if (cached != resolvedValues.end())
+					{
+						for (auto dep = cached->second.dependencies.begin(); dep != cached->second.dependencies.end(); ++dep)
+						{
+							auto users = dependents.find(*dep);
+							if (users != dependents.end())
+							{
+								users->second.erase(id);
+								if (users->second.empty())
+								{
+									dependents.erase(users);
+								}
+							}
+						}
+						resolvedValues.erase(cached);
+					}
+
+					auto users = dependents.find(id);
+					if (users != dependents.end())
+					{
+						pending.insert(pending.end(), users->second.begin(), users->second.end());
+					}
+				}
+			}
+
+
+			void INIFile::clearResolved()
+			{
+				resolvedValues.clear();
+				dependents.clear();
+				resolving.clear();
+			}
+
+
+		};
+	};
+};
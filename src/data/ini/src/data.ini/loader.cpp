@@ -0,0 +1,175 @@
+#include "loader.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 离开作用域时执行 action，抛出异常时也一样
+			template <typename Action>
+			class INIScopeExit
+			{
+			public:
+				INIScopeExit(Action& _action) : action(_action) {}
+				~INIScopeExit() { action(); }
+
+				INIScopeExit(const INIScopeExit&) = delete;
+				INIScopeExit& operator=(const INIScopeExit&) = delete;
+
+			private:
+				Action& action;
+
+			};
+
+
+			INIBatchLoader::INIBatchLoader(size_t threads, size_t queueCapacity)
+				: threads(threads), queueCapacity(queueCapacity), readFinished(false)
+			{
+				if (this->threads == 0)
+				{
+					this->threads = std::thread::hardware_concurrency();
+				}
+				if (this->threads == 0)
+				{
+					this->threads = 1;
+				}
+
+				// 队列只需容纳足够让所有工作线程都有活干的文件，避免把所有文件同时读入内存
+				if (this->queueCapacity == 0)
+				{
+					this->queueCapacity = this->threads * 2;
+				}
+			}
+
+
+			size_t INIBatchLoader::threadCount()
+			{
+				return threads;
+			}
+
+
+			std::vector<INILoadResult> INIBatchLoader::loadAll(const std::vector<std::string>& paths)
+			{
+				std::lock_guard<std::mutex> guard(batchLock);
+				std::vector<INILoadResult> results(paths.size());
+				std::vector<std::thread> workers;
+
+				if (paths.empty())
+				{
+					return results;
+				}
+
+				queue.clear();
+				readFinished = false;
+
+				/*
+				* 创建线程或读文件时抛出异常（如 std::system_error、std::bad_alloc），
+				* 也要先结束队列让已经启动的工作线程退出，再等待它们，否则带着可连接的线程析构会调用 std::terminate
+				*/
+				auto joinWorkers = [this, &workers]() {
+					finishReading();
+					for (auto it = workers.begin(); it != workers.end(); ++it)
+					{
+						it->join();
+					}
+				};
+
+				// 工作线程写入 results，必须在返回之前等待它们结束
+				{
+					INIScopeExit<decltype(joinWorkers)> joinGuard(joinWorkers);
+
+					// 预先分配好空间，加入线程时不会因扩容失败而丢掉已经启动的线程
+					size_t workerCount = std::min(threads, paths.size());
+					workers.reserve(workerCount);
+					for (size_t i = 0; i < workerCount; ++i)
+					{
+						workers.emplace_back(&INIBatchLoader::parseAll, this, std::cref(paths), std::ref(results));
+					}
+
+					// 当前线程充当读线程
+					readAll(paths);
+				}
+				return results;
+			}
+
+
+			std::future<std::vector<INILoadResult>> INIBatchLoader::loadAllAsync(std::vector<std::string> paths)
+			{
+				return std::async(std::launch::async, [this, paths]() {
+					return loadAll(paths);
+				});
+			}
+
+
+			void INIBatchLoader::readAll(const std::vector<std::string>& paths)
+			{
+				for (size_t i = 0; i < paths.size(); ++i)
+				{
+					INIPendingFile pending;
+					pending.index = i;
+					pending.errorValue = INIFile::readFile(paths[i], pending.content);
+
+					std::unique_lock<std::mutex> lock(queueLock);
+					queueWritable.wait(lock, [this]() { return queue.size() < queueCapacity; });
+					queue.push_back(std::move(pending));
+					lock.unlock();
+					queueReadable.notify_one();
+				}
+
+				finishReading();
+			}
+
+
+			void INIBatchLoader::finishReading()
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				readFinished = true;
+				queueReadable.notify_all();
+			}
+
+
+			void INIBatchLoader::parseAll(const std::vector<std::string>& paths, std::vector<INILoadResult>& results)
+			{
+				for (;;)
+				{
+					std::unique_lock<std::mutex> lock(queueLock);
+					queueReadable.wait(lock, [this]() { return !queue.empty() || readFinished; });
+					if (queue.empty())
+					{
+						return;
+					}
+
+					INIPendingFile pending = std::move(queue.front());
+					queue.pop_front();
+					lock.unlock();
+					queueWritable.notify_one();
+
+					// 每个结果槽只由一个线程写入，不需要加锁
+					INILoadResult& result = results[pending.index];
+					result.path = paths[pending.index];
+					result.errorValue = pending.errorValue;
+
+					if (pending.errorValue != RET_OK)
+					{
+						continue;
+					}
+
+					try
+					{
+						result.file = std::make_shared<INIFile>();
+						result.errorValue = result.file->loadFromMemory(result.path, pending.content);
+					}
+					catch (const std::bad_alloc&)
+					{
+						result.file.reset();
+						result.errorValue = ERR_NO_ENOUGH_MEMORY;
+					}
+				}
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_LOADER_H_
+#define _TFC_DATA_FORMAT_INI_LOADER_H_
+
+#include "ini.h"
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 批量加载中单个文件的结果
+			struct INILoadResult
+			{
+				std::string path;
+				int errorValue;                 // RET_OK 或 ERR_*
+				std::shared_ptr<INIFile> file;  // 打开失败时为空
+			};
+
+
+			/*
+			* 批量并行加载多个 INI 文件
+			* 一个读线程负责把文件内容读入内存，固定数量的工作线程负责解析，
+			* 两者通过有界队列衔接，使磁盘 I/O 与解析重叠进行
+			*/
+			class INIBatchLoader
+			{
+			public:
+
+				// threads 为 0 时使用硬件并发数
+				INIBatchLoader(size_t threads = 0, size_t queueCapacity = 0);
+
+			public:
+
+				// 加载全部文件，结果与 paths 的顺序一一对应
+				std::vector<INILoadResult> loadAll(const std::vector<std::string>& paths);
+
+				// 在后台执行 loadAll，返回的 future 完成前加载器不能被销毁
+				std::future<std::vector<INILoadResult>> loadAllAsync(std::vector<std::string> paths);
+
+				size_t threadCount();
+
+			private:
+
+				// 已经读入内存、等待解析的文件
+				struct INIPendingFile
+				{
+					size_t index;
+					int errorValue;
+					std::string content;
+				};
+
+				void readAll(const std::vector<std::string>& paths);
+
+				// 标记不会再有文件入队，唤醒所有等待的工作线程
+				void finishReading();
+				void parseAll(const std::vector<std::string>& paths, std::vector<INILoadResult>& results);
+
+			private:
+				size_t threads;
+				size_t queueCapacity;
+
+				std::mutex queueLock;
+				std::condition_variable queueReadable;
+				std::condition_variable queueWritable;
+				std::deque<INIPendingFile> queue;
+				bool readFinished;
+
+				std::mutex batchLock;  // 同一个加载器同时只运行一批
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_LOADER_H_
@@ -0,0 +1,223 @@
+#include "memory.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 不超过这个长度的字符串保存在对象内部，不另外分配
+			static const size_t INLINE_CAPACITY = std::string().capacity();
+
+
+			// 字符串在对象之外分配的字节数
+			static inline size_t heapBytes(const std::string& text)
+			{
+				return text.capacity() > INLINE_CAPACITY ? text.capacity() + 1 : 0;
+			}
+
+
+			/*
+			* 把字符串的内容计入 field，多余的容量计入 overhead；
+			* 内联的内容已经随对象本身计入 overhead，这里从中扣除
+			*/
+			static inline void account(size_t& field, size_t& overhead, const std::string& text)
+			{
+				field += text.size();
+				if (text.capacity() > INLINE_CAPACITY)
+				{
+					overhead += text.capacity() + 1 - text.size();
+				}
+				else
+				{
+					overhead -= text.size();
+				}
+			}
+
+
+			// 常见实现中每个节点另有 next 指针和缓存的哈希值
+			template <typename Map>
+			static inline size_t hashTableBytes(const Map& map)
+			{
+				return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+			}
+
+
+			static inline void shrinkString(std::string& text)
+			{
+				if (text.capacity() > text.size() && text.capacity() > INLINE_CAPACITY)
+				{
+					text.shrink_to_fit();
+				}
+			}
+
+
+			INIMemoryUsage INISection::memoryUsage()
+			{
+				INIMemoryUsage usage;
+				usage.overhead = sizeof(INISection) + items.capacity() * sizeof(INIItem) + removedItems.capacity()
+					+ parsedNumbers.capacity() * sizeof(INIParsedNumber) + valueLayouts.capacity() * sizeof(INIValueLayout);
+
+				account(usage.keys, usage.overhead, name);
+				account(usage.comments, usage.overhead, comment);
+				account(usage.comments, usage.overhead, rightComment);
+
+				for (size_t i = 0; i < items.size(); ++i)
+				{
+					// 墓碑的内容都是浪费
+					bool dead = removedCount != 0 && removedItems[i];
+					account(dead ? usage.overhead : usage.keys, usage.overhead, items[i].key);
+					account(dead ? usage.overhead : usage.values, usage.overhead, items[i].value);
+					account(dead ? usage.overhead : usage.comments, usage.overhead, items[i].comment);
+					account(dead ? usage.overhead : usage.comments, usage.overhead, items[i].rightComment);
+				}
+
+				for (auto layout = valueLayouts.begin(); layout != valueLayouts.end(); ++layout)
+				{
+					usage.overhead += heapBytes(layout->indent) + layout->breaks.capacity() * sizeof(size_t);
+				}
+
+				usage.overhead += hashTableBytes(keyIndex);
+				for (auto it = keyIndex.begin(); it != keyIndex.end(); ++it)
+				{
+					usage.overhead += heapBytes(it->first);
+				}
+				return usage;
+			}
+
+
+			void INISection::shrink()
+			{
+				shrinkString(name);
+				shrinkString(comment);
+				shrinkString(rightComment);
+				for (auto it = items.begin(); it != items.end(); ++it)
+				{
+					shrinkString(it->key);
+					shrinkString(it->value);
+					shrinkString(it->comment);
+					shrinkString(it->rightComment);
+				}
+				items.shrink_to_fit();
+				parsedNumbers.shrink_to_fit();
+				valueLayouts.shrink_to_fit();
+
+				// 索引中的键名是 items 的副本，下次按名称查找时再建立
+				std::unordered_map<std::string, size_t>().swap(keyIndex);
+				keyIndexValid = false;
+			}
+
+
+			INIMemoryUsage INIFile::memoryUsage()
+			{
+				INIMemoryUsage usage;
+				usage.overhead = sizeof(INIFile) + (sectionsCache.capacity() - sectionsCache.size()) * sizeof(INISection);
+
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					INIMemoryUsage part = sect->memoryUsage();
+					if (sect->removed)
+					{
+						usage.overhead += part.total();
+					}
+					else
+					{
+						usage += part;
+					}
+				}
+
+				usage.overhead += heapBytes(path);
+				usage.overhead += beBooleans.capacity() * sizeof(beBooleans[0]);
+
+				usage.overhead += sectionIndex.capacity() * sizeof(sectionIndex[0]);
+				for (auto it = sectionIndex.begin(); it != sectionIndex.end(); ++it)
+				{
+					usage.overhead += heapBytes(it->first);
+				}
+
+				usage.overhead += sectionIds.capacity() * sizeof(uint64_t) + freeNodes.capacity() * sizeof(size_t);
+				usage.overhead += sectionNodes.capacity() * sizeof(INISectionNode);
+				for (auto node = sectionNodes.begin(); node != sectionNodes.end(); ++node)
+				{
+					usage.overhead += hashTableBytes(node->children) + node->sections.capacity() * sizeof(uint64_t);
+					for (auto child = node->children.begin(); child != node->children.end(); ++child)
+					{
+						usage.overhead += heapBytes(child->first);
+					}
+				}
+
+				// 插值缓存
+				usage.overhead += hashTableBytes(resolvedValues) + hashTableBytes(dependents);
+				for (auto it = resolvedValues.begin(); it != resolvedValues.end(); ++it)
+				{
+					usage.overhead += heapBytes(it->first) + heapBytes(it->second.value) + it->second.dependencies.capacity() * sizeof(std::string);
+					for (auto dep = it->second.dependencies.begin(); dep != it->second.dependencies.end(); ++dep)
+					{
+						usage.overhead += heapBytes(*dep);
+					}
+				}
+				for (auto it = dependents.begin(); it != dependents.end(); ++it)
+				{
+					usage.overhead += heapBytes(it->first) + hashTableBytes(it->second);
+					for (auto user = it->second.begin(); user != it->second.end(); ++user)
+					{
+						usage.overhead += heapBytes(*user);
+					}
+				}
+
+				// 订阅者本身的闭包大小无法得知，只计容器
+				usage.overhead += hashTableBytes(watchers) + hashTableBytes(watchIds);
+				for (auto slot = watchers.begin(); slot != watchers.end(); ++slot)
+				{
+					usage.overhead += slot->second.sectionWatchers.capacity() * sizeof(INIWatchEntry) + hashTableBytes(slot->second.keyWatchers);
+					for (auto key = slot->second.keyWatchers.begin(); key != slot->second.keyWatchers.end(); ++key)
+					{
+						usage.overhead += key->second.capacity() * sizeof(INIWatchEntry);
+					}
+				}
+				return usage;
+			}
+
+
+			INIMemoryUsage INIFile::memoryUsage(const std::string& section)
+			{
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+				return sect->memoryUsage();
+			}
+
+
+			void INIFile::compact()
+			{
+				compactSections();
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					sect->compact();
+					sect->shrink();
+				}
+				sectionsCache.shrink_to_fit();
+				shrinkString(path);
+
+				// 段名索引保存的是段名的副本，下次需要时再建立
+				std::vector<std::pair<std::string, size_t>>().swap(sectionIndex);
+				sectionIndexValid = false;
+
+				if (sectionTreeEnabled)
+				{
+					sectionIds.shrink_to_fit();
+					freeNodes.shrink_to_fit();
+					for (auto node = sectionNodes.begin(); node != sectionNodes.end(); ++node)
+					{
+						node->sections.shrink_to_fit();
+					}
+				}
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_MEMORY_H_
+#define _TFC_DATA_FORMAT_INI_MEMORY_H_
+
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			/*
+			* 内存占用的字节数
+			* keys、values、comments 只计字符串的内容；对象本身、字符串的多余容量、
+			* 已删除但尚未压缩的内容以及各种索引和缓存都计入 overhead。
+			* 哈希表的节点大小按常见实现估算，其余为准确值
+			*/
+			struct INIMemoryUsage
+			{
+				size_t keys = 0;      // 键名和段名
+				size_t values = 0;
+				size_t comments = 0;  // 注释和行尾注释
+				size_t overhead = 0;
+
+				size_t total() const
+				{
+					return keys + values + comments + overhead;
+				}
+
+				INIMemoryUsage& operator+=(const INIMemoryUsage& other)
+				{
+					keys += other.keys;
+					values += other.values;
+					comments += other.comments;
+					overhead += other.overhead;
+					return *this;
+				}
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_MEMORY_H_
@@ -0,0 +1,165 @@
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 续行在原文中的位置，newline 表示以换行连接（缩进的后续行），否则直接拼接（反斜杠续行）
+			struct INIValueSlice
+			{
+				size_t begin;
+				size_t end;
+				bool newline;
+			};
+
+
+			static inline bool isBlank(char c)
+			{
+				return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+			}
+
+
+			// [begin, end) 去掉首尾空白后的范围
+			static inline void trimRange(const std::string& text, size_t& begin, size_t& end)
+			{
+				while (begin < end && isBlank(text[begin]))
+				{
+					begin++;
+				}
+				while (end > begin && isBlank(text[end - 1]))
+				{
+					end--;
+				}
+			}
+
+
+			static inline size_t findLineEnd(const std::string& text, size_t lineBegin)
+			{
+				size_t lineEnd = text.find('\n', lineBegin);
+				return lineEnd == std::string::npos ? text.size() : lineEnd;
+			}
+
+
+			void INIFile::enableMultilineValues(bool enable)
+			{
+				multilineEnabled = enable;
+			}
+
+
+			bool INIFile::isMultilineValuesEnabled()
+			{
+				return multilineEnabled;
+			}
+
+
+			size_t INIFile::readContinuation(const std::string& text, size_t lineBegin, size_t& lineNumber, std::string& value, INIValueLayout& layout)
+			{
+				std::vector<INIValueSlice> slices;
+				bool continued = !value.empty() && value.back() == '\\';
+
+				while (lineBegin < text.size())
+				{
+					size_t lineEnd = findLineEnd(text, lineBegin);
+					size_t begin = lineBegin;
+					size_t end = lineEnd;
+					trimRange(text, begin, end);
+
+					if (begin == end)
+					{
+						// 空行结束反斜杠续行；缩进的后续行之间的空行，只有后面还有缩进的行时才属于值
+						if (continued)
+						{
+							break;
+						}
+						size_t next = lineEnd + 1;
+						size_t blanks = 1;
+						while (next < text.size())
+						{
+							size_t nextEnd = findLineEnd(text, next);
+							size_t nextBegin = next;
+							size_t trimmedEnd = nextEnd;
+							trimRange(text, nextBegin, trimmedEnd);
+							if (nextBegin != trimmedEnd)
+							{
+								break;
+							}
+							next = nextEnd + 1;
+							blanks++;
+						}
+						if (slices.empty() || next >= text.size() || !(text[next] == ' ' || text[next] == '\t'))
+						{
+							break;
+						}
+						for (size_t i = 0; i < blanks; ++i)
+						{
+							slices.push_back({ begin, begin, true });
+						}
+						lineNumber += blanks;
+						lineBegin = next;
+						continue;
+					}
+
+					// 不缩进的行是新的键、段或注释
+					if (!continued && !(text[lineBegin] == ' ' || text[lineBegin] == '\t'))
+					{
+						break;
+					}
+
+					if (slices.empty())
+					{
+						layout.indent.assign(text, lineBegin, begin - lineBegin);
+					}
+
+					bool more = text[end - 1] == '\\';
+					slices.push_back({ begin, more ? end - 1 : end, !continued });
+					continued = more;
+					lineNumber++;
+					lineBegin = lineEnd + 1;
+				}
+
+				// 末尾的反斜杠后面是空行或文件结尾，没有续上任何一行，它属于值本身
+				if (continued && !slices.empty())
+				{
+					slices.back().end++;
+				}
+				if (slices.empty())
+				{
+					return lineBegin;
+				}
+
+				// 键所在行以反斜杠结尾并且续上了下一行，去掉这个反斜杠
+				if (!slices.front().newline)
+				{
+					value.pop_back();
+				}
+
+				// 先算出总长度，整个值只分配和复制一次
+				size_t total = value.size();
+				for (auto it = slices.begin(); it != slices.end(); ++it)
+				{
+					total += it->end - it->begin + (it->newline ? 1 : 0);
+				}
+				value.reserve(total);
+
+				for (auto it = slices.begin(); it != slices.end(); ++it)
+				{
+					if (it->newline)
+					{
+						value += '\n';
+					}
+					else
+					{
+						layout.breaks.push_back(value.size());
+					}
+					value.append(text, it->begin, it->end - it->begin);
+				}
+				return lineBegin;
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,446 @@
+#include "query.h"
+#include "../../../../util/regex/src/util.regex/regex.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+			using tfc::util::regex::Regex;
+			using tfc::util::regex::RegexException;
+
+
+			static inline bool isRegexMeta(char c)
+			{
+				return strchr("\\^$.|?*+()[]{}", c) != NULL;
+			}
+
+
+			// 把通配符转换为等价的正则表达式，同时取出第一个通配符之前的字面前缀
+			static std::string globToRegex(const std::string& glob, std::string& prefix, bool& literal)
+			{
+				std::string re;
+				bool inPrefix = true;
+
+				prefix.clear();
+				for (size_t i = 0; i < glob.size(); ++i)
+				{
+					char c = glob[i];
+					if (c == '*' || c == '?')
+					{
+						inPrefix = false;
+						re += c == '*' ? ".*" : ".";
+						continue;
+					}
+
+					if (c == '[')
+					{
+						inPrefix = false;
+						size_t j = i + 1;
+						std::string set = "[";
+						if (j < glob.size() && (glob[j] == '!' || glob[j] == '^'))
+						{
+							set += '^';
+							j++;
+						}
+
+						// 紧跟在 [ 或 [! 之后的 ] 是普通字符
+						size_t first = j;
+						for (; j < glob.size() && (glob[j] != ']' || j == first); ++j)
+						{
+							if (glob[j] == '\\' || glob[j] == '[' || glob[j] == ']' || glob[j] == '^')
+							{
+								set += '\\';
+							}
+							set += glob[j];
+						}
+						if (j >= glob.size())
+						{
+							throw INIException(ERR_INVALID_PATTERN, "unmatched `[' in glob `" + glob + "'");
+						}
+						re += set + ']';
+						i = j;
+						continue;
+					}
+
+					if (c == '\\')
+					{
+						if (++i >= glob.size())
+						{
+							throw INIException(ERR_INVALID_PATTERN, "trailing `\\' in glob `" + glob + "'");
+						}
+						c = glob[i];
+					}
+
+					if (isRegexMeta(c))
+					{
+						re += '\\';
+					}
+					re += c;
+					if (inPrefix)
+					{
+						prefix += c;
+					}
+				}
+
+				literal = inPrefix;
+				return re;
+			}
+
+
+			/*
+			* 取出以 ^ 开头的正则表达式中紧跟的字面前缀
+			* 只处理最常见的写法，含有 | 时不提取；写成 ^literal$ 时视为精确匹配
+			*/
+			static void regexPrefix(const std::string& pattern, std::string& prefix, bool& literal)
+			{
+				prefix.clear();
+				literal = false;
+
+				if (pattern.empty() || pattern[0] != '^' || pattern.find('|') != std::string::npos)
+				{
+					return;
+				}
+
+				size_t i = 1;
+				while (i < pattern.size())
+				{
+					char c = pattern[i];
+					size_t next = i + 1;
+
+					if (c == '\\')
+					{
+						// 只接受转义的标点，\d \x41 等不是单个字面字符
+						if (next >= pattern.size() || isalnum(static_cast<unsigned char>(pattern[next])))
+						{
+							return;
+						}
+						c = pattern[next];
+						next++;
+					}
+					else if (isRegexMeta(c))
+					{
+						literal = c == '$' && next == pattern.size();
+						return;
+					}
+
+					// 后面跟着量词时这个字符可能不出现
+					if (next < pattern.size() && (pattern[next] == '?' || pattern[next] == '*' || pattern[next] == '{'))
+					{
+						return;
+					}
+					prefix += c;
+					if (next < pattern.size() && pattern[next] == '+')
+					{
+						return;
+					}
+					i = next;
+				}
+			}
+
+
+			INIQuery::INIQuery() : queryType(INI_QUERY_GLOB), exact(false), all(true), whole(true)
+			{
+				source = "*";
+			}
+
+
+			INIQuery::INIQuery(const std::string& pattern, INIQueryType type) : source(pattern), queryType(type), exact(false), all(false), whole(true)
+			{
+				compile();
+			}
+
+
+			INIQuery::INIQuery(const char* pattern, INIQueryType type) : source(pattern), queryType(type), exact(false), all(false), whole(true)
+			{
+				compile();
+			}
+
+
+			void INIQuery::compile()
+			{
+				std::string re;
+
+				switch (queryType)
+				{
+				case INI_QUERY_EXACT:
+					literalPrefix = source;
+					exact = true;
+					return;
+
+				case INI_QUERY_GLOB:
+					re = globToRegex(source, literalPrefix, exact);
+					if (exact)
+					{
+						return;
+					}
+					all = source.find_first_not_of('*') == std::string::npos;
+					if (all)
+					{
+						return;
+					}
+					break;
+
+				case INI_QUERY_REGEX:
+					re = source;
+					whole = false;
+					regexPrefix(source, literalPrefix, exact);
+					if (exact)
+					{
+						return;
+					}
+					break;
+
+				default:
+					throw INIException(ERR_INVALID_PATTERN, "unknown query type");
+				}
+
+				try
+				{
+					matcher = std::make_shared<const Regex>(re);
+				}
+				catch (RegexException& e)
+				{
+					throw INIException(ERR_INVALID_PATTERN, "invalid pattern `" + source + "': " + e.info());
+				}
+			}
+
+
+			bool INIQuery::matches(const char* name, size_t size) const
+			{
+				if (all)
+				{
+					return true;
+				}
+				if (exact)
+				{
+					return size == literalPrefix.size() && memcmp(name, literalPrefix.data(), size) == 0;
+				}
+				if (size < literalPrefix.size() || memcmp(name, literalPrefix.data(), literalPrefix.size()) != 0)
+				{
+					return false;
+				}
+				return whole ? matcher->match(name, size) : matcher->search(name, size);
+			}
+
+
+			bool INIQuery::matches(const std::string& name) const
+			{
+				return matches(name.data(), name.size());
+			}
+
+
+			const std::string& INIQuery::prefix() const
+			{
+				return literalPrefix;
+			}
+
+
+			bool INIQuery::isExact() const
+			{
+				return exact;
+			}
+
+
+			bool INIQuery::matchesAll() const
+			{
+				return all;
+			}
+
+
+			std::string INIQuery::pattern() const
+			{
+				return source;
+			}
+
+
+			INIQueryType INIQuery::type() const
+			{
+				return queryType;
+			}
+
+
+			void INIFile::buildSectionIndex()
+			{
+				sectionIndex.clear();
+				sectionIndex.reserve(sectionsCache.size());
+				for (size_t i = 0; i < sectionsCache.size(); ++i)
+				{
+					if (!sectionsCache[i].removed)
+					{
+						sectionIndex.push_back({ sectionsCache[i].getName(), i });
+					}
+				}
+				std::sort(sectionIndex.begin(), sectionIndex.end());
+				sectionIndexValid = true;
+				sectionScans = 0;
+			}
+
+
+			// 同名的段在索引中按位置相邻，取第一个没有删除的，与逐个查找的结果一致
+			INIFile::INISectionIterator INIFile::findSectionInIndex(const std::string& section)
+			{
+				auto it = std::lower_bound(sectionIndex.begin(), sectionIndex.end(), section,
+					[](const std::pair<std::string, size_t>& entry, const std::string& name) { return entry.first < name; });
+				for (; it != sectionIndex.end() && it->first == section; ++it)
+				{
+					if (!sectionsCache[it->second].removed)
+					{
+						return sectionsCache.begin() + it->second;
+					}
+				}
+				return sectionsCache.end();
+			}
+
+
+			std::vector<size_t> INIFile::findSections(const INIQuery& query)
+			{
+				std::vector<size_t> found;
+
+				if (query.matchesAll())
+				{
+					for (size_t i = 0; i < sectionsCache.size(); ++i)
+					{
+						if (!sectionsCache[i].removed)
+						{
+							found.push_back(i);
+						}
+					}
+					return found;
+				}
+
+				// 没有前缀时只能逐个检查
+				const std::string& prefix = query.prefix();
+				if (prefix.empty() && !query.isExact())
+				{
+					for (size_t i = 0; i < sectionsCache.size(); ++i)
+					{
+						if (!sectionsCache[i].removed && query.matches(sectionsCache[i].getName()))
+						{
+							found.push_back(i);
+						}
+					}
+					return found;
+				}
+
+				if (!sectionIndexValid)
+				{
+					buildSectionIndex();
+				}
+
+				// 索引按 (名称, 位置) 排序，同一前缀的名称相邻；建立索引之后才删除的段仍在其中，需要跳过
+				auto it = std::lower_bound(sectionIndex.begin(), sectionIndex.end(), std::make_pair(prefix, size_t(0)));
+				for (; it != sectionIndex.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+				{
+					if (query.isExact() && it->first.size() != prefix.size())
+					{
+						break;
+					}
+					if (!sectionsCache[it->second].removed && query.matches(it->first))
+					{
+						found.push_back(it->second);
+					}
+				}
+
+				// 按文件顺序返回
+				std::sort(found.begin(), found.end());
+				return found;
+			}
+
+
+			std::vector<INISection> INIFile::getSections(const INIQuery& query)
+			{
+				std::vector<INISection> sections;
+				std::vector<size_t> found = findSections(query);
+
+				sections.reserve(found.size());
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					sections.push_back(sectionsCache[*i]);
+				}
+				return sections;
+			}
+
+
+			std::vector<std::string> INIFile::getSectionNames(const INIQuery& query)
+			{
+				std::vector<std::string> names;
+				std::vector<size_t> found = findSections(query);
+
+				names.reserve(found.size());
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					names.push_back(sectionsCache[*i].getName());
+				}
+				return names;
+			}
+
+
+			std::vector<std::pair<std::string, INIItem>> INIFile::getItems(const INIQuery& sections, const INIQuery& keys)
+			{
+				std::vector<std::pair<std::string, INIItem>> items;
+				std::vector<size_t> found = findSections(sections);
+
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					INISection& sect = sectionsCache[*i];
+					for (INISection::INIItemIterator item = sect.begin(); item != sect.end(); ++item)
+					{
+						if (keys.matches(item->key))
+						{
+							items.push_back({ sect.getName(), *item });
+						}
+					}
+				}
+				return items;
+			}
+
+
+			void INIFile::forEachSection(const INIQuery& query, std::function<void(INISection&)> visitor)
+			{
+				std::vector<size_t> found = findSections(query);
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					visitSection(*i, visitor);
+				}
+			}
+
+
+			void INIFile::visitSection(size_t position, const std::function<void(INISection&)>& visitor)
+			{
+				INISection& sect = sectionsCache[position];
+				std::string name = sect.name;
+
+				// 只有被订阅的段才需要保留原来的值用于通知
+				bool watched = watchers.count(name) != 0;
+				std::vector<std::pair<std::string, std::string>> entries;
+				if (watched)
+				{
+					entries = sect.getEntries();
+				}
+
+				uint64_t before = sect.fingerprint();
+				std::vector<uint64_t> hashes = sect.itemHashes();
+				visitor(sect);
+				sect.rehash(hashes);
+
+				uint64_t after = sect.fingerprint();
+				if (after == before)
+				{
+					return;
+				}
+
+				// 改动后依赖这些值的插值结果都要重新展开
+				updateFingerprint(before, after);
+				clearResolved();
+				if (watched)
+				{
+					notifyChanges(name, entries, sect.getEntries());
+				}
+			}
+
+
+		};
+	};
+};
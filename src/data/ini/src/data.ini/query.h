@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_QUERY_H_
+#define _TFC_DATA_FORMAT_INI_QUERY_H_
+
+#include "ini.h"
+
+#include <memory>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			class Regex;
+		};
+	};
+};
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 查询模式的写法
+			enum INIQueryType
+			{
+				INI_QUERY_EXACT,  // 名称完全相同
+				INI_QUERY_GLOB,   // 通配符，* 任意串，? 单个字节，[a-z] [!a] 字符集，\ 转义；需要匹配整个名称
+				INI_QUERY_REGEX   // util.regex 正则表达式，在名称中查找，需要匹配整个名称时使用 ^ 和 $
+			};
+
+
+			/*
+			* 预编译的段名或键名查询
+			* 构造时编译为 util.regex 的自动机，并提取所有匹配名称共同的前缀：
+			* 有前缀时 INIFile 只需在按名称排序的索引里访问以该前缀开头的段
+			*/
+			class INIQuery
+			{
+			public:
+
+				// 匹配所有名称
+				INIQuery();
+
+				// 模式无效时抛出 INIException(ERR_INVALID_PATTERN)
+				INIQuery(const std::string& pattern, INIQueryType type = INI_QUERY_GLOB);
+				INIQuery(const char* pattern, INIQueryType type = INI_QUERY_GLOB);
+
+			public:
+				bool matches(const char* name, size_t size) const;
+				bool matches(const std::string& name) const;
+
+				// 所有匹配的名称都以它开头，为空表示无法缩小范围
+				const std::string& prefix() const;
+
+				// 只匹配 prefix() 这一个名称
+				bool isExact() const;
+
+				bool matchesAll() const;
+
+				std::string pattern() const;
+				INIQueryType type() const;
+
+			private:
+				void compile();
+
+			private:
+				std::string source;
+				INIQueryType queryType;
+				std::string literalPrefix;
+				bool exact;
+				bool all;
+				bool whole;  // 需要整个名称匹配，否则在名称中查找
+				std::shared_ptr<const tfc::util::regex::Regex> matcher;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_QUERY_H_
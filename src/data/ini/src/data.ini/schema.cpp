@@ -0,0 +1,388 @@
+#include "schema.h"
+
+#include <cmath>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			static const char* valueTypeName(INIValueType type)
+			{
+				switch (type)
+				{
+				case INI_VALUE_STRING: return "string";
+				case INI_VALUE_INT64: return "int64";
+				case INI_VALUE_UINT64: return "uint64";
+				case INI_VALUE_DOUBLE: return "double";
+				case INI_VALUE_BOOL: return "bool";
+				case INI_VALUE_SIZE: return "size";
+				default: return "duration";
+				}
+			}
+
+
+			static ININumberKind numberKind(INIValueType type)
+			{
+				switch (type)
+				{
+				case INI_VALUE_INT64: return INI_NUMBER_INT64;
+				case INI_VALUE_UINT64: return INI_NUMBER_UINT64;
+				case INI_VALUE_SIZE: return INI_NUMBER_SIZE;
+				case INI_VALUE_DURATION: return INI_NUMBER_DURATION;
+				default: return INI_NUMBER_NONE;
+				}
+			}
+
+
+			// 整个 text 去掉首尾空格后是一个有限的浮点数
+			static bool parseReal(const std::string& text, double& value)
+			{
+				const char* begin = text.c_str();
+				while (*begin == ' ' || *begin == '\t')
+				{
+					begin++;
+				}
+				if (*begin == '\0')
+				{
+					return false;
+				}
+
+				char* end = NULL;
+				value = strtod(begin, &end);
+				while (*end == ' ' || *end == '\t')
+				{
+					end++;
+				}
+				return *end == '\0' && std::isfinite(value);
+			}
+
+
+			static void addError(std::vector<INISchemaError>& errors, INISchemaErrorType type, const std::string& section, const std::string& key, size_t line, const std::string& detail)
+			{
+				INISchemaError error;
+				error.type = type;
+				error.section = section;
+				error.key = key;
+				error.line = line;
+				error.message = "[" + section + "]" + (key.empty() ? "" : " " + key) + ": " + detail;
+				errors.push_back(std::move(error));
+			}
+
+
+			INISchemaKey::INISchemaKey(const std::string& _name, INIValueType _type) : name(_name), type(_type)
+			{
+			}
+
+
+			INISchemaKey& INISchemaKey::optional(bool isOptional)
+			{
+				required = !isOptional;
+				return *this;
+			}
+
+
+			INISchemaKey& INISchemaKey::range(const std::string& lower, const std::string& upper)
+			{
+				if (type == INI_VALUE_BOOL)
+				{
+					throw INIException(ERR_INVALID_NUMBER, "bool key `" + name + "` can not have a range");
+				}
+
+				hasMinimum = !lower.empty();
+				hasMaximum = !upper.empty();
+				if (hasMinimum)
+				{
+					parseBound(lower, minimum, minimumReal);
+				}
+				if (hasMaximum)
+				{
+					parseBound(upper, maximum, maximumReal);
+				}
+				rangeText = "[" + (hasMinimum ? lower : "-") + ", " + (hasMaximum ? upper : "-") + "]";
+				return *this;
+			}
+
+
+			INISchemaKey& INISchemaKey::pattern(const INIQuery& _pattern)
+			{
+				hasPattern = true;
+				valuePattern = _pattern;
+				return *this;
+			}
+
+
+			void INISchemaKey::parseBound(const std::string& text, int64_t& bound, double& real)
+			{
+				int ret = RET_OK;
+				if (type == INI_VALUE_DOUBLE)
+				{
+					ret = parseReal(text, real) ? RET_OK : ERR_INVALID_NUMBER;
+				}
+				else
+				{
+					// 字符串的范围是长度
+					ret = INIFile::parseNumber(text, type == INI_VALUE_STRING ? INI_NUMBER_UINT64 : numberKind(type), bound);
+				}
+
+				if (ret != RET_OK)
+				{
+					throw INIException(ERR_INVALID_NUMBER, "bound `" + text + "` of key `" + name + "` is not a valid " + valueTypeName(type));
+				}
+			}
+
+
+			bool INISchemaKey::inRange(int64_t value, double real) const
+			{
+				switch (type)
+				{
+				case INI_VALUE_DOUBLE:
+					return (!hasMinimum || real >= minimumReal) && (!hasMaximum || real <= maximumReal);
+				case INI_VALUE_INT64:
+				case INI_VALUE_DURATION:
+					return (!hasMinimum || value >= minimum) && (!hasMaximum || value <= maximum);
+				default:
+					return (!hasMinimum || static_cast<uint64_t>(value) >= static_cast<uint64_t>(minimum))
+						&& (!hasMaximum || static_cast<uint64_t>(value) <= static_cast<uint64_t>(maximum));
+				}
+			}
+
+
+			INISchemaSection::INISchemaSection(const INIQuery& _name) : name(_name)
+			{
+			}
+
+
+			INISchemaSection& INISchemaSection::optional(bool isOptional)
+			{
+				required = !isOptional;
+				return *this;
+			}
+
+
+			INISchemaSection& INISchemaSection::allowUnknownKeys(bool allow)
+			{
+				unknownKeysAllowed = allow;
+				return *this;
+			}
+
+
+			INISchemaKey& INISchemaSection::key(const std::string& keyName, INIValueType type)
+			{
+				auto found = keyIndex.find(keyName);
+				if (found != keyIndex.end())
+				{
+					return keys[found->second];
+				}
+
+				keyIndex.emplace(keyName, keys.size());
+				keys.push_back(INISchemaKey(keyName, type));
+				return keys.back();
+			}
+
+
+			INISchemaSection& INISchema::section(const INIQuery& name)
+			{
+				if (name.isExact())
+				{
+					auto found = exactSections.find(name.prefix());
+					if (found != exactSections.end())
+					{
+						return sections[found->second];
+					}
+					exactSections.emplace(name.prefix(), sections.size());
+				}
+				else
+				{
+					for (auto it = patternSections.begin(); it != patternSections.end(); ++it)
+					{
+						if (sections[*it].name.type() == name.type() && sections[*it].name.pattern() == name.pattern())
+						{
+							return sections[*it];
+						}
+					}
+					patternSections.push_back(sections.size());
+				}
+
+				sections.push_back(INISchemaSection(name));
+				return sections.back();
+			}
+
+
+			INISchema& INISchema::allowUnknownSections(bool allow)
+			{
+				unknownSectionsAllowed = allow;
+				return *this;
+			}
+
+
+			const INISchemaSection* INISchema::findSection(const std::string& name, size_t& index) const
+			{
+				auto found = exactSections.find(name);
+				if (found != exactSections.end())
+				{
+					index = found->second;
+					return &sections[index];
+				}
+
+				for (auto it = patternSections.begin(); it != patternSections.end(); ++it)
+				{
+					if (sections[*it].name.matches(name))
+					{
+						index = *it;
+						return &sections[index];
+					}
+				}
+				return NULL;
+			}
+
+
+			std::vector<INISchemaError> INIFile::validate(const INISchema& schema)
+			{
+				std::vector<INISchemaError> errors;
+				std::vector<char> sectionSeen(schema.sections.size(), 0);
+				std::vector<char> keySeen;
+
+				for (INISectionIterator sect = sectionsCache.begin(); sect != sectionsCache.end(); ++sect)
+				{
+					if (sect->removed)
+					{
+						continue;
+					}
+
+					// 无名段总是存在，没有键且没有专门声明时不算出现
+					if (sect->name.empty() && sect->length() == 0 && schema.exactSections.count("") == 0)
+					{
+						continue;
+					}
+
+					size_t index = 0;
+					const INISchemaSection* rule = schema.findSection(sect->name, index);
+					if (rule == NULL)
+					{
+						if (!schema.unknownSectionsAllowed)
+						{
+							addError(errors, INI_SCHEMA_UNKNOWN_SECTION, sect->name, "", sect->line, "section is not declared");
+						}
+						continue;
+					}
+
+					sectionSeen[index] = 1;
+					keySeen.assign(rule->keys.size(), 0);
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
+					{
+						auto found = rule->keyIndex.find(item->key);
+						if (found == rule->keyIndex.end())
+						{
+							if (!rule->unknownKeysAllowed)
+							{
+								addError(errors, INI_SCHEMA_UNKNOWN_KEY, sect->name, item->key, item->line, "key is not declared");
+							}
+							continue;
+						}
+
+						keySeen[found->second] = 1;
+						validateItem(*sect, item, rule->keys[found->second], errors);
+					}
+
+					for (size_t i = 0; i < rule->keys.size(); ++i)
+					{
+						if (!keySeen[i] && rule->keys[i].required)
+						{
+							addError(errors, INI_SCHEMA_MISSING_KEY, sect->name, rule->keys[i].name, sect->line, "required key is missing");
+						}
+					}
+				}
+
+				for (size_t i = 0; i < schema.sections.size(); ++i)
+				{
+					if (!sectionSeen[i] && schema.sections[i].required)
+					{
+						const INIQuery& name = schema.sections[i].name;
+						addError(errors, INI_SCHEMA_MISSING_SECTION, name.isExact() ? name.prefix() : name.pattern(), "", 0, "required section is missing");
+					}
+				}
+				return errors;
+			}
+
+
+			void INIFile::validateItem(INISection& sect, INISection::INIItemIterator item, const INISchemaKey& rule, std::vector<INISchemaError>& errors)
+			{
+				const std::string* text = &item->value;
+				bool interpolated = interpolationEnabled && item->value.find('$') != std::string::npos;
+				if (interpolated)
+				{
+					try
+					{
+						text = &resolveValue(sect.name, item->key, item->value);
+					}
+					catch (INIException& e)
+					{
+						addError(errors, INI_SCHEMA_INVALID_VALUE, sect.name, item->key, item->line, e.info());
+						return;
+					}
+				}
+
+				int ret = RET_OK;
+				int64_t number = 0;
+				double real = 0;
+				bool flag = false;
+				switch (rule.type)
+				{
+				case INI_VALUE_STRING:
+					number = static_cast<int64_t>(text->size());
+					break;
+				case INI_VALUE_DOUBLE:
+					ret = parseReal(*text, real) ? RET_OK : ERR_INVALID_NUMBER;
+					break;
+				case INI_VALUE_BOOL:
+					ret = matchBoolean(*text, flag) ? RET_OK : ERR_INVALID_NUMBER;
+					break;
+				default:
+				{
+					// 与 getNumber 共用段内的缓存，检查过的值之后按单位读取时不再解析
+					ININumberKind kind = numberKind(rule.type);
+					INIParsedNumber* cached = interpolated ? NULL : &sect.parsedNumber(item);
+					if (cached != NULL && cached->kind == kind)
+					{
+						number = cached->value;
+						break;
+					}
+					ret = parseNumber(*text, kind, number);
+					if (ret == RET_OK && cached != NULL)
+					{
+						cached->kind = kind;
+						cached->value = number;
+					}
+					break;
+				}
+				}
+
+				if (ret == ERR_INVALID_NUMBER)
+				{
+					addError(errors, INI_SCHEMA_INVALID_VALUE, sect.name, item->key, item->line,
+						"value `" + *text + "` is not a valid " + valueTypeName(rule.type));
+				}
+				else if (ret == ERR_NUMBER_OUT_OF_RANGE)
+				{
+					addError(errors, INI_SCHEMA_OUT_OF_RANGE, sect.name, item->key, item->line,
+						"value `" + *text + "` is out of range for " + valueTypeName(rule.type));
+				}
+				else if (!rule.inRange(number, real))
+				{
+					addError(errors, INI_SCHEMA_OUT_OF_RANGE, sect.name, item->key, item->line,
+						(rule.type == INI_VALUE_STRING ? "length of value `" : "value `") + *text + "` is out of range " + rule.rangeText);
+				}
+				else if (rule.hasPattern && !rule.valuePattern.matches(*text))
+				{
+					addError(errors, INI_SCHEMA_PATTERN_MISMATCH, sect.name, item->key, item->line,
+						"value `" + *text + "` does not match `" + rule.valuePattern.pattern() + "`");
+				}
+			}
+
+
+		};
+	};
+};
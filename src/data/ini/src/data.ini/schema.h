@@ -0,0 +1,172 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_SCHEMA_H_
+#define _TFC_DATA_FORMAT_INI_SCHEMA_H_
+
+#include "ini.h"
+#include "query.h"
+
+#include <deque>
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 模式中键的值类型，数值类型的写法与 getInt64Value 等按单位读取的接口相同
+			enum INIValueType
+			{
+				INI_VALUE_STRING,
+				INI_VALUE_INT64,
+				INI_VALUE_UINT64,
+				INI_VALUE_DOUBLE,
+				INI_VALUE_BOOL,      // 按 customBooleans 设置的真假值判断
+				INI_VALUE_SIZE,
+				INI_VALUE_DURATION
+			};
+
+
+			enum INISchemaErrorType
+			{
+				INI_SCHEMA_MISSING_SECTION,   // 必需的段不存在
+				INI_SCHEMA_MISSING_KEY,       // 段中缺少必需的键，line 是段头的行号
+				INI_SCHEMA_UNKNOWN_SECTION,   // 不允许未声明的段时出现了未声明的段
+				INI_SCHEMA_UNKNOWN_KEY,       // 不允许未声明的键时出现了未声明的键
+				INI_SCHEMA_INVALID_VALUE,     // 值不是声明的类型，或插值展开失败
+				INI_SCHEMA_OUT_OF_RANGE,      // 值超出声明的范围
+				INI_SCHEMA_PATTERN_MISMATCH   // 值与声明的模式不匹配
+			};
+
+
+			// line 为 0 表示没有对应的行，如缺少的段、无名段或不是从文件加载的内容
+			struct INISchemaError
+			{
+				INISchemaErrorType type;
+				std::string section;
+				std::string key;
+				size_t line;
+				std::string message;
+			};
+
+
+			/*
+			* 一个键的规则，默认为必需的字符串
+			* 范围的上下限按键的类型解析，写法与值相同，如 range("4KB", "1GB")、range("100ms", "30s")；
+			* 字符串的范围是长度，布尔值不能设置范围。上下限为空表示不限，不能解析时抛出 ERR_INVALID_NUMBER
+			*/
+			class INISchemaKey
+			{
+			public:
+				INISchemaKey& optional(bool isOptional = true);
+				INISchemaKey& range(const std::string& lower, const std::string& upper);
+
+				// 值需要与 pattern 匹配，正则表达式需要匹配整个值时使用 ^ 和 $
+				INISchemaKey& pattern(const INIQuery& pattern);
+
+			private:
+				friend class INISchemaSection;
+				friend class INIFile;
+
+				INISchemaKey(const std::string& name, INIValueType type);
+
+				// 把范围的一端解析为与值相同的表示，数值类型存入 bound，浮点数存入 real
+				void parseBound(const std::string& text, int64_t& bound, double& real);
+
+				// 已按类型解析的值是否在范围内，字符串传入长度
+				bool inRange(int64_t value, double real) const;
+
+				std::string name;
+				INIValueType type;
+				bool required = true;
+
+				bool hasMinimum = false;
+				bool hasMaximum = false;
+				int64_t minimum = 0;       // 无符号的类型按位存放
+				int64_t maximum = 0;
+				double minimumReal = 0;
+				double maximumReal = 0;
+				std::string rangeText;     // 错误信息中显示的原文，如 [1, 65535]
+
+				bool hasPattern = false;
+				INIQuery valuePattern;
+
+			};
+
+
+			/*
+			* 一个段或一组同名模式的段的规则，默认必需，允许出现未声明的键
+			* 同一个段出现多次时，每一次都要满足这些规则
+			*/
+			class INISchemaSection
+			{
+			public:
+				INISchemaSection& optional(bool isOptional = true);
+				INISchemaSection& allowUnknownKeys(bool allow = true);
+
+				// 声明一个键，已经声明过时返回原来的规则，type 以第一次声明为准
+				INISchemaKey& key(const std::string& name, INIValueType type = INI_VALUE_STRING);
+
+			private:
+				friend class INISchema;
+				friend class INIFile;
+
+				INISchemaSection(const INIQuery& name);
+
+				INIQuery name;
+				bool required = true;
+				bool unknownKeysAllowed = true;
+
+				// 键的规则及按键名的索引，声明时即建立；deque 保证返回的引用一直有效
+				std::deque<INISchemaKey> keys;
+				std::unordered_map<std::string, size_t> keyIndex;
+
+			};
+
+
+			/*
+			* 预先描述文件应有的段和键，由 INIFile::validate 一遍检查完毕
+			* 声明的同时就编译为查找表：段名完全确定的段按名称哈希，通配符和正则表达式的段按声明顺序逐个匹配，
+			* 每个段内的键按名称哈希；范围在声明时解析，模式在声明时编译，检查时不再做任何预处理。
+			*
+			* INISchema schema;
+			* schema.section("server").key("port", INI_VALUE_INT64).range("1", "65535");
+			* schema.section("server").key("timeout", INI_VALUE_DURATION).optional().range("", "5min");
+			* schema.section("db.*").optional().key("url").pattern(INIQuery("^[a-z]+://", INI_QUERY_REGEX));
+			* std::vector<INISchemaError> errors = file.validate(schema);
+			*/
+			class INISchema
+			{
+			public:
+
+				/*
+				* 声明一个段，已经声明过同样的模式时返回原来的规则
+				* 字符串按通配符处理，名称中含有通配符本身时使用 INIQuery(name, INI_QUERY_EXACT)；
+				* 模式可以匹配多个段时，必需表示至少有一个段与之匹配
+				*/
+				INISchemaSection& section(const INIQuery& name);
+
+				// 默认允许出现未声明的段
+				INISchema& allowUnknownSections(bool allow = true);
+
+			private:
+				friend class INIFile;
+
+				// name 所对应的规则，没有时返回 NULL；名称完全相同的优先，其次是第一个匹配的模式
+				const INISchemaSection* findSection(const std::string& name, size_t& index) const;
+
+				std::deque<INISchemaSection> sections;
+				std::unordered_map<std::string, size_t> exactSections;
+				std::vector<size_t> patternSections;
+				bool unknownSectionsAllowed = true;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_SCHEMA_H_
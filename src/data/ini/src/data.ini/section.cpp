@@ -6,24 +6,75 @@ namespace tfc
 	{
 		namespace ini
 		{
+			static inline uint64_t hashItem(const std::string& key, const std::string& value)
+			{
+				uint64_t h = hashBytes(key.data(), key.size());
+				h = hashBytes("\0", 1, h);
+				return mixHash(hashBytes(value.data(), value.size(), h));
+			}
+
 			INISection::INIItemIterator INISection::begin()
 			{
-				return items.begin();
+				return INIItemIterator(this, 0);
 			}
 
 			INISection::INIItemIterator INISection::end()
 			{
-				return items.end();
+				return INIItemIterator(this, items.size());
 			}
 
-			bool INISection::hasKey(std::string key)
+			bool INISection::hasKey(const std::string& key)
 			{
-				return false;
+				return findItem(key) != end();
 			}
 
 			size_t INISection::length()
 			{
-				return items.size();
+				return items.size() - removedCount;
+			}
+
+			INISection::INIItemIterator INISection::findItem(const std::string& key)
+			{
+				if (items.size() < INI_KEY_INDEX_MIN)
+				{
+					for (INIItemIterator it = begin(); it != end(); ++it)
+					{
+						if (it->key == key)
+						{
+							return it;
+						}
+					}
+					return end();
+				}
+
+				if (!keyIndexValid)
+				{
+					buildKeyIndex();
+				}
+				auto found = keyIndex.find(key);
+				if (found == keyIndex.end())
+				{
+					return end();
+				}
+				return INIItemIterator(this, found->second);
+			}
+
+			void INISection::buildKeyIndex()
+			{
+				keyIndex.clear();
+				duplicateKeys = false;
+				for (size_t i = 0; i < items.size(); ++i)
+				{
+					if (removedCount != 0 && removedItems[i])
+					{
+						continue;
+					}
+					if (!keyIndex.emplace(items[i].key, i).second)
+					{
+						duplicateKeys = true;
+					}
+				}
+				keyIndexValid = true;
 			}
 
 			std::string INISection::getName()
@@ -33,8 +84,13 @@ namespace tfc
 
 			void INISection::setName(std::string _name)
 			{
-				debug()
 				name = _name;
+				nameHash = hashBytes(name.data(), name.size());
+			}
+
+			size_t INISection::getLine()
+			{
+				return line;
 			}
 
 			std::string INISection::getComment()
@@ -59,18 +115,208 @@ namespace tfc
 
 			std::vector<INIItem> INISection::getItems()
 			{
-				return items;
+				if (removedCount == 0)
+				{
+					return items;
+				}
+				return std::vector<INIItem>(begin(), end());
 			}
 
 			void INISection::pushItem(INIItem item)
 			{
-				items.push_back(item);
-				std::cout << "------ items.push_back() ------ \n" << items.empty() << std::endl;
+				if (keyIndexValid && !keyIndex.emplace(item.key, items.size()).second)
+				{
+					duplicateKeys = true;
+				}
+				if (!removedItems.empty())
+				{
+					removedItems.push_back(0);
+				}
+				if (!parsedNumbers.empty())
+				{
+					parsedNumbers.push_back(INIParsedNumber());
+				}
+				if (!valueLayouts.empty())
+				{
+					valueLayouts.push_back(INIValueLayout());
+				}
+				contentHash += hashItem(item.key, item.value);
+				items.push_back(std::move(item));
+			}
+
+			void INISection::pushItem(INIItem item, INIValueLayout layout)
+			{
+				pushItem(std::move(item));
+				if (layout.indent.empty() && layout.breaks.empty())
+				{
+					return;
+				}
+				if (valueLayouts.empty())
+				{
+					valueLayouts.resize(items.size());
+				}
+				valueLayouts.back() = std::move(layout);
 			}
 
 			INISection::INIItemIterator INISection::eraseItem(INIItemIterator item)
 			{
-				return items.erase(item);
+				size_t index = item.index;
+
+				if (removedItems.empty())
+				{
+					removedItems.assign(items.size(), 0);
+				}
+				removedItems[index] = 1;
+				removedCount++;
+				contentHash -= hashItem(items[index].key, items[index].value);
+
+				// 有重名的键时，删掉第一个后要让下一个可见，只能重建索引
+				if (keyIndexValid)
+				{
+					if (duplicateKeys)
+					{
+						keyIndexValid = false;
+					}
+					else
+					{
+						keyIndex.erase(items[index].key);
+					}
+				}
+				items[index] = INIItem();
+				if (!valueLayouts.empty())
+				{
+					valueLayouts[index] = INIValueLayout();
+				}
+
+				if (removedCount < INI_COMPACT_MIN || removedCount * INI_COMPACT_RATIO < items.size())
+				{
+					return INIItemIterator(this, index + 1);
+				}
+
+				// 压缩后下一项的位置是它之前仍然存活的项数
+				size_t next = std::count(removedItems.begin(), removedItems.begin() + index + 1, 0);
+				compact();
+				return INIItemIterator(this, next);
+			}
+
+			void INISection::compact()
+			{
+				if (removedCount == 0)
+				{
+					return;
+				}
+
+				size_t kept = 0;
+				for (size_t i = 0; i < items.size(); ++i)
+				{
+					if (removedItems[i])
+					{
+						continue;
+					}
+					if (kept != i)
+					{
+						items[kept] = std::move(items[i]);
+						if (!parsedNumbers.empty())
+						{
+							parsedNumbers[kept] = parsedNumbers[i];
+						}
+						if (!valueLayouts.empty())
+						{
+							valueLayouts[kept] = std::move(valueLayouts[i]);
+						}
+					}
+					kept++;
+				}
+				items.resize(kept);
+				if (!parsedNumbers.empty())
+				{
+					parsedNumbers.resize(kept);
+				}
+				if (!valueLayouts.empty())
+				{
+					valueLayouts.resize(kept);
+				}
+
+				std::vector<char>().swap(removedItems);
+				removedCount = 0;
+				keyIndexValid = false;
+			}
+
+			void INISection::setValue(INIItemIterator item, const std::string& value)
+			{
+				contentHash -= hashItem(item->key, item->value);
+				item->value = value;
+				contentHash += hashItem(item->key, item->value);
+				if (!parsedNumbers.empty())
+				{
+					parsedNumbers[item.index] = INIParsedNumber();
+				}
+
+				// 反斜杠续行的位置对新值没有意义，缩进仍沿用原来的
+				if (!valueLayouts.empty())
+				{
+					valueLayouts[item.index].breaks.clear();
+				}
+			}
+
+			std::vector<uint64_t> INISection::itemHashes()
+			{
+				std::vector<uint64_t> hashes(items.size(), 0);
+				for (INIItemIterator it = begin(); it != end(); ++it)
+				{
+					hashes[it.index] = hashItem(it->key, it->value);
+				}
+				return hashes;
+			}
+
+			void INISection::rehash(const std::vector<uint64_t>& before)
+			{
+				// 期间压缩过时下标会错开，错开的项都按有变化处理，只是多丢一些缓存
+				bool changed = items.size() != before.size();
+				contentHash = 0;
+				for (INIItemIterator it = begin(); it != end(); ++it)
+				{
+					uint64_t hash = hashItem(it->key, it->value);
+					contentHash += hash;
+					if (it.index < before.size() && before[it.index] == hash)
+					{
+						continue;
+					}
+
+					changed = true;
+					if (!parsedNumbers.empty())
+					{
+						parsedNumbers[it.index] = INIParsedNumber();
+					}
+					if (!valueLayouts.empty())
+					{
+						valueLayouts[it.index].breaks.clear();
+					}
+				}
+
+				if (changed)
+				{
+					keyIndexValid = false;
+				}
+			}
+
+			INIParsedNumber& INISection::parsedNumber(INIItemIterator item)
+			{
+				if (parsedNumbers.empty())
+				{
+					parsedNumbers.resize(items.size());
+				}
+				return parsedNumbers[item.index];
+			}
+
+			const INIValueLayout* INISection::valueLayout(INIItemIterator item)
+			{
+				return valueLayouts.empty() ? NULL : &valueLayouts[item.index];
+			}
+
+			uint64_t INISection::fingerprint()
+			{
+				return mixHash(nameHash ^ mixHash(contentHash));
 			}
 
 			std::vector<std::pair<std::string, std::string>> INISection::getEntries()
@@ -88,7 +334,6 @@ namespace tfc
 
 			std::vector<std::string> INISection::getKeys()
 			{
-				std::cout << this->items.size() << std::endl;
 				std::vector<std::string> keys;
 				for (INISection::INIItemIterator i = this->begin(); i != this->end(); ++i)
 				{
@@ -0,0 +1,385 @@
+#include "shm.h"
+
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			static const char SHARED_MAGIC[8] = { 'T', 'F', 'C', 'I', 'N', 'I', 'S', '1' };
+
+			// 读者以只读方式映射控制段，代数用 32 位以保证原子读取不需要写内存
+			static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared generation counter must be lock-free");
+
+
+			struct INISharedControl
+			{
+				char magic[8];
+				std::atomic<uint32_t> generation;   // 0 表示尚未发布
+			};
+
+
+			// 一段映射到本进程的命名共享内存，析构时解除映射
+			class INISharedSegment
+			{
+			public:
+				// 创建新段；POSIX 下先删除同名的残留段
+				static std::shared_ptr<INISharedSegment> create(const std::string& name, size_t size);
+
+				// 打开已有的段，不存在或创建者还没有设置大小时返回 NULL
+				static std::shared_ptr<INISharedSegment> open(const std::string& name, bool writable);
+
+				// 删除名字，已有的映射仍然有效；Windows 下段随最后一个句柄关闭而消失，这里什么也不做
+				static void remove(const std::string& name);
+
+				~INISharedSegment();
+
+				char* data;
+				size_t size;
+
+			private:
+				INISharedSegment();
+
+#ifdef _WIN32
+				HANDLE mapping;
+#endif
+
+			};
+
+
+			INISharedSegment::INISharedSegment()
+				: data(NULL), size(0)
+			{
+#ifdef _WIN32
+				mapping = NULL;
+#endif
+			}
+
+
+			INISharedSegment::~INISharedSegment()
+			{
+#ifdef _WIN32
+				if (data != NULL)
+				{
+					UnmapViewOfFile(data);
+				}
+				if (mapping != NULL)
+				{
+					CloseHandle(mapping);
+				}
+#else
+				if (data != NULL)
+				{
+					munmap(data, size);
+				}
+#endif
+			}
+
+
+			std::shared_ptr<INISharedSegment> INISharedSegment::create(const std::string& name, size_t size)
+			{
+				std::shared_ptr<INISharedSegment> segment(new INISharedSegment());
+#ifdef _WIN32
+				uint64_t length = size;
+				segment->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+					static_cast<DWORD>(length >> 32), static_cast<DWORD>(length), name.c_str());
+				if (segment->mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to create shared memory `" + name + "`");
+				}
+				segment->data = static_cast<char*>(MapViewOfFile(segment->mapping, FILE_MAP_WRITE, 0, 0, size));
+				if (segment->data == NULL)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to map shared memory `" + name + "`");
+				}
+				segment->size = size;
+#else
+				shm_unlink(name.c_str());
+				int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+				if (fd < 0)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to create shared memory `" + name + "`");
+				}
+				if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+				{
+					close(fd);
+					shm_unlink(name.c_str());
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to resize shared memory `" + name + "`");
+				}
+
+				void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close(fd);
+				if (data == MAP_FAILED)
+				{
+					shm_unlink(name.c_str());
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to map shared memory `" + name + "`");
+				}
+				segment->data = static_cast<char*>(data);
+				segment->size = size;
+#endif
+				return segment;
+			}
+
+
+			std::shared_ptr<INISharedSegment> INISharedSegment::open(const std::string& name, bool writable)
+			{
+				std::shared_ptr<INISharedSegment> segment(new INISharedSegment());
+#ifdef _WIN32
+				DWORD access = writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+				segment->mapping = OpenFileMappingA(access, FALSE, name.c_str());
+				if (segment->mapping == NULL)
+				{
+					return NULL;
+				}
+				segment->data = static_cast<char*>(MapViewOfFile(segment->mapping, access, 0, 0, 0));
+				if (segment->data == NULL)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to map shared memory `" + name + "`");
+				}
+
+				// 映射的大小按页取整，镜像自己记录了实际长度
+				MEMORY_BASIC_INFORMATION info;
+				VirtualQuery(segment->data, &info, sizeof(info));
+				segment->size = info.RegionSize;
+#else
+				int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+				if (fd < 0)
+				{
+					return NULL;
+				}
+
+				struct stat st;
+				if (fstat(fd, &st) != 0)
+				{
+					close(fd);
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to stat shared memory `" + name + "`");
+				}
+				if (st.st_size == 0)
+				{
+					close(fd);
+					return NULL;
+				}
+
+				size_t size = static_cast<size_t>(st.st_size);
+				void* data = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+				close(fd);
+				if (data == MAP_FAILED)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "failed to map shared memory `" + name + "`");
+				}
+				segment->data = static_cast<char*>(data);
+				segment->size = size;
+#endif
+				return segment;
+			}
+
+
+			void INISharedSegment::remove(const std::string& name)
+			{
+#ifndef _WIN32
+				shm_unlink(name.c_str());
+#endif
+			}
+
+
+			static std::string controlName(const std::string& name)
+			{
+#ifdef _WIN32
+				return name;
+#else
+				return name.empty() || name[0] != '/' ? "/" + name : name;
+#endif
+			}
+
+
+			static inline std::string imageName(const std::string& control, uint32_t generation)
+			{
+				return control + "." + std::to_string(generation);
+			}
+
+
+			// 最新代数为 last 时仍保留的最早一个版本
+			static inline uint32_t firstKept(uint32_t last)
+			{
+				return last >= INI_SHARED_KEEP_GENERATIONS ? last - INI_SHARED_KEEP_GENERATIONS + 1 : 1;
+			}
+
+
+			/*
+			* 控制段是否已经写好标识
+			* 发布者创建段之后才写入标识，这之间打开它会看到全 0 或只写了一部分的标识，按尚未写好处理返回 false；
+			* 标识与 SHARED_MAGIC 不符时抛出异常
+			*/
+			static bool controlReady(const std::shared_ptr<INISharedSegment>& segment, const std::string& name)
+			{
+				if (segment->size < sizeof(INISharedControl))
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "shared memory `" + name + "` is not an INI publication");
+				}
+
+				bool ready = true;
+				for (size_t i = 0; i < sizeof(SHARED_MAGIC); ++i)
+				{
+					if (segment->data[i] != SHARED_MAGIC[i])
+					{
+						if (segment->data[i] != '\0')
+						{
+							throw INIException(ERR_SHARED_MEMORY_FAILED, "shared memory `" + name + "` is not an INI publication");
+						}
+						ready = false;
+					}
+				}
+				return ready;
+			}
+
+
+			static INISharedControl* controlOf(const std::shared_ptr<INISharedSegment>& segment, const std::string& name)
+			{
+				if (segment->size < sizeof(INISharedControl) || memcmp(segment->data, SHARED_MAGIC, sizeof(SHARED_MAGIC)) != 0)
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "shared memory `" + name + "` is not an INI publication");
+				}
+				return reinterpret_cast<INISharedControl*>(segment->data);
+			}
+
+
+			INISharedPublisher::INISharedPublisher(const std::string& _name)
+				: name(controlName(_name))
+			{
+				control = INISharedSegment::open(name, true);
+				if (control == NULL)
+				{
+					control = INISharedSegment::create(name, sizeof(INISharedControl));
+				}
+
+				// 新建的段，或上一个发布者还没写好标识就退出了留下的段
+				if (!controlReady(control, name))
+				{
+					INISharedControl* block = new (control->data) INISharedControl;
+					block->generation.store(0, std::memory_order_relaxed);
+					memcpy(block->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC));
+					return;
+				}
+
+				// 接替上一个发布者，它留下的镜像段在之后发布时一并删除
+				uint32_t last = controlOf(control, name)->generation.load(std::memory_order_relaxed);
+				for (uint32_t gen = firstKept(last); gen <= last; ++gen)
+				{
+					published.push_back(std::make_pair(gen, std::shared_ptr<INISharedSegment>()));
+				}
+			}
+
+
+			uint32_t INISharedPublisher::publish(const INIFrozenFile& image)
+			{
+				INISharedControl* block = controlOf(control, name);
+				uint32_t next = block->generation.load(std::memory_order_relaxed) + 1;
+
+				std::shared_ptr<INISharedSegment> segment = INISharedSegment::create(imageName(name, next), image.size());
+				memcpy(segment->data, image.data(), image.size());
+
+				// 镜像写完之后才让读者看到新的代数
+				block->generation.store(next, std::memory_order_release);
+
+				published.push_back(std::make_pair(next, segment));
+				while (published.size() > INI_SHARED_KEEP_GENERATIONS)
+				{
+					INISharedSegment::remove(imageName(name, published.front().first));
+					published.erase(published.begin());
+				}
+				return next;
+			}
+
+
+			uint32_t INISharedPublisher::publish(INIFile& file)
+			{
+				return publish(file.freeze());
+			}
+
+
+			uint32_t INISharedPublisher::generation() const
+			{
+				return controlOf(control, name)->generation.load(std::memory_order_relaxed);
+			}
+
+
+			void INISharedPublisher::unlink()
+			{
+				uint32_t last = generation();
+				for (uint32_t gen = firstKept(last); gen <= last; ++gen)
+				{
+					INISharedSegment::remove(imageName(name, gen));
+				}
+				INISharedSegment::remove(name);
+				published.clear();
+			}
+
+
+			INISharedReader::INISharedReader(const std::string& _name)
+				: name(controlName(_name)), currentGeneration(0)
+			{
+				// 发布者刚创建、还没写好标识的控制段同样按不存在处理
+				control = INISharedSegment::open(name, false);
+				if (control == NULL || !controlReady(control, name))
+				{
+					throw INIException(ERR_SHARED_MEMORY_FAILED, "shared memory `" + name + "` was not found");
+				}
+				refresh();
+			}
+
+
+			bool INISharedReader::refresh()
+			{
+				const INISharedControl* block = reinterpret_cast<const INISharedControl*>(control->data);
+				uint32_t latest = block->generation.load(std::memory_order_acquire);
+
+				while (latest != currentGeneration)
+				{
+					std::shared_ptr<INISharedSegment> segment = INISharedSegment::open(imageName(name, latest), false);
+					if (segment != NULL)
+					{
+						image = INIFrozenFile::attach(segment, segment->data, segment->size);
+						currentGeneration = latest;
+						return true;
+					}
+
+					// 打开之前发布者又发布了几个版本，这个段已被删除，换成最新的代数再试
+					uint32_t next = block->generation.load(std::memory_order_acquire);
+					if (next == latest)
+					{
+						throw INIException(ERR_SHARED_MEMORY_FAILED, "shared memory `" + imageName(name, latest) + "` was not found");
+					}
+					latest = next;
+				}
+				return false;
+			}
+
+
+			const INIFrozenFile& INISharedReader::current() const
+			{
+				return image;
+			}
+
+
+			uint32_t INISharedReader::generation() const
+			{
+				return currentGeneration;
+			}
+
+
+		};
+	};
+};
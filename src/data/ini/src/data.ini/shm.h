@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_SHM_H_
+#define _TFC_DATA_FORMAT_INI_SHM_H_
+
+#include "frozen.h"
+
+// 发布新版本后仍保留的镜像段个数，刚读到旧代数的读者还来得及打开它
+#define INI_SHARED_KEEP_GENERATIONS 2
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			class INISharedSegment;
+
+
+			/*
+			* 把冻结镜像发布到命名共享内存，供同一台机器上的其他进程只读使用
+			* 控制段 <name> 中只有一个原子的代数；每次发布先把镜像完整写进新段 <name>.<代数>，再更新代数。
+			* 读者发现代数变化后映射新段，已经映射的旧版本在读者放下之前一直有效，双方都不加锁。
+			* 同一个名字只应有一个发布者；POSIX 下发布者退出后段仍然存在，直到调用 unlink()
+			*/
+			class INISharedPublisher
+			{
+			public:
+				// name 形如 "/app-config"，POSIX 下不以 '/' 开头时自动补上
+				INISharedPublisher(const std::string& name);
+
+				// 发布一个新版本，返回它的代数，第一个版本为 1
+				uint32_t publish(const INIFrozenFile& image);
+				uint32_t publish(INIFile& file);
+
+				uint32_t generation() const;
+
+				// 删除控制段和保留的镜像段，已经映射的读者不受影响
+				void unlink();
+
+			private:
+				std::string name;
+				std::shared_ptr<INISharedSegment> control;
+
+				// 仍保留的版本，从旧到新
+				std::vector<std::pair<uint32_t, std::shared_ptr<INISharedSegment>>> published;
+
+			};
+
+
+			/*
+			* 映射发布者写好的镜像，查找直接在共享内存上进行，不解析也不复制
+			* 每个读者对象只应由一个线程使用
+			*/
+			class INISharedReader
+			{
+			public:
+				// 控制段不存在或发布者还没有写好时抛出 ERR_SHARED_MEMORY_FAILED
+				INISharedReader(const std::string& name);
+
+				// 有新版本时切换过去并返回 true；尚未发布或已是最新时只读取一次代数
+				bool refresh();
+
+				/*
+				* 当前版本，尚未发布任何版本时为空文件
+				* refresh() 会替换它，需要跨版本保留时复制一份 INIFrozenFile，复制只增加映射的引用计数
+				*/
+				const INIFrozenFile& current() const;
+
+				uint32_t generation() const;
+
+			private:
+				std::string name;
+				std::shared_ptr<INISharedSegment> control;
+				uint32_t currentGeneration;
+				INIFrozenFile image;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_SHM_H_
@@ -0,0 +1,395 @@
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+			static const size_t NO_NODE = static_cast<size_t>(-1);
+
+
+			// name 是 parent 本身或位于 parent 之下，parent 为空时包含所有段
+			static bool isSubsection(const std::string& name, const std::string& parent)
+			{
+				if (parent.empty() || name == parent)
+				{
+					return true;
+				}
+				return name.size() > parent.size() && name[parent.size()] == '.' && name.compare(0, parent.size(), parent) == 0;
+			}
+
+
+			void INIFile::enableSectionTree(bool enable)
+			{
+				sectionTreeEnabled = enable;
+				if (enable)
+				{
+					rebuildSectionTree();
+					return;
+				}
+
+				std::vector<INISectionNode>().swap(sectionNodes);
+				std::vector<size_t>().swap(freeNodes);
+				std::vector<uint64_t>().swap(sectionIds);
+			}
+
+
+			bool INIFile::isSectionTreeEnabled()
+			{
+				return sectionTreeEnabled;
+			}
+
+
+			void INIFile::rebuildSectionTree()
+			{
+				sectionNodes.assign(1, INISectionNode());
+				freeNodes.clear();
+				sectionIds.clear();
+				sectionIds.reserve(sectionsCache.size());
+				nextSectionId = 0;
+
+				// 墓碑也占一个编号，使 sectionIds 与 sectionsCache 保持一一对应
+				for (INISectionIterator it = sectionsCache.begin(); it != sectionsCache.end(); ++it)
+				{
+					uint64_t id = nextSectionId++;
+					sectionIds.push_back(id);
+					if (!it->removed)
+					{
+						sectionNodes[findNode(it->getName(), true)].sections.push_back(id);
+					}
+				}
+			}
+
+
+			// 按 '.' 逐级查找节点，create 为 true 时补齐不存在的节点
+			size_t INIFile::findNode(const std::string& name, bool create)
+			{
+				size_t node = 0;
+				if (name.empty())
+				{
+					return node;
+				}
+
+				size_t begin = 0;
+				while (true)
+				{
+					size_t dot = name.find('.', begin);
+					size_t end = dot == std::string::npos ? name.size() : dot;
+					std::string& component = lookupComponent;
+					component.assign(name, begin, end - begin);
+
+					auto child = sectionNodes[node].children.find(component);
+					if (child != sectionNodes[node].children.end())
+					{
+						node = child->second;
+					}
+					else if (!create)
+					{
+						return NO_NODE;
+					}
+					else
+					{
+						size_t fresh;
+						if (!freeNodes.empty())
+						{
+							fresh = freeNodes.back();
+							freeNodes.pop_back();
+						}
+						else
+						{
+							fresh = sectionNodes.size();
+							sectionNodes.push_back(INISectionNode());
+						}
+						sectionNodes[node].children.emplace(component, fresh);
+						node = fresh;
+					}
+
+					if (dot == std::string::npos)
+					{
+						return node;
+					}
+					begin = dot + 1;
+				}
+			}
+
+
+			// 回收整棵子树的节点，调用前需要先从父节点中摘除
+			void INIFile::releaseNode(size_t node)
+			{
+				std::vector<size_t> pending(1, node);
+				while (!pending.empty())
+				{
+					size_t current = pending.back();
+					pending.pop_back();
+
+					for (auto child = sectionNodes[current].children.begin(); child != sectionNodes[current].children.end(); ++child)
+					{
+						pending.push_back(child->second);
+					}
+					sectionNodes[current].children.clear();
+					sectionNodes[current].sections.clear();
+					freeNodes.push_back(current);
+				}
+			}
+
+
+			// 从 name 对应的节点逐级向上，回收既没有段也没有子节点的节点，根节点始终保留
+			void INIFile::pruneNodes(const std::string& name)
+			{
+				if (name.empty())
+				{
+					return;
+				}
+
+				// 记下路径上的节点和每一级名称的起始位置
+				std::vector<std::pair<size_t, size_t>> path(1, std::make_pair(size_t(0), size_t(0)));
+				size_t begin = 0;
+				while (true)
+				{
+					size_t dot = name.find('.', begin);
+					lookupComponent.assign(name, begin, (dot == std::string::npos ? name.size() : dot) - begin);
+					auto child = sectionNodes[path.back().first].children.find(lookupComponent);
+					if (child == sectionNodes[path.back().first].children.end())
+					{
+						return;
+					}
+					path.push_back(std::make_pair(child->second, begin));
+
+					if (dot == std::string::npos)
+					{
+						break;
+					}
+					begin = dot + 1;
+				}
+
+				for (size_t i = path.size() - 1; i > 0; --i)
+				{
+					size_t node = path[i].first;
+					if (!sectionNodes[node].sections.empty() || !sectionNodes[node].children.empty())
+					{
+						return;
+					}
+
+					size_t dot = name.find('.', path[i].second);
+					lookupComponent.assign(name, path[i].second, (dot == std::string::npos ? name.size() : dot) - path[i].second);
+					sectionNodes[path[i - 1].first].children.erase(lookupComponent);
+					freeNodes.push_back(node);
+				}
+			}
+
+
+			void INIFile::attachSection(size_t position)
+			{
+				// 追加到末尾的段位置最大，排在同名段之后，按名称插入即可保持索引有序
+				if (sectionIndexValid)
+				{
+					if (position + 1 == sectionsCache.size())
+					{
+						std::pair<std::string, size_t> entry(sectionsCache[position].getName(), position);
+						sectionIndex.insert(std::upper_bound(sectionIndex.begin(), sectionIndex.end(), entry), std::move(entry));
+					}
+					else
+					{
+						sectionIndexValid = false;
+					}
+				}
+
+				if (!sectionTreeEnabled)
+				{
+					return;
+				}
+
+				// 编号必须与位置同序，插入到中间（只有补建无名段时插到开头）时整体重建
+				if (position != sectionIds.size())
+				{
+					rebuildSectionTree();
+					return;
+				}
+
+				uint64_t id = nextSectionId++;
+				sectionIds.push_back(id);
+				sectionNodes[findNode(sectionsCache[position].getName(), true)].sections.push_back(id);
+			}
+
+
+			// 段只是变成墓碑，位置不变，sectionIds 和按名称排序的索引都仍然有效
+			void INIFile::detachSection(size_t position)
+			{
+				if (!sectionTreeEnabled)
+				{
+					return;
+				}
+
+				uint64_t id = sectionIds[position];
+				std::string name = sectionsCache[position].getName();
+				size_t node = findNode(name, false);
+				if (node != NO_NODE)
+				{
+					std::vector<uint64_t>& ids = sectionNodes[node].sections;
+					ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+
+					// 不断增删不同名称的段时，空节点及时回收，前缀树不会越长越大
+					if (ids.empty() && sectionNodes[node].children.empty())
+					{
+						pruneNodes(name);
+					}
+				}
+			}
+
+
+			INIFile::INISectionIterator INIFile::findSectionInTree(const std::string& section)
+			{
+				size_t node = findNode(section, false);
+				if (node == NO_NODE || sectionNodes[node].sections.empty())
+				{
+					return sectionsCache.end();
+				}
+
+				// 有重名段时取文件中的第一个，与逐个查找的结果一致
+				uint64_t id = sectionNodes[node].sections.front();
+				return sectionsCache.begin() + (std::lower_bound(sectionIds.begin(), sectionIds.end(), id) - sectionIds.begin());
+			}
+
+
+			std::vector<size_t> INIFile::findSubsections(const std::string& parent)
+			{
+				std::vector<size_t> found;
+
+				if (!sectionTreeEnabled)
+				{
+					for (size_t i = 0; i < sectionsCache.size(); ++i)
+					{
+						if (!sectionsCache[i].removed && isSubsection(sectionsCache[i].getName(), parent))
+						{
+							found.push_back(i);
+						}
+					}
+					return found;
+				}
+
+				size_t node = findNode(parent, false);
+				if (node == NO_NODE)
+				{
+					return found;
+				}
+
+				std::vector<uint64_t> ids;
+				std::vector<size_t> pending(1, node);
+				while (!pending.empty())
+				{
+					const INISectionNode& current = sectionNodes[pending.back()];
+					pending.pop_back();
+
+					ids.insert(ids.end(), current.sections.begin(), current.sections.end());
+					for (auto child = current.children.begin(); child != current.children.end(); ++child)
+					{
+						pending.push_back(child->second);
+					}
+				}
+
+				// 编号与文件顺序一致
+				std::sort(ids.begin(), ids.end());
+				found.reserve(ids.size());
+				for (auto id = ids.begin(); id != ids.end(); ++id)
+				{
+					found.push_back(std::lower_bound(sectionIds.begin(), sectionIds.end(), *id) - sectionIds.begin());
+				}
+				return found;
+			}
+
+
+			std::vector<std::string> INIFile::getSubsectionNames(const std::string& parent)
+			{
+				std::vector<std::string> names;
+				std::vector<size_t> found = findSubsections(parent);
+
+				names.reserve(found.size());
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					names.push_back(sectionsCache[*i].getName());
+				}
+				return names;
+			}
+
+
+			std::vector<INISection> INIFile::getSubsections(const std::string& parent)
+			{
+				std::vector<INISection> sections;
+				std::vector<size_t> found = findSubsections(parent);
+
+				sections.reserve(found.size());
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					sections.push_back(sectionsCache[*i]);
+				}
+				return sections;
+			}
+
+
+			void INIFile::forEachSubsection(const std::string& parent, std::function<void(INISection&)> visitor)
+			{
+				std::vector<size_t> found = findSubsections(parent);
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					visitSection(*i, visitor);
+				}
+			}
+
+
+			void INIFile::deleteSubsections(const std::string& parent)
+			{
+				std::vector<size_t> found = findSubsections(parent);
+				if (found.empty())
+				{
+					return;
+				}
+
+				// 取出被删除的段留作通知，原位置标记为墓碑，由压缩一次前移其余的段
+				std::vector<INISection> removed;
+				removed.reserve(found.size());
+				for (auto i = found.begin(); i != found.end(); ++i)
+				{
+					removed.push_back(std::move(sectionsCache[*i]));
+					markSectionRemoved(*i);
+				}
+
+				if (sectionTreeEnabled)
+				{
+					if (parent.empty())
+					{
+						rebuildSectionTree();
+					}
+					else
+					{
+						// 从父节点摘下整棵子树
+						size_t dot = parent.rfind('.');
+						size_t owner = dot == std::string::npos ? 0 : findNode(parent.substr(0, dot), false);
+						std::string component = dot == std::string::npos ? parent : parent.substr(dot + 1);
+						auto child = sectionNodes[owner].children.find(component);
+						size_t node = child->second;
+						sectionNodes[owner].children.erase(child);
+						releaseNode(node);
+						if (dot != std::string::npos && sectionNodes[owner].sections.empty() && sectionNodes[owner].children.empty())
+						{
+							pruneNodes(parent.substr(0, dot));
+						}
+					}
+				}
+				compactSectionsIfNeeded();
+
+				for (auto sect = removed.begin(); sect != removed.end(); ++sect)
+				{
+					std::string name = sect->getName();
+					for (INISection::INIItemIterator item = sect->begin(); item != sect->end(); ++item)
+					{
+						notify(INI_KEY_DELETED, name, item->key, item->value, "");
+					}
+					notify(INI_SECTION_DELETED, name, "", "", "");
+				}
+			}
+
+
+		};
+	};
+};
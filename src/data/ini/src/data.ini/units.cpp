@@ -0,0 +1,418 @@
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 小数部分最多保留的位数，保证计算中间结果不超过 64 位
+			static const int FRACTION_DIGITS = 9;
+
+
+			struct INIUnit
+			{
+				const char* name;
+				uint64_t scale;
+			};
+
+
+			static const uint64_t KIB = 1024ULL;
+			static const uint64_t MIB = KIB * 1024;
+			static const uint64_t GIB = MIB * 1024;
+			static const uint64_t TIB = GIB * 1024;
+			static const uint64_t PIB = TIB * 1024;
+			static const uint64_t EIB = PIB * 1024;
+
+			static const INIUnit countUnits[] = {
+				{ "", 1 },
+				{ "k", 1000ULL }, { "K", 1000ULL }, { "M", 1000000ULL }, { "G", 1000000000ULL },
+				{ "T", 1000000000000ULL }, { "P", 1000000000000000ULL }, { "E", 1000000000000000000ULL },
+				{ "Ki", KIB }, { "Mi", MIB }, { "Gi", GIB }, { "Ti", TIB }, { "Pi", PIB }, { "Ei", EIB },
+				{ NULL, 0 }
+			};
+
+			// 比较时不区分大小写
+			static const INIUnit sizeUnits[] = {
+				{ "", 1 }, { "b", 1 },
+				{ "k", KIB }, { "kb", KIB }, { "kib", KIB },
+				{ "m", MIB }, { "mb", MIB }, { "mib", MIB },
+				{ "g", GIB }, { "gb", GIB }, { "gib", GIB },
+				{ "t", TIB }, { "tb", TIB }, { "tib", TIB },
+				{ "p", PIB }, { "pb", PIB }, { "pib", PIB },
+				{ "e", EIB }, { "eb", EIB }, { "eib", EIB },
+				{ NULL, 0 }
+			};
+
+			static const INIUnit durationUnits[] = {
+				{ "ns", 1ULL }, { "us", 1000ULL }, { "\xC2\xB5s", 1000ULL }, { "ms", 1000000ULL },
+				{ "s", 1000000000ULL }, { "m", 60000000000ULL }, { "min", 60000000000ULL },
+				{ "h", 3600000000000ULL }, { "d", 86400000000000ULL },
+				{ NULL, 0 }
+			};
+
+
+			static inline int digitValue(char c)
+			{
+				if (c >= '0' && c <= '9')
+				{
+					return c - '0';
+				}
+				if (c >= 'a' && c <= 'f')
+				{
+					return c - 'a' + 10;
+				}
+				if (c >= 'A' && c <= 'F')
+				{
+					return c - 'A' + 10;
+				}
+				return -1;
+			}
+
+
+			static inline bool isUnitChar(char c)
+			{
+				return isalpha(static_cast<unsigned char>(c)) || (static_cast<unsigned char>(c) & 0x80);
+			}
+
+
+			static const INIUnit* findUnit(const INIUnit* units, const char* begin, const char* end, bool ignoreCase)
+			{
+				size_t length = end - begin;
+				for (const INIUnit* unit = units; unit->name != NULL; ++unit)
+				{
+					if (strlen(unit->name) != length)
+					{
+						continue;
+					}
+
+					size_t i = 0;
+					while (i < length && (ignoreCase ? tolower(static_cast<unsigned char>(begin[i])) : begin[i]) == unit->name[i])
+					{
+						i++;
+					}
+					if (i == length)
+					{
+						return unit;
+					}
+				}
+				return NULL;
+			}
+
+
+			/*
+			* 从 p 开始读取一个数和紧跟的单位，结果为 (整数部分 + 小数部分) * 单位，写入 magnitude；
+			* 没有单位时按 bareScale 计，为 0 时由单位表决定是否允许；exact 为 false 时乘积的小数部分直接舍去，否则必须是整数
+			*/
+			static int readQuantity(const char*& p, const char* end, const INIUnit* units, uint64_t bareScale, bool ignoreCase, bool exact, bool& hasUnit, uint64_t& magnitude)
+			{
+				while (p < end && *p == ' ')
+				{
+					++p;
+				}
+
+				int base = 10;
+				if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+				{
+					base = 16;
+					p += 2;
+				}
+				else if (end - p > 1 && p[0] == '0' && isdigit(static_cast<unsigned char>(p[1])))
+				{
+					base = 8;
+					p += 1;
+				}
+
+				const char* digits = p;
+				uint64_t whole = 0;
+				bool overflow = false;
+				for (int digit; p < end && (digit = digitValue(*p)) >= 0 && digit < base; ++p)
+				{
+					if (whole > (UINT64_MAX - digit) / base)
+					{
+						overflow = true;
+					}
+					whole = whole * base + digit;
+				}
+				if (p == digits)
+				{
+					return ERR_INVALID_NUMBER;
+				}
+
+				uint64_t fraction = 0;
+				uint64_t denominator = 1;
+				bool dropped = false;
+				if (base == 10 && p < end && *p == '.')
+				{
+					++p;
+					const char* first = p;
+					for (; p < end && isdigit(static_cast<unsigned char>(*p)); ++p)
+					{
+						if (p - first < FRACTION_DIGITS)
+						{
+							fraction = fraction * 10 + (*p - '0');
+							denominator *= 10;
+						}
+						else if (*p != '0')
+						{
+							dropped = true;
+						}
+					}
+					if (p == first)
+					{
+						return ERR_INVALID_NUMBER;
+					}
+				}
+
+				while (p < end && *p == ' ')
+				{
+					++p;
+				}
+				const char* unitBegin = p;
+				while (p < end && isUnitChar(*p))
+				{
+					++p;
+				}
+				hasUnit = p != unitBegin;
+				INIUnit bare = { "", bareScale };
+				const INIUnit* unit = !hasUnit && bareScale != 0 ? &bare : findUnit(units, unitBegin, p, ignoreCase);
+				if (unit == NULL)
+				{
+					return ERR_INVALID_NUMBER;
+				}
+
+				if (overflow || (whole != 0 && unit->scale > UINT64_MAX / whole))
+				{
+					return ERR_NUMBER_OUT_OF_RANGE;
+				}
+
+				// scale * fraction / denominator，分开计算以免溢出
+				uint64_t scale = unit->scale;
+				uint64_t part = scale / denominator * fraction;
+				uint64_t rest = scale % denominator * fraction;
+				if (exact && (dropped || rest % denominator != 0))
+				{
+					return ERR_INVALID_NUMBER;
+				}
+				part += rest / denominator;
+
+				magnitude = whole * scale;
+				if (magnitude > UINT64_MAX - part)
+				{
+					return ERR_NUMBER_OUT_OF_RANGE;
+				}
+				magnitude += part;
+				return RET_OK;
+			}
+
+
+			int INIFile::parseNumber(const std::string& text, ININumberKind kind, int64_t& value)
+			{
+				const char* p = text.data();
+				const char* end = p + text.size();
+				while (p < end && *p == ' ')
+				{
+					++p;
+				}
+				while (end > p && end[-1] == ' ')
+				{
+					--end;
+				}
+
+				bool negative = false;
+				if (p < end && (*p == '+' || *p == '-'))
+				{
+					negative = *p == '-';
+					++p;
+				}
+
+				uint64_t magnitude = 0;
+				bool hasUnit = false;
+				int ret;
+				if (kind == INI_NUMBER_DURATION)
+				{
+					// 连写的各段依次相加，只有第一段可以不带单位，此时按秒计且后面不能再有内容
+					int parts = 0;
+					do
+					{
+						uint64_t part = 0;
+						ret = readQuantity(p, end, durationUnits, parts == 0 ? 1000000000ULL : 0, false, false, hasUnit, part);
+						if (ret != RET_OK)
+						{
+							return ret;
+						}
+						if (magnitude > UINT64_MAX - part)
+						{
+							return ERR_NUMBER_OUT_OF_RANGE;
+						}
+						magnitude += part;
+						parts++;
+					} while (p < end && hasUnit);
+				}
+				else
+				{
+					const INIUnit* units = kind == INI_NUMBER_SIZE ? sizeUnits : countUnits;
+					ret = readQuantity(p, end, units, 0, kind == INI_NUMBER_SIZE, true, hasUnit, magnitude);
+					if (ret != RET_OK)
+					{
+						return ret;
+					}
+				}
+				if (p != end)
+				{
+					return ERR_INVALID_NUMBER;
+				}
+
+				if (kind == INI_NUMBER_INT64)
+				{
+					uint64_t limit = negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(INT64_MAX);
+					if (magnitude > limit)
+					{
+						return ERR_NUMBER_OUT_OF_RANGE;
+					}
+					value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+					return RET_OK;
+				}
+
+				if (negative && magnitude != 0)
+				{
+					return ERR_NUMBER_OUT_OF_RANGE;
+				}
+				if (kind == INI_NUMBER_DURATION && magnitude > static_cast<uint64_t>(INT64_MAX))
+				{
+					return ERR_NUMBER_OUT_OF_RANGE;
+				}
+				value = static_cast<int64_t>(magnitude);
+				return RET_OK;
+			}
+
+
+			static const char* numberKindName(ININumberKind kind)
+			{
+				switch (kind)
+				{
+				case INI_NUMBER_INT64: return "int64";
+				case INI_NUMBER_UINT64: return "uint64";
+				case INI_NUMBER_SIZE: return "size";
+				default: return "duration";
+				}
+			}
+
+
+			bool INIFile::getNumber(const std::string& section, const std::string& key, ININumberKind kind, bool required, int64_t& value)
+			{
+				INISectionIterator sect = findSection(section);
+				if (sect == sectionsCache.end())
+				{
+					if (!required)
+					{
+						return false;
+					}
+					throw INIException(ERR_NOT_FOUND_SECTION, std::string("section `") + section + std::string("` was not found"));
+				}
+
+				INISection::INIItemIterator it = sect->findItem(key);
+				if (it == sect->end())
+				{
+					if (!required)
+					{
+						return false;
+					}
+					throw INIException(ERR_NOT_FOUND_KEY, std::string("not found key `") + key + "`");
+				}
+
+				// 插值展开后的值随被引用的键变化，不进入段内的缓存
+				bool interpolated = interpolationEnabled && it->value.find('$') != std::string::npos;
+				INIParsedNumber* cached = interpolated ? NULL : &sect->parsedNumber(it);
+				if (cached != NULL && cached->kind == kind)
+				{
+					value = cached->value;
+					return true;
+				}
+
+				const std::string& text = interpolated ? resolveValue(section, key, it->value) : it->value;
+				if (text.empty() && !required)
+				{
+					return false;
+				}
+
+				int ret = parseNumber(text, kind, value);
+				if (ret != RET_OK)
+				{
+					throw INIException(ret, "value `" + text + "` of [" + section + "] " + key
+						+ (ret == ERR_INVALID_NUMBER ? " is not a valid " : " is out of range for ") + numberKindName(kind));
+				}
+
+				if (cached != NULL)
+				{
+					cached->kind = kind;
+					cached->value = value;
+				}
+				return true;
+			}
+
+
+			int64_t INIFile::getInt64Value(const std::string& section, const std::string& key)
+			{
+				int64_t value = 0;
+				getNumber(section, key, INI_NUMBER_INT64, true, value);
+				return value;
+			}
+
+
+			int64_t INIFile::getInt64ValueOrDefault(const std::string& section, const std::string& key, int64_t defaultValue)
+			{
+				int64_t value = 0;
+				return getNumber(section, key, INI_NUMBER_INT64, false, value) ? value : defaultValue;
+			}
+
+
+			uint64_t INIFile::getUInt64Value(const std::string& section, const std::string& key)
+			{
+				int64_t value = 0;
+				getNumber(section, key, INI_NUMBER_UINT64, true, value);
+				return static_cast<uint64_t>(value);
+			}
+
+
+			uint64_t INIFile::getUInt64ValueOrDefault(const std::string& section, const std::string& key, uint64_t defaultValue)
+			{
+				int64_t value = 0;
+				return getNumber(section, key, INI_NUMBER_UINT64, false, value) ? static_cast<uint64_t>(value) : defaultValue;
+			}
+
+
+			uint64_t INIFile::getSizeValue(const std::string& section, const std::string& key)
+			{
+				int64_t value = 0;
+				getNumber(section, key, INI_NUMBER_SIZE, true, value);
+				return static_cast<uint64_t>(value);
+			}
+
+
+			uint64_t INIFile::getSizeValueOrDefault(const std::string& section, const std::string& key, uint64_t defaultValue)
+			{
+				int64_t value = 0;
+				return getNumber(section, key, INI_NUMBER_SIZE, false, value) ? static_cast<uint64_t>(value) : defaultValue;
+			}
+
+
+			std::chrono::nanoseconds INIFile::getDurationValue(const std::string& section, const std::string& key)
+			{
+				int64_t value = 0;
+				getNumber(section, key, INI_NUMBER_DURATION, true, value);
+				return std::chrono::nanoseconds(value);
+			}
+
+
+			std::chrono::nanoseconds INIFile::getDurationValueOrDefault(const std::string& section, const std::string& key, std::chrono::nanoseconds defaultValue)
+			{
+				int64_t value = 0;
+				return getNumber(section, key, INI_NUMBER_DURATION, false, value) ? std::chrono::nanoseconds(value) : defaultValue;
+			}
+
+
+		};
+	};
+};
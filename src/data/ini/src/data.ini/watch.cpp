@@ -0,0 +1,213 @@
+#include "ini.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+			int INIFile::subscribe(std::string section, std::string key, INIWatcher watcher)
+			{
+				int id = nextWatchId++;
+				watchers[section].keyWatchers[key].push_back({ id, watcher });
+				watchIds[id] = { section, key };
+				return id;
+			}
+
+
+			int INIFile::subscribe(std::string section, INIWatcher watcher)
+			{
+				int id = nextWatchId++;
+				watchers[section].sectionWatchers.push_back({ id, watcher });
+
+				// 段订阅没有键名，用 "\0" 与任何合法键区分开
+				watchIds[id] = { section, std::string(1, '\0') };
+				return id;
+			}
+
+
+			void INIFile::unsubscribe(int id)
+			{
+				auto found = watchIds.find(id);
+				if (found == watchIds.end())
+				{
+					return;
+				}
+
+				const std::string& section = found->second.first;
+				const std::string& key = found->second.second;
+				auto slot = watchers.find(section);
+
+				if (slot != watchers.end())
+				{
+					auto matchId = [id](const INIWatchEntry& entry) { return entry.id == id; };
+
+					if (key == std::string(1, '\0'))
+					{
+						std::vector<INIWatchEntry>& list = slot->second.sectionWatchers;
+						list.erase(std::remove_if(list.begin(), list.end(), matchId), list.end());
+					}
+					else
+					{
+						auto keySlot = slot->second.keyWatchers.find(key);
+						if (keySlot != slot->second.keyWatchers.end())
+						{
+							std::vector<INIWatchEntry>& list = keySlot->second;
+							list.erase(std::remove_if(list.begin(), list.end(), matchId), list.end());
+							if (list.empty())
+							{
+								slot->second.keyWatchers.erase(keySlot);
+							}
+						}
+					}
+
+					// 段上没有任何订阅时移除整个槽，保证未被订阅的段只需一次查找
+					if (slot->second.sectionWatchers.empty() && slot->second.keyWatchers.empty())
+					{
+						watchers.erase(slot);
+					}
+				}
+
+				watchIds.erase(found);
+			}
+
+
+			void INIFile::notify(INIChangeType type, const std::string& section, const std::string& key, const std::string& oldValue, const std::string& newValue)
+			{
+				// 插值缓存与订阅者一样依赖变更通知，段删除前已经逐个通知过其中的键
+				if (type != INI_SECTION_DELETED)
+				{
+					invalidateResolved(section, key);
+				}
+
+				if (watchers.empty())
+				{
+					return;
+				}
+
+				auto slot = watchers.find(section);
+				if (slot == watchers.end())
+				{
+					return;
+				}
+
+				// 先复制出要通知的订阅者，回调里可以安全地订阅或取消订阅
+				std::vector<INIWatchEntry> targets;
+				if (type != INI_SECTION_DELETED)
+				{
+					auto keySlot = slot->second.keyWatchers.find(key);
+					if (keySlot != slot->second.keyWatchers.end())
+					{
+						targets = keySlot->second;
+					}
+				}
+				targets.insert(targets.end(), slot->second.sectionWatchers.begin(), slot->second.sectionWatchers.end());
+
+				if (targets.empty())
+				{
+					return;
+				}
+
+				INIChange change;
+				change.type = type;
+				change.section = section;
+				change.key = key;
+				change.oldValue = oldValue;
+				change.newValue = newValue;
+
+				for (auto it = targets.begin(); it != targets.end(); ++it)
+				{
+					it->watcher(change);
+				}
+			}
+
+
+			INIFile::INIWatchSnapshot INIFile::snapshotWatched()
+			{
+				INIWatchSnapshot snapshot;
+
+				for (auto slot = watchers.begin(); slot != watchers.end(); ++slot)
+				{
+					INISectionIterator sect = findSection(slot->first);
+					if (sect != sectionsCache.end())
+					{
+						snapshot[slot->first] = sect->getEntries();
+					}
+				}
+				return snapshot;
+			}
+
+
+			void INIFile::notifyReload(const INIWatchSnapshot& snapshot)
+			{
+				// 复制段名，回调里取消订阅不会影响遍历
+				std::vector<std::string> sections;
+				for (auto slot = watchers.begin(); slot != watchers.end(); ++slot)
+				{
+					sections.push_back(slot->first);
+				}
+
+				for (auto name = sections.begin(); name != sections.end(); ++name)
+				{
+					std::vector<std::pair<std::string, std::string>> before;
+					auto old = snapshot.find(*name);
+					if (old != snapshot.end())
+					{
+						before = old->second;
+					}
+
+					INISectionIterator sect = findSection(*name);
+					if (sect == sectionsCache.end())
+					{
+						for (auto entry = before.begin(); entry != before.end(); ++entry)
+						{
+							notify(INI_KEY_DELETED, *name, entry->first, entry->second, "");
+						}
+						if (old != snapshot.end())
+						{
+							notify(INI_SECTION_DELETED, *name, "", "", "");
+						}
+						continue;
+					}
+
+					notifyChanges(*name, before, sect->getEntries());
+				}
+			}
+
+
+			void INIFile::notifyChanges(const std::string& section, const std::vector<std::pair<std::string, std::string>>& before, const std::vector<std::pair<std::string, std::string>>& after)
+			{
+				std::unordered_map<std::string, const std::string*> oldValues;
+				for (auto entry = before.begin(); entry != before.end(); ++entry)
+				{
+					oldValues.insert({ entry->first, &entry->second });
+				}
+
+				for (auto entry = after.begin(); entry != after.end(); ++entry)
+				{
+					auto found = oldValues.find(entry->first);
+					if (found == oldValues.end())
+					{
+						notify(INI_KEY_SET, section, entry->first, "", entry->second);
+						continue;
+					}
+					if (*found->second != entry->second)
+					{
+						notify(INI_KEY_SET, section, entry->first, *found->second, entry->second);
+					}
+					oldValues.erase(found);
+				}
+
+				// 剩下的是之后已经不存在的键
+				for (auto entry = before.begin(); entry != before.end(); ++entry)
+				{
+					if (oldValues.count(entry->first))
+					{
+						notify(INI_KEY_DELETED, section, entry->first, entry->second, "");
+					}
+				}
+			}
+
+		};
+	};
+};
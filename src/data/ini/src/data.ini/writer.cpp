@@ -0,0 +1,191 @@
+#include "writer.h"
+#include "encoding.h"
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			// 末尾不完整的 UTF-8 序列的字节数，完整或无法识别时为 0
+			static size_t incompleteTail(const char* data, size_t size)
+			{
+				for (size_t back = 1; back <= 3 && back <= size; ++back)
+				{
+					unsigned char c = static_cast<unsigned char>(data[size - back]);
+					if ((c & 0xC0) == 0x80)
+					{
+						continue;
+					}
+
+					size_t need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+					return need > back ? back : 0;
+				}
+				return 0;
+			}
+
+
+			INIStreamWriter::INIStreamWriter(INIEncoding _encoding)
+				: encoding(_encoding), buffer(INI_WRITE_BUFFER_SIZE), used(0), lastChar('\0'), failed(false)
+			{
+			}
+
+
+			bool INIStreamWriter::open(const std::string& filePath)
+			{
+				// 只由本类的缓冲区缓冲，整块直接交给系统
+				ofs.rdbuf()->pubsetbuf(NULL, 0);
+				ofs.open(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+				if (!ofs.is_open())
+				{
+					return false;
+				}
+
+				std::string bom = encodingBom(encoding);
+				ofs.write(bom.data(), bom.size());
+				return true;
+			}
+
+
+			void INIStreamWriter::write(const char* data, size_t size)
+			{
+				if (size == 0)
+				{
+					return;
+				}
+				lastChar = data[size - 1];
+
+				while (size > 0)
+				{
+					if (used == buffer.size())
+					{
+						flush(false);
+					}
+
+					size_t chunk = std::min(size, buffer.size() - used);
+					memcpy(&buffer[used], data, chunk);
+					used += chunk;
+					data += chunk;
+					size -= chunk;
+				}
+			}
+
+
+			void INIStreamWriter::writeValue(const std::string& value, const std::string& rightComment, const INIValueLayout* layout)
+			{
+				static const std::string defaultIndent = "    ";
+				size_t breakIndex = 0;
+				size_t breakCount = layout != NULL ? layout->breaks.size() : 0;
+				const std::string* indent = NULL;
+				bool firstLine = true;
+				size_t pos = 0;
+				size_t newline = value.find('\n');
+
+				for (;;)
+				{
+					// 只在越过上一个换行后才继续查找，反斜杠续行很多时不会反复扫描值的剩余部分
+					if (newline < pos)
+					{
+						newline = value.find('\n', pos);
+					}
+					size_t stop = newline == std::string::npos ? value.size() : newline;
+					bool continued = breakIndex < breakCount && layout->breaks[breakIndex] <= stop;
+					if (continued)
+					{
+						stop = layout->breaks[breakIndex++];
+					}
+
+					// 空行不写缩进
+					if (indent != NULL && stop > pos)
+					{
+						write(*indent);
+					}
+					write(value.data() + pos, stop - pos);
+					if (!continued && stop == value.size())
+					{
+						break;
+					}
+
+					if (continued)
+					{
+						put('\\');
+					}
+					if (firstLine && !rightComment.empty())
+					{
+						write(" #", 2);
+						write(rightComment);
+					}
+					firstLine = false;
+					put('\n');
+
+					// 加载时缩进的后续行必须以空白开头，反斜杠续行可以不缩进
+					if (continued)
+					{
+						indent = &layout->indent;
+					}
+					else
+					{
+						indent = layout != NULL && !layout->indent.empty() ? &layout->indent : &defaultIndent;
+					}
+					pos = continued ? stop : stop + 1;
+				}
+
+				if (firstLine && !rightComment.empty())
+				{
+					write(" #", 2);
+					write(rightComment);
+				}
+			}
+
+
+			void INIStreamWriter::flush(bool final)
+			{
+				bool utf16 = encoding == INI_ENCODING_UTF16LE || encoding == INI_ENCODING_UTF16BE;
+				size_t keep = utf16 && !final ? incompleteTail(buffer.data(), used) : 0;
+				size_t size = used - keep;
+
+				const char* out = buffer.data();
+#ifdef _WIN32
+				expanded.clear();
+				for (size_t i = 0; i < size; ++i)
+				{
+					if (buffer[i] == '\n')
+					{
+						expanded += '\r';
+					}
+					expanded += buffer[i];
+				}
+				out = expanded.data();
+				size = expanded.size();
+#endif
+
+				if (utf16)
+				{
+					encoded.clear();
+					utf8ToUtf16(out, size, encoding == INI_ENCODING_UTF16BE, encoded);
+					out = encoded.data();
+					size = encoded.size();
+				}
+
+				if (size > 0 && !ofs.write(out, size))
+				{
+					failed = true;
+				}
+
+				memmove(buffer.data(), buffer.data() + used - keep, keep);
+				used = keep;
+			}
+
+
+			bool INIStreamWriter::close()
+			{
+				flush(true);
+				ofs.close();
+				return !failed && !ofs.fail();
+			}
+
+
+		};
+	};
+};
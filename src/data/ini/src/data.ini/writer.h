@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef _TFC_DATA_FORMAT_INI_WRITER_H_
+#define _TFC_DATA_FORMAT_INI_WRITER_H_
+
+#include "ini.h"
+
+// 输出缓冲区的大小，写文件时的内存占用与文件大小无关
+#define INI_WRITE_BUFFER_SIZE (128 * 1024)
+
+namespace tfc
+{
+	namespace data
+	{
+		namespace ini
+		{
+
+			/*
+			* 按 UTF-8 文本逐段写入固定大小的缓冲区，缓冲区满时整块转换编码并写出
+			* Windows 下把 \n 写成 \r\n；转换 UTF-16 时不完整的 UTF-8 序列留到下一块
+			*/
+			class INIStreamWriter
+			{
+			public:
+				INIStreamWriter(INIEncoding encoding);
+
+				// 创建文件并写入 BOM
+				bool open(const std::string& filePath);
+
+				void write(const char* data, size_t size);
+
+				inline void write(const std::string& text)
+				{
+					write(text.data(), text.size());
+				}
+
+				inline void put(char c)
+				{
+					if (used == buffer.size())
+					{
+						flush(false);
+					}
+					buffer[used++] = c;
+					lastChar = c;
+				}
+
+				/*
+				* 写出键值行中 = 之后的部分，行尾注释跟在第一行之后
+				* 值中有换行或 layout 中有反斜杠续行时分成多行，后续行按 layout 的缩进写出
+				*/
+				void writeValue(const std::string& value, const std::string& rightComment, const INIValueLayout* layout);
+
+				// 最近写入的字符，尚未写入时为 '\0'
+				inline char last() const
+				{
+					return lastChar;
+				}
+
+				// 写出剩余内容并关闭文件，任何一次写入失败都返回 false
+				bool close();
+
+			private:
+				void flush(bool final);
+
+			private:
+				std::ofstream ofs;
+				INIEncoding encoding;
+				std::vector<char> buffer;
+				size_t used;
+				char lastChar;
+				bool failed;
+
+				// 换行和编码转换用的暂存区，大小不超过缓冲区的常数倍，重复使用
+				std::string expanded;
+				std::string encoded;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_DATA_FORMAT_INI_WRITER_H_
@@ -0,0 +1,182 @@
+#include "aho_corasick.h"
+
+#include <cctype>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			static inline unsigned char foldCase(unsigned char c, bool icase)
+			{
+				return icase ? static_cast<unsigned char>(tolower(c)) : c;
+			}
+
+
+			RegexAhoCorasick::RegexAhoCorasick(bool _icase) : icase(_icase), classCount(1)
+			{
+				for (int c = 0; c < 256; ++c)
+				{
+					byteClass[c] = 0;
+				}
+			}
+
+
+			int RegexAhoCorasick::add(const std::string& literal)
+			{
+				literals.push_back(literal);
+				return static_cast<int>(literals.size() - 1);
+			}
+
+
+			size_t RegexAhoCorasick::size() const
+			{
+				return literals.size();
+			}
+
+
+			size_t RegexAhoCorasick::literalLength(int id) const
+			{
+				return literals[id].size();
+			}
+
+
+			int RegexAhoCorasick::child(int state, int cls) const
+			{
+				return delta[state * classCount + cls];
+			}
+
+
+			void RegexAhoCorasick::build()
+			{
+				// 只有字符串中出现过的字节需要单独一列
+				classCount = 1;
+				for (int c = 0; c < 256; ++c)
+				{
+					byteClass[c] = 0;
+				}
+				for (auto lit = literals.begin(); lit != literals.end(); ++lit)
+				{
+					for (auto it = lit->begin(); it != lit->end(); ++it)
+					{
+						unsigned char c = foldCase(static_cast<unsigned char>(*it), icase);
+						if (byteClass[c] == 0)
+						{
+							byteClass[c] = static_cast<unsigned short>(classCount++);
+						}
+					}
+				}
+				if (icase)
+				{
+					for (int c = 'A'; c <= 'Z'; ++c)
+					{
+						byteClass[c] = byteClass[c + 32];
+					}
+				}
+
+				// 字典树，-1 表示没有子节点
+				delta.assign(classCount, -1);
+				outputs.assign(1, std::vector<int>());
+				for (size_t id = 0; id < literals.size(); ++id)
+				{
+					int state = 0;
+					for (auto it = literals[id].begin(); it != literals[id].end(); ++it)
+					{
+						int cls = byteClass[static_cast<unsigned char>(*it)];
+						int next = delta[state * classCount + cls];
+						if (next < 0)
+						{
+							next = static_cast<int>(outputs.size());
+							delta[state * classCount + cls] = next;
+							delta.resize(delta.size() + classCount, -1);
+							outputs.push_back(std::vector<int>());
+						}
+						state = next;
+					}
+					outputs[state].push_back(static_cast<int>(id));
+				}
+
+				// 按层次遍历求失败链接，同时把缺失的转移补全为失败链接上的转移
+				size_t stateCount = outputs.size();
+				std::vector<int> fail(stateCount, 0);
+				std::vector<int> queue;
+				outputLink.assign(stateCount, -1);
+
+				for (int cls = 0; cls < classCount; ++cls)
+				{
+					int next = delta[cls];
+					if (next < 0)
+					{
+						delta[cls] = 0;
+					}
+					else
+					{
+						fail[next] = 0;
+						queue.push_back(next);
+					}
+				}
+
+				for (size_t head = 0; head < queue.size(); ++head)
+				{
+					int state = queue[head];
+					int suffix = fail[state];
+					outputLink[state] = outputs[suffix].empty() ? outputLink[suffix] : suffix;
+
+					for (int cls = 0; cls < classCount; ++cls)
+					{
+						int next = delta[state * classCount + cls];
+						if (next < 0)
+						{
+							delta[state * classCount + cls] = child(suffix, cls);
+						}
+						else
+						{
+							fail[next] = child(suffix, cls);
+							queue.push_back(next);
+						}
+					}
+				}
+			}
+
+
+			void RegexAhoCorasick::scan(const char* data, size_t size, std::vector<size_t>& firstEnd) const
+			{
+				const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+				size_t remaining = literals.size();
+				firstEnd.assign(literals.size(), std::string::npos);
+
+				auto report = [&](int state, size_t pos)
+				{
+					for (int out = outputs[state].empty() ? outputLink[state] : state; out >= 0; out = outputLink[out])
+					{
+						const std::vector<int>& ids = outputs[out];
+						for (auto it = ids.begin(); it != ids.end(); ++it)
+						{
+							if (firstEnd[*it] == std::string::npos)
+							{
+								firstEnd[*it] = pos;
+								remaining--;
+							}
+						}
+					}
+				};
+
+				// 空字符串在位置 0 就出现了
+				report(0, 0);
+
+				int state = 0;
+				for (size_t pos = 0; pos < size && remaining > 0; ++pos)
+				{
+					state = delta[state * classCount + byteClass[text[pos]]];
+					if (!outputs[state].empty() || outputLink[state] >= 0)
+					{
+						report(state, pos + 1);
+					}
+				}
+			}
+
+
+		};
+	};
+};
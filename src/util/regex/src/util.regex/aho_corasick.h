@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_AHO_CORASICK_H_
+#define _TFC_UTIL_REGEX_AHO_CORASICK_H_
+
+#include "regex.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			/*
+			* Aho-Corasick 多字符串匹配
+			* 字典树建好后补全为 DFA，输入中每个字节只查一次表，与字符串的个数无关
+			*/
+			class RegexAhoCorasick
+			{
+			public:
+				RegexAhoCorasick(bool _icase);
+
+			public:
+
+				// 加入一个字符串，返回它在本匹配器中的编号
+				int add(const std::string& literal);
+
+				void build();
+
+				size_t size() const;
+				size_t literalLength(int id) const;
+
+				// 扫描整个输入，firstEnd[i] 为第 i 个字符串第一次出现的结束位置，没有出现为 npos
+				void scan(const char* data, size_t size, std::vector<size_t>& firstEnd) const;
+
+			private:
+				int child(int state, int cls) const;
+
+			private:
+				bool icase;
+				std::vector<std::string> literals;
+
+				unsigned short byteClass[256];     // 没有出现在任何字符串中的字节都属于 0 类
+				int classCount;
+
+				std::vector<int> delta;            // 状态数 * classCount
+				std::vector<std::vector<int>> outputs;  // 在该状态结束的字符串
+				std::vector<int> outputLink;       // 最近的有输出的后缀状态，没有为 -1
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_AHO_CORASICK_H_
@@ -0,0 +1,744 @@
+#include "dfa.h"
+#include "prefilter.h"
+
+#include <algorithm>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			// 缓存的最大状态数，完整构建时超过该值就改为按需构造
+			static const size_t REGEX_MAX_DFA_STATES = 4096;
+
+			// 一次扫描中清空缓存至少这么多次，且平均每个状态推进的字节数少于下限时，判定为颠簸
+			static const size_t REGEX_LAZY_MIN_CLEARS = 3;
+			static const size_t REGEX_LAZY_MIN_BYTES_PER_STATE = 10;
+
+
+			RegexDFA::RegexDFA(const RegexProgram& _prog, bool _unanchored, bool _longest, bool lazy)
+				: prog(_prog), unanchored(_unanchored), longest(_longest), compiled(false), clears(0)
+			{
+				startStates[0] = startStates[1] = -1;
+				clearCache();
+				if (!lazy)
+				{
+					build();
+				}
+			}
+
+
+			bool RegexDFA::isCompiled() const
+			{
+				return compiled;
+			}
+
+
+			size_t RegexDFA::stateCount() const
+			{
+				std::lock_guard<std::mutex> guard(cacheLock);
+				return flags.size();
+			}
+
+
+			void RegexDFA::setPrefix(const std::string& literal)
+			{
+				prefix = literal;
+			}
+
+
+			size_t RegexDFA::cacheClears() const
+			{
+				std::lock_guard<std::mutex> guard(cacheLock);
+				return clears;
+			}
+
+
+			void RegexDFA::addClosure(int pc, bool atBegin, std::vector<int>& out, RegexScratch& scratch) const
+			{
+				std::vector<int>& stack = scratch.stack;
+				stack.clear();
+				stack.push_back(pc);
+
+				while (!stack.empty())
+				{
+					int curr = stack.back();
+					stack.pop_back();
+					if (scratch.seen[curr] == scratch.generation)
+					{
+						continue;
+					}
+					scratch.seen[curr] = scratch.generation;
+
+					const RegexInst& inst = prog.insts[curr];
+					switch (inst.op)
+					{
+					case REGEX_OP_CHARSET:
+					case REGEX_OP_MATCH:
+					case REGEX_OP_END:
+						// $ 留在状态里，到输入末尾时再判断
+						out.push_back(curr);
+						break;
+					case REGEX_OP_SPLIT:
+						stack.push_back(inst.out1);
+						stack.push_back(inst.out);
+						break;
+					case REGEX_OP_NOP:
+						stack.push_back(inst.out);
+						break;
+					case REGEX_OP_BEGIN:
+						if (atBegin)
+						{
+							stack.push_back(inst.out);
+						}
+						break;
+					}
+				}
+			}
+
+
+			bool RegexDFA::reachesMatchAtEnd(const std::vector<int>& insts, bool atBegin, RegexScratch& scratch, std::vector<int>* patterns) const
+			{
+				bool reached = false;
+				std::vector<int>& stack = scratch.stack;
+				stack.clear();
+				scratch.generation++;
+
+				for (auto it = insts.begin(); it != insts.end(); ++it)
+				{
+					if (*it != REGEX_GROUP_MARK && prog.insts[*it].op == REGEX_OP_END)
+					{
+						stack.push_back(prog.insts[*it].out);
+					}
+				}
+
+				while (!stack.empty())
+				{
+					int curr = stack.back();
+					stack.pop_back();
+					if (scratch.seen[curr] == scratch.generation)
+					{
+						continue;
+					}
+					scratch.seen[curr] = scratch.generation;
+
+					const RegexInst& inst = prog.insts[curr];
+					switch (inst.op)
+					{
+					case REGEX_OP_MATCH:
+						// 不需要模式编号时找到一个即可
+						if (!patterns)
+						{
+							return true;
+						}
+						reached = true;
+						patterns->push_back(inst.pattern);
+						break;
+					case REGEX_OP_SPLIT:
+						stack.push_back(inst.out1);
+						stack.push_back(inst.out);
+						break;
+					case REGEX_OP_NOP:
+					case REGEX_OP_END:
+						stack.push_back(inst.out);
+						break;
+					case REGEX_OP_BEGIN:
+						if (atBegin)
+						{
+							stack.push_back(inst.out);
+						}
+						break;
+					default:
+						break;
+					}
+				}
+				return reached;
+			}
+
+
+			void RegexDFA::finishState(RegexStateSet& state, RegexScratch& scratch) const
+			{
+				bool atBegin = (state.flags & REGEX_STATE_AT_BEGIN) != 0;
+
+				if (prog.patternSet)
+				{
+					// 模式集合要记录每个位置上匹配的是哪些模式
+					state.matches.clear();
+					state.endMatches.clear();
+					for (auto it = state.insts.begin(); it != state.insts.end(); ++it)
+					{
+						if (*it != REGEX_GROUP_MARK && prog.insts[*it].op == REGEX_OP_MATCH)
+						{
+							state.matches.push_back(prog.insts[*it].pattern);
+						}
+					}
+					state.endMatches = state.matches;
+					reachesMatchAtEnd(state.insts, atBegin, scratch, &state.endMatches);
+					std::sort(state.endMatches.begin(), state.endMatches.end());
+					state.endMatches.erase(std::unique(state.endMatches.begin(), state.endMatches.end()), state.endMatches.end());
+
+					if (!state.matches.empty())
+					{
+						state.flags |= REGEX_STATE_MATCH;
+					}
+					if (!state.endMatches.empty())
+					{
+						state.flags |= REGEX_STATE_MATCH_AT_END;
+					}
+					return;
+				}
+
+				for (auto it = state.insts.begin(); it != state.insts.end(); ++it)
+				{
+					if (*it != REGEX_GROUP_MARK && prog.insts[*it].op == REGEX_OP_MATCH)
+					{
+						state.flags |= REGEX_STATE_MATCH | REGEX_STATE_MATCH_AT_END;
+						return;
+					}
+				}
+				if (reachesMatchAtEnd(state.insts, atBegin, scratch, NULL))
+				{
+					state.flags |= REGEX_STATE_MATCH_AT_END;
+				}
+			}
+
+
+			// 判断 [begin, end) 中是否有 MATCH 指令
+			static bool containsMatch(const RegexProgram& prog, const std::vector<int>& insts, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					if (prog.insts[insts[i]].op == REGEX_OP_MATCH)
+					{
+						return true;
+					}
+				}
+				return false;
+			}
+
+
+			void RegexDFA::startState(bool atBegin, RegexStateSet& state, RegexScratch& scratch) const
+			{
+				scratch.seen.resize(prog.insts.size(), 0);
+				scratch.generation++;
+
+				state.insts.clear();
+				addClosure(prog.start, atBegin, state.insts, scratch);
+				std::sort(state.insts.begin(), state.insts.end());
+
+				state.flags = atBegin ? REGEX_STATE_AT_BEGIN : 0;
+				if (unanchored && !(longest && containsMatch(prog, state.insts, 0, state.insts.size())))
+				{
+					state.flags |= REGEX_STATE_RESTART;
+				}
+				finishState(state, scratch);
+			}
+
+
+			void RegexDFA::step(const RegexStateSet& current, unsigned char c, RegexStateSet& next, RegexScratch& scratch) const
+			{
+				scratch.seen.resize(prog.insts.size(), 0);
+				scratch.generation++;
+
+				std::vector<int>& out = next.insts;
+				out.clear();
+				bool restart = (current.flags & REGEX_STATE_RESTART) != 0;
+
+				// 结束一组：排序，最长模式下若该组已匹配则丢弃后面的组
+				auto closeGroup = [&](size_t groupStart) -> bool
+				{
+					if (out.size() == groupStart)
+					{
+						if (longest && groupStart > 0)
+						{
+							out.pop_back();
+						}
+						return false;
+					}
+					std::sort(out.begin() + groupStart, out.end());
+					return longest && containsMatch(prog, out, groupStart, out.size());
+				};
+
+				auto openGroup = [&]() -> size_t
+				{
+					if (longest && !out.empty())
+					{
+						out.push_back(REGEX_GROUP_MARK);
+					}
+					return out.size();
+				};
+
+				bool cut = false;
+				size_t groupStart = openGroup();
+				for (auto it = current.insts.begin(); it != current.insts.end(); ++it)
+				{
+					if (*it == REGEX_GROUP_MARK)
+					{
+						if (closeGroup(groupStart))
+						{
+							cut = true;
+							break;
+						}
+						groupStart = openGroup();
+						continue;
+					}
+
+					const RegexInst& inst = prog.insts[*it];
+					if (inst.op == REGEX_OP_CHARSET && prog.charsets[inst.charset].test(c))
+					{
+						addClosure(inst.out, false, out, scratch);
+					}
+				}
+				if (!cut && closeGroup(groupStart))
+				{
+					cut = true;
+				}
+
+				if (cut)
+				{
+					restart = false;
+				}
+				else if (restart)
+				{
+					groupStart = openGroup();
+					addClosure(prog.start, false, out, scratch);
+					if (closeGroup(groupStart))
+					{
+						restart = false;
+					}
+				}
+
+				if (!longest)
+				{
+					std::sort(out.begin(), out.end());
+				}
+
+				next.flags = restart ? REGEX_STATE_RESTART : 0;
+				finishState(next, scratch);
+			}
+
+
+			static std::string stateKey(const RegexStateSet& state)
+			{
+				std::string key(reinterpret_cast<const char*>(state.insts.data()), state.insts.size() * sizeof(int));
+				key.push_back(static_cast<char>(state.flags));
+				return key;
+			}
+
+
+			int RegexDFA::cacheState(RegexStateSet& state) const
+			{
+				std::string key = stateKey(state);
+				auto found = ids.find(key);
+				if (found != ids.end())
+				{
+					return found->second;
+				}
+				if (states.size() >= REGEX_MAX_DFA_STATES)
+				{
+					return -1;
+				}
+
+				int id = static_cast<int>(states.size());
+				ids.insert({ key, id });
+				flags.push_back(static_cast<unsigned char>(state.flags));
+				stateMatches.push_back(state.matches);
+				stateEndMatches.push_back(state.endMatches);
+				table.resize(table.size() + prog.classCount, -1);
+				states.push_back(std::move(state));
+				return id;
+			}
+
+
+			int RegexDFA::cachedStart(bool atBegin, RegexScratch& scratch) const
+			{
+				if (startStates[atBegin] < 0)
+				{
+					RegexStateSet state;
+					startState(atBegin, state, scratch);
+					int id = cacheState(state);
+					if (id < 0)
+					{
+						clearCache();
+						id = cacheState(state);
+					}
+					startStates[atBegin] = id;
+				}
+				return startStates[atBegin];
+			}
+
+
+			void RegexDFA::clearCache() const
+			{
+				states.clear();
+				ids.clear();
+				table.clear();
+				flags.clear();
+				stateMatches.clear();
+				stateEndMatches.clear();
+				startStates[0] = startStates[1] = -1;
+
+				// 0 号为死状态：没有线程，也不再重新开始，所有转移都回到自身
+				RegexStateSet dead;
+				cacheState(dead);
+				std::fill(table.begin(), table.end(), 0);
+			}
+
+
+			void RegexDFA::build()
+			{
+				RegexScratch scratch;
+				RegexStateSet next;
+				size_t classCount = prog.classCount;
+
+				cachedStart(false, scratch);
+				cachedStart(true, scratch);
+
+				for (size_t i = 1; i < states.size(); ++i)
+				{
+					for (size_t k = 0; k < classCount; ++k)
+					{
+						step(states[i], prog.classByte[k], next, scratch);
+						int id = cacheState(next);
+						if (id < 0)
+						{
+							// 状态太多，改为匹配时按需构造
+							clearCache();
+							return;
+						}
+						table[i * classCount + k] = id;
+					}
+				}
+
+				// 转移表已完整，状态内容不再需要
+				compiled = true;
+				states.clear();
+				states.shrink_to_fit();
+				ids.clear();
+			}
+
+
+			// 使用完整的转移表
+			struct RegexTableMachine
+			{
+				const int* table;
+				const unsigned char* flagsOf;
+				const unsigned short* byteClass;
+				size_t classCount;
+				int state;
+				const std::vector<std::vector<int>>* matchLists;
+				const std::vector<std::vector<int>>* endMatchLists;
+				int restartState;
+
+				inline void next(unsigned char c)
+				{
+					state = table[state * classCount + byteClass[c]];
+				}
+
+				inline int flags() const
+				{
+					return flagsOf[state];
+				}
+
+				inline bool dead() const
+				{
+					return state == 0;
+				}
+
+				// 没有进行中的线程，只在每个位置重新开始
+				inline bool restarting() const
+				{
+					return state == restartState;
+				}
+
+				inline const std::vector<int>& matches() const
+				{
+					return (*matchLists)[state];
+				}
+
+				inline const std::vector<int>& endMatches() const
+				{
+					return (*endMatchLists)[state];
+				}
+			};
+
+
+			// 按需构造状态，调用者持有 cacheLock
+			struct RegexLazyMachine
+			{
+				const RegexDFA* dfa;
+				int state;
+				size_t bytes;
+				size_t bytesAtClear;
+				size_t clearsInScan;
+
+				// 判定为颠簸后逐步模拟子集构造，不再使用缓存
+				bool simulating;
+				RegexStateSet current;
+				RegexStateSet following;
+				RegexScratch scratch;
+
+				RegexLazyMachine(const RegexDFA* _dfa, bool atBegin)
+					: dfa(_dfa), bytes(0), bytesAtClear(0), clearsInScan(0), simulating(false)
+				{
+					dfa->cachedStart(false, scratch);
+					state = dfa->cachedStart(atBegin, scratch);
+				}
+
+				inline void next(unsigned char c)
+				{
+					if (simulating)
+					{
+						dfa->step(current, c, following, scratch);
+						std::swap(current, following);
+						return;
+					}
+
+					bytes++;
+					size_t index = state * dfa->prog.classCount + dfa->prog.byteClass[c];
+					int target = dfa->table[index];
+					if (target < 0)
+					{
+						target = fill(index, c);
+					}
+					state = target;
+				}
+
+				int fill(size_t index, unsigned char c)
+				{
+					dfa->step(dfa->states[state], c, following, scratch);
+					int id = dfa->cacheState(following);
+					if (id >= 0)
+					{
+						dfa->table[index] = id;
+						return id;
+					}
+
+					// 缓存已满，清空后从新状态继续
+					dfa->clearCache();
+					dfa->clears++;
+					clearsInScan++;
+
+					if (clearsInScan >= REGEX_LAZY_MIN_CLEARS && bytes - bytesAtClear < REGEX_LAZY_MIN_BYTES_PER_STATE * REGEX_MAX_DFA_STATES)
+					{
+						simulating = true;
+						std::swap(current, following);
+						return 0;
+					}
+					bytesAtClear = bytes;
+					dfa->cachedStart(false, scratch);
+					return dfa->cacheState(following);
+				}
+
+				inline int flags() const
+				{
+					return simulating ? current.flags : dfa->flags[state];
+				}
+
+				inline bool dead() const
+				{
+					if (simulating)
+					{
+						return current.insts.empty() && !(current.flags & REGEX_STATE_RESTART);
+					}
+					return state == 0;
+				}
+
+				inline bool restarting() const
+				{
+					return !simulating && state == dfa->startStates[0];
+				}
+
+				inline const std::vector<int>& matches() const
+				{
+					return simulating ? current.matches : dfa->stateMatches[state];
+				}
+
+				inline const std::vector<int>& endMatches() const
+				{
+					return simulating ? current.endMatches : dfa->stateEndMatches[state];
+				}
+			};
+
+
+			template <class Machine>
+			static size_t scanForwardWith(Machine& machine, const char* data, size_t size, size_t from, bool stopAtFirst, const std::string& prefix)
+			{
+				size_t last = std::string::npos;
+				const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+
+				if (machine.flags() & REGEX_STATE_MATCH)
+				{
+					last = from;
+					if (stopAtFirst)
+					{
+						return last;
+					}
+				}
+
+				for (size_t pos = from; pos < size; ++pos)
+				{
+					// 没有进行中的线程时，下一个匹配只能从前缀出现的地方开始，中间的字节直接跳过
+					if (!prefix.empty() && machine.restarting())
+					{
+						pos = regexFindLiteral(data, size, pos, prefix);
+						if (pos == std::string::npos)
+						{
+							return last;
+						}
+					}
+
+					machine.next(text[pos]);
+					if (machine.dead())
+					{
+						return last;
+					}
+					if (machine.flags() & REGEX_STATE_MATCH)
+					{
+						last = pos + 1;
+						if (stopAtFirst)
+						{
+							return last;
+						}
+					}
+				}
+
+				if (machine.flags() & REGEX_STATE_MATCH_AT_END)
+				{
+					last = size;
+				}
+				return last;
+			}
+
+
+			template <class Machine>
+			static size_t scanReverseWith(Machine& machine, const char* data, size_t end, size_t from)
+			{
+				size_t first = std::string::npos;
+				const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+
+				if (machine.flags() & REGEX_STATE_MATCH)
+				{
+					first = end;
+				}
+
+				for (size_t pos = end; pos > from; --pos)
+				{
+					machine.next(text[pos - 1]);
+					if (machine.dead())
+					{
+						return first;
+					}
+					if (machine.flags() & REGEX_STATE_MATCH)
+					{
+						first = pos - 1;
+					}
+				}
+
+				// 反向程序中的 $ 对应原模式的 ^，只在位置 0 成立
+				if (from == 0 && (machine.flags() & REGEX_STATE_MATCH_AT_END))
+				{
+					first = 0;
+				}
+				return first;
+			}
+
+
+			size_t RegexDFA::scanForward(const char* data, size_t size, size_t from, bool stopAtFirst) const
+			{
+				if (compiled)
+				{
+					RegexTableMachine machine = { table.data(), flags.data(), prog.byteClass, static_cast<size_t>(prog.classCount), startStates[from == 0], &stateMatches, &stateEndMatches, startStates[0] };
+					return scanForwardWith(machine, data, size, from, stopAtFirst, prefix);
+				}
+
+				std::lock_guard<std::mutex> guard(cacheLock);
+				RegexLazyMachine machine(this, from == 0);
+				return scanForwardWith(machine, data, size, from, stopAtFirst, prefix);
+			}
+
+
+			size_t RegexDFA::scanReverse(const char* data, size_t size, size_t end, size_t from) const
+			{
+				// 反向程序中的 ^ 对应原模式的 $
+				bool atBegin = end == size;
+
+				if (compiled)
+				{
+					RegexTableMachine machine = { table.data(), flags.data(), prog.byteClass, static_cast<size_t>(prog.classCount), startStates[atBegin], &stateMatches, &stateEndMatches, startStates[0] };
+					return scanReverseWith(machine, data, end, from);
+				}
+
+				std::lock_guard<std::mutex> guard(cacheLock);
+				RegexLazyMachine machine(this, atBegin);
+				return scanReverseWith(machine, data, end, from);
+			}
+
+
+			// 记录尚未出现过的模式的第一个结束位置，返回剩余未匹配的模式数
+			static size_t recordMatches(const std::vector<int>& patterns, size_t pos, std::vector<size_t>& firstEnd, size_t remaining)
+			{
+				for (auto it = patterns.begin(); it != patterns.end(); ++it)
+				{
+					if (firstEnd[*it] == std::string::npos)
+					{
+						firstEnd[*it] = pos;
+						remaining--;
+					}
+				}
+				return remaining;
+			}
+
+
+			template <class Machine>
+			static void scanPatternsWith(Machine& machine, const char* data, size_t size, std::vector<size_t>& firstEnd)
+			{
+				const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+				size_t remaining = firstEnd.size();
+
+				if (machine.flags() & REGEX_STATE_MATCH)
+				{
+					remaining = recordMatches(machine.matches(), 0, firstEnd, remaining);
+				}
+
+				for (size_t pos = 0; pos < size && remaining > 0; ++pos)
+				{
+					machine.next(text[pos]);
+					if (machine.dead())
+					{
+						return;
+					}
+					if (machine.flags() & REGEX_STATE_MATCH)
+					{
+						remaining = recordMatches(machine.matches(), pos + 1, firstEnd, remaining);
+					}
+				}
+
+				if (remaining > 0 && (machine.flags() & REGEX_STATE_MATCH_AT_END))
+				{
+					recordMatches(machine.endMatches(), size, firstEnd, remaining);
+				}
+			}
+
+
+			void RegexDFA::scanPatterns(const char* data, size_t size, std::vector<size_t>& firstEnd) const
+			{
+				firstEnd.assign(prog.patternCount, std::string::npos);
+
+				if (compiled)
+				{
+					RegexTableMachine machine = { table.data(), flags.data(), prog.byteClass, static_cast<size_t>(prog.classCount), startStates[1], &stateMatches, &stateEndMatches, startStates[0] };
+					scanPatternsWith(machine, data, size, firstEnd);
+					return;
+				}
+
+				std::lock_guard<std::mutex> guard(cacheLock);
+				RegexLazyMachine machine(this, true);
+				scanPatternsWith(machine, data, size, firstEnd);
+			}
+
+
+		};
+	};
+};
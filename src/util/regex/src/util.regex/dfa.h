@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_DFA_H_
+#define _TFC_UTIL_REGEX_DFA_H_
+
+#include "program.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			enum RegexStateFlag
+			{
+				REGEX_STATE_MATCH = 1,         // 当前位置匹配成功
+				REGEX_STATE_MATCH_AT_END = 2,  // 若当前位置是输入末尾则匹配成功
+				REGEX_STATE_RESTART = 4,       // 每个位置都重新从模式开头尝试（非锚定查找）
+				REGEX_STATE_AT_BEGIN = 8       // 位于输入开头
+			};
+
+
+			// 最长匹配模式下分隔不同起点的线程组
+			#define REGEX_GROUP_MARK -1
+
+
+			// 子集构造中的一个状态：NFA 指令的集合及标志
+			struct RegexStateSet
+			{
+				std::vector<int> insts;
+				int flags;
+
+				// 模式集合中在此位置匹配的模式，以及若此处为输入末尾会匹配的模式
+				std::vector<int> matches;
+				std::vector<int> endMatches;
+
+				RegexStateSet() : flags(0) {}
+			};
+
+
+			// 求闭包时用于去重，按代号标记避免每次清空
+			struct RegexScratch
+			{
+				std::vector<unsigned int> seen;
+				unsigned int generation;
+				std::vector<int> stack;
+
+				RegexScratch() : generation(0) {}
+			};
+
+
+			/*
+			* 由 NFA 经子集构造得到的 DFA
+			* unanchored 时每个位置都重新开始尝试，用于查找；longest 时线程按起点分组，
+			* 最早的起点优先，一旦某组匹配就丢弃更晚的起点，由此得到最左最长的结束位置。
+			*
+			* 状态较少时在构造时完整建立转移表；否则（或指定 lazy 时）在匹配过程中按需构造状态，
+			* 缓存的状态数有固定上限，满了就清空缓存从当前状态继续。若清空过于频繁，
+			* 本次扫描余下的部分改为逐步模拟子集构造，内存始终有界，时间仍与输入长度成线性关系
+			*/
+			class RegexDFA
+			{
+			public:
+				RegexDFA(const RegexProgram& _prog, bool _unanchored, bool _longest, bool lazy = false);
+
+				RegexDFA(const RegexDFA&) = delete;
+				RegexDFA& operator=(const RegexDFA&) = delete;
+
+			public:
+
+				// 从 from 开始正向扫描，返回最后一个匹配的结束位置；stopAtFirst 时返回第一个；没有匹配返回 npos
+				size_t scanForward(const char* data, size_t size, size_t from, bool stopAtFirst) const;
+
+				// 从 end 反向扫描到 from，返回最小的匹配开始位置；没有匹配返回 npos
+				size_t scanReverse(const char* data, size_t size, size_t end, size_t from) const;
+
+				// 对多模式程序扫描整个输入，firstEnd[i] 为第 i 个模式第一次匹配的结束位置，没有匹配为 npos
+				void scanPatterns(const char* data, size_t size, std::vector<size_t>& firstEnd) const;
+
+				// 每个匹配都以 literal 开头时，正向扫描可以跳过不可能开始匹配的字节
+				void setPrefix(const std::string& literal);
+
+				// 转移表是否已完整构建
+				bool isCompiled() const;
+
+				// 当前缓存的状态数
+				size_t stateCount() const;
+
+				// 按需构造时缓存被清空的次数
+				size_t cacheClears() const;
+
+				void startState(bool atBegin, RegexStateSet& state, RegexScratch& scratch) const;
+				void step(const RegexStateSet& current, unsigned char c, RegexStateSet& next, RegexScratch& scratch) const;
+
+			private:
+				friend struct RegexLazyMachine;
+
+				void build();
+				void addClosure(int pc, bool atBegin, std::vector<int>& out, RegexScratch& scratch) const;
+				bool reachesMatchAtEnd(const std::vector<int>& insts, bool atBegin, RegexScratch& scratch, std::vector<int>* patterns) const;
+				void finishState(RegexStateSet& state, RegexScratch& scratch) const;
+
+				// 查找或加入缓存，缓存已满时返回 -1
+				int cacheState(RegexStateSet& state) const;
+				int cachedStart(bool atBegin, RegexScratch& scratch) const;
+				void clearCache() const;
+
+			private:
+				const RegexProgram& prog;
+				bool unanchored;
+				bool longest;
+				bool compiled;
+
+				// 完整构建后只保留 table 与 flags；按需构造时还需要状态内容来计算新的转移
+				mutable std::vector<RegexStateSet> states;
+				mutable std::unordered_map<std::string, int> ids;
+				mutable std::vector<int> table;             // 状态数 * classCount，0 为死状态，-1 为尚未计算
+				mutable std::vector<unsigned char> flags;
+				mutable std::vector<std::vector<int>> stateMatches;
+				mutable std::vector<std::vector<int>> stateEndMatches;
+				mutable int startStates[2];                 // 按是否位于输入开头区分，-1 为尚未计算
+				mutable size_t clears;
+				std::string prefix;
+				mutable std::mutex cacheLock;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_DFA_H_
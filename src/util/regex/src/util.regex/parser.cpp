@@ -0,0 +1,622 @@
+#include "parser.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			// 嵌套括号的最大深度，避免递归下降耗尽栈空间
+			static const int REGEX_MAX_DEPTH = 1000;
+
+			// {n,m} 中允许的最大次数
+			static const int REGEX_MAX_REPEAT = 1000;
+
+
+			void RegexCharSet::setRange(unsigned char lo, unsigned char hi)
+			{
+				for (int c = lo; c <= hi; ++c)
+				{
+					set(static_cast<unsigned char>(c));
+				}
+			}
+
+
+			void RegexCharSet::merge(const RegexCharSet& other)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					bits[i] |= other.bits[i];
+				}
+			}
+
+
+			void RegexCharSet::invert()
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					bits[i] = ~bits[i];
+				}
+			}
+
+
+			void RegexCharSet::addCaseVariants()
+			{
+				for (int c = 'A'; c <= 'Z'; ++c)
+				{
+					if (test(static_cast<unsigned char>(c)) || test(static_cast<unsigned char>(c + 32)))
+					{
+						set(static_cast<unsigned char>(c));
+						set(static_cast<unsigned char>(c + 32));
+					}
+				}
+			}
+
+
+			bool RegexCharSet::empty() const
+			{
+				return (bits[0] | bits[1] | bits[2] | bits[3]) == 0;
+			}
+
+
+			size_t RegexCharSet::count() const
+			{
+				size_t n = 0;
+				for (int c = 0; c < 256; ++c)
+				{
+					n += test(static_cast<unsigned char>(c));
+				}
+				return n;
+			}
+
+
+			bool RegexCharSet::operator==(const RegexCharSet& other) const
+			{
+				return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2] && bits[3] == other.bits[3];
+			}
+
+
+			RegexCharSet regexDigits()
+			{
+				RegexCharSet set;
+				set.setRange('0', '9');
+				return set;
+			}
+
+
+			RegexCharSet regexWordChars()
+			{
+				RegexCharSet set;
+				set.setRange('a', 'z');
+				set.setRange('A', 'Z');
+				set.setRange('0', '9');
+				set.set('_');
+				return set;
+			}
+
+
+			RegexCharSet regexSpaces()
+			{
+				RegexCharSet set;
+				set.set(' ');
+				set.setRange('\t', '\r');  // \t \n \v \f \r
+				return set;
+			}
+
+
+			RegexParser::RegexParser(const std::string& pattern, int flags)
+				: pattern(pattern), pos(0), flags(flags), depth(0)
+			{
+			}
+
+
+			void RegexParser::fail(int errtype, const std::string& info)
+			{
+				throw RegexException(errtype, info + " at offset " + std::to_string(pos) + " in `" + pattern + "`");
+			}
+
+
+			RegexNodePtr RegexParser::parse()
+			{
+				RegexNodePtr root = parseAlternate();
+				if (pos < pattern.size())
+				{
+					// 只有多余的 `)' 会让顶层提前结束
+					fail(REGEX_ERR_UNMATCHED_PAREN, "unmatched `)'");
+				}
+				return root;
+			}
+
+
+			RegexNodePtr RegexParser::parseAlternate()
+			{
+				RegexNodePtr first = parseConcat();
+				if (pos >= pattern.size() || pattern[pos] != '|')
+				{
+					return first;
+				}
+
+				RegexNodePtr node(new RegexNode(REGEX_NODE_ALTERNATE));
+				node->children.push_back(std::move(first));
+				while (pos < pattern.size() && pattern[pos] == '|')
+				{
+					pos++;
+					node->children.push_back(parseConcat());
+				}
+				return node;
+			}
+
+
+			RegexNodePtr RegexParser::parseConcat()
+			{
+				RegexNodePtr node(new RegexNode(REGEX_NODE_CONCAT));
+				while (pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')')
+				{
+					node->children.push_back(parseRepeat());
+				}
+
+				if (node->children.empty())
+				{
+					return RegexNodePtr(new RegexNode(REGEX_NODE_EMPTY));
+				}
+				if (node->children.size() == 1)
+				{
+					return std::move(node->children[0]);
+				}
+				return node;
+			}
+
+
+			RegexNodePtr RegexParser::parseRepeat()
+			{
+				char c = pattern[pos];
+				if (c == '*' || c == '+' || c == '?')
+				{
+					fail(REGEX_ERR_BAD_REPEAT, "nothing to repeat");
+				}
+				if (c == '{')
+				{
+					size_t save = pos;
+					int n;
+					pos++;
+					if (parseNumber(n))
+					{
+						fail(REGEX_ERR_BAD_REPEAT, "nothing to repeat");
+					}
+					pos = save;
+				}
+
+				RegexNodePtr atom = parseAtom();
+				if (pos >= pattern.size())
+				{
+					return atom;
+				}
+
+				int min, max;
+				c = pattern[pos];
+				if (c == '*')
+				{
+					min = 0;
+					max = -1;
+					pos++;
+				}
+				else if (c == '+')
+				{
+					min = 1;
+					max = -1;
+					pos++;
+				}
+				else if (c == '?')
+				{
+					min = 0;
+					max = 1;
+					pos++;
+				}
+				else if (c == '{')
+				{
+					pos++;
+					if (!parseNumber(min))
+					{
+						fail(REGEX_ERR_BAD_REPEAT, "bad repeat count");
+					}
+					max = min;
+					if (pos < pattern.size() && pattern[pos] == ',')
+					{
+						pos++;
+						max = -1;
+						if (pos < pattern.size() && pattern[pos] != '}' && !parseNumber(max))
+						{
+							fail(REGEX_ERR_BAD_REPEAT, "bad repeat count");
+						}
+					}
+					if (pos >= pattern.size() || pattern[pos] != '}')
+					{
+						fail(REGEX_ERR_BAD_REPEAT, "unterminated `{'");
+					}
+					pos++;
+					if (max != -1 && max < min)
+					{
+						fail(REGEX_ERR_BAD_REPEAT, "repeat count out of order");
+					}
+					if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT)
+					{
+						fail(REGEX_ERR_TOO_COMPLEX, "repeat count too large");
+					}
+				}
+				else
+				{
+					return atom;
+				}
+
+				if (atom->type == REGEX_NODE_BEGIN || atom->type == REGEX_NODE_END)
+				{
+					fail(REGEX_ERR_BAD_REPEAT, "assertion cannot be repeated");
+				}
+
+				RegexNodePtr node(new RegexNode(REGEX_NODE_REPEAT));
+				node->min = min;
+				node->max = max;
+				node->children.push_back(std::move(atom));
+
+				// 非贪婪只影响优先级，不影响最左最长的结果
+				if (pos < pattern.size() && pattern[pos] == '?')
+				{
+					node->greedy = false;
+					pos++;
+				}
+
+				if (pos < pattern.size() && (pattern[pos] == '*' || pattern[pos] == '+' || pattern[pos] == '?'))
+				{
+					fail(REGEX_ERR_BAD_REPEAT, "nested quantifier");
+				}
+				return node;
+			}
+
+
+			RegexNodePtr RegexParser::parseAtom()
+			{
+				char c = pattern[pos];
+
+				switch (c)
+				{
+				case '(':
+				{
+					pos++;
+					if (pattern.compare(pos, 2, "?:") == 0)
+					{
+						pos += 2;
+					}
+					else if (pos < pattern.size() && pattern[pos] == '?')
+					{
+						fail(REGEX_ERR_UNSUPPORTED, "lookaround is not supported");
+					}
+
+					if (++depth > REGEX_MAX_DEPTH)
+					{
+						fail(REGEX_ERR_TOO_COMPLEX, "groups nested too deeply");
+					}
+					RegexNodePtr inner = parseAlternate();
+					depth--;
+
+					if (pos >= pattern.size() || pattern[pos] != ')')
+					{
+						fail(REGEX_ERR_UNMATCHED_PAREN, "missing `)'");
+					}
+					pos++;
+					return inner;
+				}
+				case '[':
+					return parseClass();
+				case '.':
+				{
+					RegexCharSet set;
+					set.set('\n');
+					set.set('\r');
+					set.invert();
+					pos++;
+					return makeSet(set);
+				}
+				case '^':
+					pos++;
+					return RegexNodePtr(new RegexNode(REGEX_NODE_BEGIN));
+				case '$':
+					pos++;
+					return RegexNodePtr(new RegexNode(REGEX_NODE_END));
+				case '\\':
+					return parseEscape();
+				default:
+					pos++;
+					return makeChar(static_cast<unsigned char>(c));
+				}
+			}
+
+
+			RegexNodePtr RegexParser::parseEscape()
+			{
+				pos++;
+				if (pos >= pattern.size())
+				{
+					fail(REGEX_ERR_BAD_ESCAPE, "trailing `\\'");
+				}
+
+				char c = pattern[pos];
+				RegexCharSet set;
+				int single = -1;
+
+				if (c == 'b' || c == 'B')
+				{
+					fail(REGEX_ERR_UNSUPPORTED, "word boundary is not supported");
+				}
+				if (c >= '1' && c <= '9')
+				{
+					fail(REGEX_ERR_UNSUPPORTED, "backreference is not supported");
+				}
+
+				// \u 超出 ASCII 时按 UTF-8 展开为多个字节
+				if (c == 'u')
+				{
+					pos++;
+					int cp = parseHex(4);
+					if (cp >= 0x80)
+					{
+						RegexNodePtr node(new RegexNode(REGEX_NODE_CONCAT));
+						if (cp < 0x800)
+						{
+							node->children.push_back(makeChar(static_cast<unsigned char>(0xC0 | (cp >> 6))));
+						}
+						else
+						{
+							node->children.push_back(makeChar(static_cast<unsigned char>(0xE0 | (cp >> 12))));
+							node->children.push_back(makeChar(static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3F))));
+						}
+						node->children.push_back(makeChar(static_cast<unsigned char>(0x80 | (cp & 0x3F))));
+						return node;
+					}
+					return makeChar(static_cast<unsigned char>(cp));
+				}
+
+				if (!parseClassEscape(set, single))
+				{
+					fail(REGEX_ERR_BAD_ESCAPE, std::string("unknown escape `\\") + c + "'");
+				}
+				if (single >= 0)
+				{
+					return makeChar(static_cast<unsigned char>(single));
+				}
+				return makeSet(set);
+			}
+
+
+			// 解析 `\' 之后的转义，字符类写入 set，单个字符写入 single
+			bool RegexParser::parseClassEscape(RegexCharSet& set, int& single)
+			{
+				char c = pattern[pos++];
+				single = -1;
+
+				switch (c)
+				{
+				case 'd': set = regexDigits(); return true;
+				case 'D': set = regexDigits(); set.invert(); return true;
+				case 'w': set = regexWordChars(); return true;
+				case 'W': set = regexWordChars(); set.invert(); return true;
+				case 's': set = regexSpaces(); return true;
+				case 'S': set = regexSpaces(); set.invert(); return true;
+				case 't': single = '\t'; return true;
+				case 'n': single = '\n'; return true;
+				case 'r': single = '\r'; return true;
+				case 'f': single = '\f'; return true;
+				case 'v': single = '\v'; return true;
+				case '0':
+					if (pos < pattern.size() && isdigit(static_cast<unsigned char>(pattern[pos])))
+					{
+						fail(REGEX_ERR_BAD_ESCAPE, "octal escape is not supported");
+					}
+					single = 0;
+					return true;
+				case 'x':
+					single = parseHex(2);
+					return true;
+				case 'u':
+					single = parseHex(4);
+					if (single >= 0x80)
+					{
+						fail(REGEX_ERR_UNSUPPORTED, "non-ASCII \\u in character class is not supported");
+					}
+					return true;
+				case 'c':
+					if (pos < pattern.size() && isalpha(static_cast<unsigned char>(pattern[pos])))
+					{
+						single = pattern[pos++] % 32;
+						return true;
+					}
+					return false;
+				default:
+					// 标点符号按字面意义
+					if (!isalnum(static_cast<unsigned char>(c)))
+					{
+						single = static_cast<unsigned char>(c);
+						return true;
+					}
+					pos--;
+					return false;
+				}
+			}
+
+
+			RegexNodePtr RegexParser::parseClass()
+			{
+				RegexCharSet set;
+				bool negate = false;
+				bool first = true;
+
+				pos++;
+				if (pos < pattern.size() && pattern[pos] == '^')
+				{
+					negate = true;
+					pos++;
+				}
+
+				for (;;)
+				{
+					if (pos >= pattern.size())
+					{
+						fail(REGEX_ERR_UNMATCHED_BRACKET, "missing `]'");
+					}
+
+					char c = pattern[pos];
+					if (c == ']' && !first)
+					{
+						pos++;
+						break;
+					}
+					first = false;
+
+					// 取区间起点
+					int lo;
+					if (c == '\\')
+					{
+						RegexCharSet escaped;
+						pos++;
+						if (pos >= pattern.size())
+						{
+							fail(REGEX_ERR_UNMATCHED_BRACKET, "missing `]'");
+						}
+						if (pattern[pos] == 'b')
+						{
+							pos++;
+							lo = '\b';
+						}
+						else if (pattern[pos] == '-')
+						{
+							pos++;
+							lo = '-';
+						}
+						else
+						{
+							if (!parseClassEscape(escaped, lo))
+							{
+								fail(REGEX_ERR_BAD_ESCAPE, "unknown escape in character class");
+							}
+							if (lo < 0)
+							{
+								set.merge(escaped);
+								continue;
+							}
+						}
+					}
+					else
+					{
+						lo = static_cast<unsigned char>(c);
+						pos++;
+					}
+
+					// 是否构成区间 a-z
+					if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']')
+					{
+						int hi;
+						pos++;
+						if (pattern[pos] == '\\')
+						{
+							RegexCharSet escaped;
+							pos++;
+							if (pos >= pattern.size())
+							{
+								fail(REGEX_ERR_UNMATCHED_BRACKET, "missing `]'");
+							}
+							if (pattern[pos] == 'b')
+							{
+								pos++;
+								hi = '\b';
+							}
+							else if (!parseClassEscape(escaped, hi) || hi < 0)
+							{
+								fail(REGEX_ERR_BAD_RANGE, "character class in range");
+							}
+						}
+						else
+						{
+							hi = static_cast<unsigned char>(pattern[pos++]);
+						}
+
+						if (hi < lo)
+						{
+							fail(REGEX_ERR_BAD_RANGE, "range out of order");
+						}
+						set.setRange(static_cast<unsigned char>(lo), static_cast<unsigned char>(hi));
+					}
+					else
+					{
+						set.set(static_cast<unsigned char>(lo));
+					}
+				}
+
+				if (flags & REGEX_ICASE)
+				{
+					set.addCaseVariants();
+				}
+				if (negate)
+				{
+					set.invert();
+				}
+
+				RegexNodePtr node(new RegexNode(REGEX_NODE_CHARSET));
+				node->chars = set;
+				return node;
+			}
+
+
+			bool RegexParser::parseNumber(int& value)
+			{
+				size_t begin = pos;
+				value = 0;
+				while (pos < pattern.size() && isdigit(static_cast<unsigned char>(pattern[pos])))
+				{
+					if (value <= REGEX_MAX_REPEAT)
+					{
+						value = value * 10 + (pattern[pos] - '0');
+					}
+					pos++;
+				}
+				return pos > begin;
+			}
+
+
+			int RegexParser::parseHex(int digits)
+			{
+				int value = 0;
+				for (int i = 0; i < digits; ++i)
+				{
+					if (pos >= pattern.size() || !isxdigit(static_cast<unsigned char>(pattern[pos])))
+					{
+						fail(REGEX_ERR_BAD_ESCAPE, "bad hex escape");
+					}
+					char c = pattern[pos++];
+					value = value * 16 + (isdigit(static_cast<unsigned char>(c)) ? c - '0' : (tolower(c) - 'a' + 10));
+				}
+				return value;
+			}
+
+
+			RegexNodePtr RegexParser::makeChar(unsigned char c)
+			{
+				RegexCharSet set;
+				set.set(c);
+				return makeSet(set);
+			}
+
+
+			RegexNodePtr RegexParser::makeSet(const RegexCharSet& set)
+			{
+				RegexNodePtr node(new RegexNode(REGEX_NODE_CHARSET));
+				node->chars = set;
+				if (flags & REGEX_ICASE)
+				{
+					node->chars.addCaseVariants();
+				}
+				return node;
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_PARSER_H_
+#define _TFC_UTIL_REGEX_PARSER_H_
+
+#include "regex.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			// 256 位的字节集合
+			struct RegexCharSet
+			{
+				uint64_t bits[4];
+
+				RegexCharSet()
+				{
+					bits[0] = bits[1] = bits[2] = bits[3] = 0;
+				}
+
+				inline bool test(unsigned char c) const
+				{
+					return (bits[c >> 6] >> (c & 63)) & 1;
+				}
+
+				inline void set(unsigned char c)
+				{
+					bits[c >> 6] |= static_cast<uint64_t>(1) << (c & 63);
+				}
+
+				void setRange(unsigned char lo, unsigned char hi);
+				void merge(const RegexCharSet& other);
+				void invert();
+				void addCaseVariants();
+				bool empty() const;
+				size_t count() const;
+				bool operator==(const RegexCharSet& other) const;
+			};
+
+
+			enum RegexNodeType
+			{
+				REGEX_NODE_EMPTY,      // 空串
+				REGEX_NODE_CHARSET,    // 单个字节，属于 chars
+				REGEX_NODE_CONCAT,     // children 依次连接
+				REGEX_NODE_ALTERNATE,  // children 任选其一
+				REGEX_NODE_REPEAT,     // children[0] 重复 min 到 max 次，max 为 -1 表示不限
+				REGEX_NODE_BEGIN,      // ^
+				REGEX_NODE_END         // $
+			};
+
+
+			struct RegexNode
+			{
+				RegexNodeType type;
+				RegexCharSet chars;
+				std::vector<std::unique_ptr<RegexNode>> children;
+				int min;
+				int max;
+				bool greedy;
+
+				RegexNode(RegexNodeType _type) : type(_type), min(0), max(0), greedy(true) {}
+			};
+
+			using RegexNodePtr = std::unique_ptr<RegexNode>;
+
+
+			// 把模式解析为语法树，出错时抛出 RegexException
+			class RegexParser
+			{
+			public:
+				RegexParser(const std::string& pattern, int flags);
+
+				RegexNodePtr parse();
+
+			private:
+				RegexNodePtr parseAlternate();
+				RegexNodePtr parseConcat();
+				RegexNodePtr parseRepeat();
+				RegexNodePtr parseAtom();
+				RegexNodePtr parseEscape();
+				RegexNodePtr parseClass();
+
+				bool parseClassEscape(RegexCharSet& set, int& single);
+				bool parseNumber(int& value);
+				int parseHex(int digits);
+
+				RegexNodePtr makeChar(unsigned char c);
+				RegexNodePtr makeSet(const RegexCharSet& set);
+
+				[[noreturn]] void fail(int errtype, const std::string& info);
+
+			private:
+				std::string pattern;
+				size_t pos;
+				int flags;
+				int depth;
+
+			};
+
+
+			// \d \w \s 对应的集合
+			RegexCharSet regexDigits();
+			RegexCharSet regexWordChars();
+			RegexCharSet regexSpaces();
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_PARSER_H_
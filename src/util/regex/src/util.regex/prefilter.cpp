@@ -0,0 +1,423 @@
+#include "prefilter.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define REGEX_PREFILTER_SSE2
+#if defined(_MSC_VER) || defined(__GNUC__)
+#include <immintrin.h>
+#define REGEX_PREFILTER_AVX2
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define REGEX_TARGET_AVX2
+#elif defined(__GNUC__)
+#define REGEX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			// 提取的字符串的最大长度，避免 a{1000} 之类的展开
+			static const size_t REGEX_MAX_LITERAL = 64;
+
+
+			// 子表达式的字符串信息
+			struct RegexLiteralInfo
+			{
+				bool exact;            // 只匹配 str 这一个字符串
+				std::string str;
+				std::string prefix;
+				std::string suffix;
+				std::string required;
+
+				RegexLiteralInfo() : exact(false) {}
+			};
+
+
+			static void keepLonger(std::string& best, const std::string& candidate)
+			{
+				if (candidate.size() > best.size())
+				{
+					best = candidate.substr(0, REGEX_MAX_LITERAL);
+				}
+			}
+
+
+			static RegexLiteralInfo exactInfo(const std::string& str)
+			{
+				RegexLiteralInfo info;
+				if (str.size() > REGEX_MAX_LITERAL)
+				{
+					info.prefix = str.substr(0, REGEX_MAX_LITERAL);
+					info.suffix = str.substr(str.size() - REGEX_MAX_LITERAL);
+					info.required = info.prefix;
+					return info;
+				}
+				info.exact = true;
+				info.str = info.prefix = info.suffix = info.required = str;
+				return info;
+			}
+
+
+			static RegexLiteralInfo analyze(const RegexNode& node)
+			{
+				RegexLiteralInfo info;
+
+				switch (node.type)
+				{
+				case REGEX_NODE_EMPTY:
+				case REGEX_NODE_BEGIN:
+				case REGEX_NODE_END:
+					// 零宽度，相当于空串
+					return exactInfo("");
+
+				case REGEX_NODE_CHARSET:
+					if (node.chars.count() == 1)
+					{
+						for (int c = 0; c < 256; ++c)
+						{
+							if (node.chars.test(static_cast<unsigned char>(c)))
+							{
+								return exactInfo(std::string(1, static_cast<char>(c)));
+							}
+						}
+					}
+					return info;
+
+				case REGEX_NODE_CONCAT:
+				{
+					std::vector<RegexLiteralInfo> children;
+					for (auto it = node.children.begin(); it != node.children.end(); ++it)
+					{
+						children.push_back(analyze(**it));
+					}
+
+					// 相邻的确定字符串连成一段，段的两端可以接上相邻子表达式的后缀与前缀
+					std::string run;
+					std::string exact;
+					bool allExact = true;
+					bool prefixDone = false;
+					for (auto child = children.begin(); child != children.end(); ++child)
+					{
+						if (child->exact)
+						{
+							run += child->str;
+							exact += child->str;
+							if (!prefixDone)
+							{
+								info.prefix += child->str;
+							}
+							continue;
+						}
+
+						allExact = false;
+						keepLonger(info.required, run + child->prefix);
+						keepLonger(info.required, child->required);
+						if (!prefixDone)
+						{
+							info.prefix += child->prefix;
+							prefixDone = true;
+						}
+						run = child->suffix;
+					}
+					keepLonger(info.required, run);
+
+					if (allExact)
+					{
+						return exactInfo(exact);
+					}
+
+					for (auto child = children.rbegin(); child != children.rend(); ++child)
+					{
+						if (child->exact)
+						{
+							info.suffix = child->str + info.suffix;
+							continue;
+						}
+						info.suffix = child->suffix + info.suffix;
+						break;
+					}
+
+					if (info.prefix.size() > REGEX_MAX_LITERAL)
+					{
+						info.prefix.resize(REGEX_MAX_LITERAL);
+					}
+					if (info.suffix.size() > REGEX_MAX_LITERAL)
+					{
+						info.suffix = info.suffix.substr(info.suffix.size() - REGEX_MAX_LITERAL);
+					}
+					return info;
+				}
+
+				case REGEX_NODE_ALTERNATE:
+				{
+					RegexLiteralInfo first = analyze(*node.children[0]);
+					bool sameExact = first.exact;
+					info.prefix = first.prefix;
+					info.suffix = first.suffix;
+
+					for (size_t i = 1; i < node.children.size(); ++i)
+					{
+						RegexLiteralInfo other = analyze(*node.children[i]);
+						sameExact = sameExact && other.exact && other.str == first.str;
+
+						// 公共前缀与公共后缀
+						size_t n = 0;
+						while (n < info.prefix.size() && n < other.prefix.size() && info.prefix[n] == other.prefix[n])
+						{
+							n++;
+						}
+						info.prefix.resize(n);
+
+						n = 0;
+						while (n < info.suffix.size() && n < other.suffix.size() && info.suffix[info.suffix.size() - 1 - n] == other.suffix[other.suffix.size() - 1 - n])
+						{
+							n++;
+						}
+						info.suffix = info.suffix.substr(info.suffix.size() - n);
+					}
+
+					if (sameExact)
+					{
+						return first;
+					}
+					keepLonger(info.required, info.prefix);
+					keepLonger(info.required, info.suffix);
+					return info;
+				}
+
+				case REGEX_NODE_REPEAT:
+				{
+					if (node.max == 0)
+					{
+						return exactInfo("");
+					}
+					if (node.min == 0)
+					{
+						return info;
+					}
+
+					RegexLiteralInfo child = analyze(*node.children[0]);
+					if (child.exact && node.min == node.max)
+					{
+						std::string repeated;
+						for (int i = 0; i < node.min && repeated.size() <= REGEX_MAX_LITERAL; ++i)
+						{
+							repeated += child.str;
+						}
+						if (repeated.size() <= REGEX_MAX_LITERAL)
+						{
+							return exactInfo(repeated);
+						}
+					}
+					info.prefix = child.prefix;
+					info.suffix = child.suffix;
+					info.required = child.required;
+					return info;
+				}
+				}
+
+				return info;
+			}
+
+
+			RegexLiterals extractLiterals(const RegexNode& root)
+			{
+				RegexLiteralInfo info = analyze(root);
+				RegexLiterals literals;
+				literals.prefix = info.prefix;
+				literals.required = info.required;
+				if (literals.prefix.size() > literals.required.size())
+				{
+					literals.required = literals.prefix;
+				}
+				return literals;
+			}
+
+
+			static inline int lowestBit(unsigned int mask)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return static_cast<int>(index);
+#else
+				return __builtin_ctz(mask);
+#endif
+			}
+
+
+			static size_t findScalar(const char* data, size_t size, size_t from, const std::string& literal)
+			{
+				size_t n = literal.size();
+				const char* pos = data + from;
+				const char* end = data + size;
+
+				while (static_cast<size_t>(end - pos) >= n)
+				{
+					const char* hit = static_cast<const char*>(memchr(pos, literal[0], end - pos - n + 1));
+					if (!hit)
+					{
+						return std::string::npos;
+					}
+					if (memcmp(hit + 1, literal.data() + 1, n - 1) == 0)
+					{
+						return hit - data;
+					}
+					pos = hit + 1;
+				}
+				return std::string::npos;
+			}
+
+
+#ifdef REGEX_PREFILTER_SSE2
+			// 同时比较首字节与末字节，两者都相同的位置再比较中间部分
+			static size_t findSSE2(const char* data, size_t size, size_t from, const std::string& literal)
+			{
+				size_t n = literal.size();
+				const __m128i first = _mm_set1_epi8(literal[0]);
+				const __m128i last = _mm_set1_epi8(literal[n - 1]);
+				size_t i = from;
+
+				for (; i + n - 1 + 16 <= size; i += 16)
+				{
+					__m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+					__m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n - 1));
+					unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+
+					while (mask)
+					{
+						int bit = lowestBit(mask);
+						if (n <= 2 || memcmp(data + i + bit + 1, literal.data() + 1, n - 2) == 0)
+						{
+							return i + bit;
+						}
+						mask &= mask - 1;
+					}
+				}
+				return findScalar(data, size, i, literal);
+			}
+#endif
+
+
+#ifdef REGEX_PREFILTER_AVX2
+			REGEX_TARGET_AVX2
+			static size_t findAVX2(const char* data, size_t size, size_t from, const std::string& literal)
+			{
+				size_t n = literal.size();
+				const __m256i first = _mm256_set1_epi8(literal[0]);
+				const __m256i last = _mm256_set1_epi8(literal[n - 1]);
+				size_t i = from;
+
+				for (; i + n - 1 + 32 <= size; i += 32)
+				{
+					__m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+					__m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + n - 1));
+					unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+
+					while (mask)
+					{
+						int bit = lowestBit(mask);
+						if (n <= 2 || memcmp(data + i + bit + 1, literal.data() + 1, n - 2) == 0)
+						{
+							return i + bit;
+						}
+						mask &= mask - 1;
+					}
+				}
+				return findScalar(data, size, i, literal);
+			}
+
+
+			static bool cpuHasAVX2()
+			{
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+				{
+					return false;
+				}
+				__cpuid(info, 1);
+				// 操作系统需要保存 YMM 寄存器
+				if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+				{
+					return false;
+				}
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2") != 0;
+#endif
+			}
+#endif
+
+
+			typedef size_t(*RegexFindFunction)(const char*, size_t, size_t, const std::string&);
+
+			struct RegexFindImpl
+			{
+				RegexFindFunction find;
+				const char* name;
+			};
+
+
+			static RegexFindImpl selectFindImpl()
+			{
+#ifdef REGEX_PREFILTER_AVX2
+				if (cpuHasAVX2())
+				{
+					return { findAVX2, "avx2" };
+				}
+#endif
+#ifdef REGEX_PREFILTER_SSE2
+				return { findSSE2, "sse2" };
+#else
+				return { findScalar, "scalar" };
+#endif
+			}
+
+
+			static const RegexFindImpl& findImpl()
+			{
+				static const RegexFindImpl impl = selectFindImpl();
+				return impl;
+			}
+
+
+			size_t regexFindLiteral(const char* data, size_t size, size_t from, const std::string& literal)
+			{
+				if (literal.empty())
+				{
+					return from <= size ? from : std::string::npos;
+				}
+				if (from >= size || size - from < literal.size())
+				{
+					return std::string::npos;
+				}
+				if (literal.size() == 1)
+				{
+					const void* hit = memchr(data + from, literal[0], size - from);
+					return hit ? static_cast<const char*>(hit) - data : std::string::npos;
+				}
+				return findImpl().find(data, size, from, literal);
+			}
+
+
+			const char* regexFindLiteralImpl()
+			{
+				return findImpl().name;
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_PREFILTER_H_
+#define _TFC_UTIL_REGEX_PREFILTER_H_
+
+#include "parser.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			// 每个匹配都必须包含的字符串
+			struct RegexLiterals
+			{
+				std::string prefix;    // 每个匹配都以它开头
+				std::string required;  // 每个匹配都包含它，取能找到的最长者
+			};
+
+
+			// 从语法树中提取必需的字符串，找不到时为空串
+			RegexLiterals extractLiterals(const RegexNode& root);
+
+
+			// 在 [from, size) 中查找 literal，返回开始位置，没有找到返回 npos
+			// 运行时根据 CPU 选择 AVX2、SSE2 或普通实现
+			size_t regexFindLiteral(const char* data, size_t size, size_t from, const std::string& literal);
+
+			// 当前使用的实现："avx2"、"sse2" 或 "scalar"
+			const char* regexFindLiteralImpl();
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_PREFILTER_H_
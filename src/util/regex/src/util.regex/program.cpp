@@ -0,0 +1,352 @@
+#include "program.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			// 展开重复后允许的最大指令数
+			static const size_t REGEX_MAX_INSTS = 1 << 20;
+
+
+			// 尚未连接的出口，inst * 2 + (0 表示 out，1 表示 out1)
+			struct RegexFragment
+			{
+				int start;
+				std::vector<int> holes;
+
+				RegexFragment() : start(-1) {}
+			};
+
+
+			class RegexCompiler
+			{
+			public:
+				RegexCompiler(RegexProgram& _prog, bool _reverse) : prog(_prog), reverse(_reverse) {}
+
+				RegexFragment compile(const RegexNode& node);
+
+				void patch(const std::vector<int>& holes, int target)
+				{
+					for (auto it = holes.begin(); it != holes.end(); ++it)
+					{
+						RegexInst& inst = prog.insts[*it >> 1];
+						if (*it & 1)
+						{
+							inst.out1 = target;
+						}
+						else
+						{
+							inst.out = target;
+						}
+					}
+				}
+
+				int emit(RegexOp op, int charset = -1)
+				{
+					if (prog.insts.size() >= REGEX_MAX_INSTS)
+					{
+						throw RegexException(REGEX_ERR_TOO_COMPLEX, "pattern expands to too many instructions");
+					}
+					RegexInst inst = { op, -1, -1, charset, 0 };
+					prog.insts.push_back(inst);
+					return static_cast<int>(prog.insts.size() - 1);
+				}
+
+			private:
+				RegexFragment compileRepeat(const RegexNode& node);
+				int internCharset(const RegexCharSet& set);
+
+			private:
+				RegexProgram& prog;
+				bool reverse;
+
+			};
+
+
+			int RegexCompiler::internCharset(const RegexCharSet& set)
+			{
+				for (size_t i = 0; i < prog.charsets.size(); ++i)
+				{
+					if (prog.charsets[i] == set)
+					{
+						return static_cast<int>(i);
+					}
+				}
+				prog.charsets.push_back(set);
+				return static_cast<int>(prog.charsets.size() - 1);
+			}
+
+
+			RegexFragment RegexCompiler::compile(const RegexNode& node)
+			{
+				RegexFragment frag;
+
+				switch (node.type)
+				{
+				case REGEX_NODE_EMPTY:
+					frag.start = emit(REGEX_OP_NOP);
+					frag.holes.push_back(frag.start * 2);
+					return frag;
+
+				case REGEX_NODE_CHARSET:
+					frag.start = emit(REGEX_OP_CHARSET, internCharset(node.chars));
+					frag.holes.push_back(frag.start * 2);
+					return frag;
+
+				case REGEX_NODE_BEGIN:
+				case REGEX_NODE_END:
+				{
+					// 反向程序中 ^ 与 $ 交换
+					bool begin = (node.type == REGEX_NODE_BEGIN) != reverse;
+					frag.start = emit(begin ? REGEX_OP_BEGIN : REGEX_OP_END);
+					frag.holes.push_back(frag.start * 2);
+					return frag;
+				}
+
+				case REGEX_NODE_CONCAT:
+				{
+					size_t n = node.children.size();
+					for (size_t i = 0; i < n; ++i)
+					{
+						const RegexNode& child = *node.children[reverse ? n - 1 - i : i];
+						RegexFragment next = compile(child);
+						if (i == 0)
+						{
+							frag = std::move(next);
+						}
+						else
+						{
+							patch(frag.holes, next.start);
+							frag.holes = std::move(next.holes);
+						}
+					}
+					return frag;
+				}
+
+				case REGEX_NODE_ALTERNATE:
+				{
+					// a|b|c 编译为 split(a, split(b, c))
+					int prevSplit = -1;
+					size_t n = node.children.size();
+					for (size_t i = 0; i < n; ++i)
+					{
+						int split = -1;
+						if (i + 1 < n)
+						{
+							split = emit(REGEX_OP_SPLIT);
+						}
+
+						RegexFragment branch = compile(*node.children[i]);
+						int entry = branch.start;
+						if (split >= 0)
+						{
+							prog.insts[split].out = branch.start;
+							entry = split;
+						}
+
+						if (prevSplit >= 0)
+						{
+							prog.insts[prevSplit].out1 = entry;
+						}
+						else
+						{
+							frag.start = entry;
+						}
+						frag.holes.insert(frag.holes.end(), branch.holes.begin(), branch.holes.end());
+						prevSplit = split;
+					}
+					return frag;
+				}
+
+				case REGEX_NODE_REPEAT:
+					return compileRepeat(node);
+				}
+
+				return frag;
+			}
+
+
+			RegexFragment RegexCompiler::compileRepeat(const RegexNode& node)
+			{
+				const RegexNode& child = *node.children[0];
+				RegexFragment frag;
+				bool empty = true;
+
+				auto append = [&](RegexFragment next)
+				{
+					if (empty)
+					{
+						frag = std::move(next);
+						empty = false;
+					}
+					else
+					{
+						patch(frag.holes, next.start);
+						frag.holes = std::move(next.holes);
+					}
+				};
+
+				// 必须出现的部分，x{3,} 中最后一次与后面的 x* 合并为 x+
+				int required = node.min;
+				if (node.max == -1 && required > 0)
+				{
+					required--;
+				}
+				for (int i = 0; i < required; ++i)
+				{
+					append(compile(child));
+				}
+
+				if (node.max == -1)
+				{
+					RegexFragment loop;
+					int split = emit(REGEX_OP_SPLIT);
+					RegexFragment body = compile(child);
+					patch(body.holes, split);
+					prog.insts[split].out = body.start;
+					loop.holes.push_back(split * 2 + 1);
+
+					// x+ 从循环体进入，x* 从 split 进入
+					loop.start = node.min > 0 ? body.start : split;
+					append(std::move(loop));
+				}
+				else if (node.max > node.min)
+				{
+					// x{0,2} 编译为 split(x split(x, 出口), 出口)
+					RegexFragment optional;
+					std::vector<int> skips;
+					for (int i = node.min; i < node.max; ++i)
+					{
+						int split = emit(REGEX_OP_SPLIT);
+						RegexFragment body = compile(child);
+						prog.insts[split].out = body.start;
+						skips.push_back(split * 2 + 1);
+
+						if (i == node.min)
+						{
+							optional.start = split;
+						}
+						else
+						{
+							patch(optional.holes, split);
+						}
+						optional.holes = std::move(body.holes);
+					}
+					optional.holes.insert(optional.holes.end(), skips.begin(), skips.end());
+					append(std::move(optional));
+				}
+
+				if (empty)
+				{
+					// x{0} 只匹配空串
+					frag.start = emit(REGEX_OP_NOP);
+					frag.holes.push_back(frag.start * 2);
+				}
+				return frag;
+			}
+
+
+			// 按照所有字符集划分字节，划分到同一类的字节在任何指令上的行为都相同
+			static void buildByteClasses(RegexProgram& prog)
+			{
+				int classOf[256] = { 0 };
+				int count = 1;
+
+				for (auto set = prog.charsets.begin(); set != prog.charsets.end(); ++set)
+				{
+					// 旧类 * 2 + 是否属于 set 映射到新类
+					std::vector<int> remap(count * 2, -1);
+					int next = 0;
+					for (int c = 0; c < 256; ++c)
+					{
+						int key = classOf[c] * 2 + set->test(static_cast<unsigned char>(c));
+						if (remap[key] < 0)
+						{
+							remap[key] = next++;
+						}
+						classOf[c] = remap[key];
+					}
+					count = next;
+				}
+
+				prog.classCount = count;
+				prog.classByte.assign(count, 0);
+				std::vector<bool> seen(count, false);
+				for (int c = 0; c < 256; ++c)
+				{
+					prog.byteClass[c] = static_cast<unsigned short>(classOf[c]);
+					if (!seen[classOf[c]])
+					{
+						seen[classOf[c]] = true;
+						prog.classByte[classOf[c]] = static_cast<unsigned char>(c);
+					}
+				}
+			}
+
+
+			std::unique_ptr<RegexProgram> compileProgram(const RegexNode& root, bool reverse)
+			{
+				std::unique_ptr<RegexProgram> prog(new RegexProgram());
+				RegexCompiler compiler(*prog, reverse);
+
+				RegexFragment frag = compiler.compile(root);
+				int match = compiler.emit(REGEX_OP_MATCH);
+				compiler.patch(frag.holes, match);
+				prog->start = frag.start;
+				prog->patternCount = 1;
+				prog->patternSet = false;
+
+				buildByteClasses(*prog);
+				return prog;
+			}
+
+
+			std::unique_ptr<RegexProgram> compileProgramSet(const std::vector<const RegexNode*>& roots)
+			{
+				std::unique_ptr<RegexProgram> prog(new RegexProgram());
+				RegexCompiler compiler(*prog, false);
+
+				// 与 a|b|c 相同，用一串 split 连接各个模式，每个模式有自己的 MATCH
+				int prevSplit = -1;
+				for (size_t i = 0; i < roots.size(); ++i)
+				{
+					int split = -1;
+					if (i + 1 < roots.size())
+					{
+						split = compiler.emit(REGEX_OP_SPLIT);
+					}
+
+					RegexFragment frag = compiler.compile(*roots[i]);
+					int match = compiler.emit(REGEX_OP_MATCH);
+					prog->insts[match].pattern = static_cast<int>(i);
+					compiler.patch(frag.holes, match);
+
+					int entry = frag.start;
+					if (split >= 0)
+					{
+						prog->insts[split].out = frag.start;
+						entry = split;
+					}
+					if (prevSplit >= 0)
+					{
+						prog->insts[prevSplit].out1 = entry;
+					}
+					else
+					{
+						prog->start = entry;
+					}
+					prevSplit = split;
+				}
+				prog->patternCount = static_cast<int>(roots.size());
+				prog->patternSet = true;
+
+				buildByteClasses(*prog);
+				return prog;
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_PROGRAM_H_
+#define _TFC_UTIL_REGEX_PROGRAM_H_
+
+#include "parser.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			enum RegexOp
+			{
+				REGEX_OP_CHARSET,  // 读入一个属于 charsets[charset] 的字节后转到 out
+				REGEX_OP_SPLIT,    // 同时转到 out 和 out1
+				REGEX_OP_NOP,      // 直接转到 out
+				REGEX_OP_BEGIN,    // 位于输入开头时转到 out
+				REGEX_OP_END,      // 位于输入末尾时转到 out
+				REGEX_OP_MATCH     // 匹配成功
+			};
+
+
+			struct RegexInst
+			{
+				RegexOp op;
+				int out;
+				int out1;
+				int charset;
+				int pattern;   // MATCH 指令所属的模式编号
+			};
+
+
+			/*
+			* Thompson 构造得到的 NFA
+			* 字节按照所有字符集的划分归并为等价类，DFA 的转移表只需要 classCount 列
+			*/
+			struct RegexProgram
+			{
+				std::vector<RegexInst> insts;
+				std::vector<RegexCharSet> charsets;
+				int start;
+				int patternCount;
+				bool patternSet;   // 由 compileProgramSet 生成，匹配时需要区分是哪个模式
+
+				unsigned short byteClass[256];
+				int classCount;
+				std::vector<unsigned char> classByte;  // 每个等价类的代表字节
+			};
+
+
+			// 把语法树编译为 NFA；reverse 为 true 时得到匹配反向输入的程序
+			std::unique_ptr<RegexProgram> compileProgram(const RegexNode& root, bool reverse);
+
+			// 把多个模式编译为一个 NFA，第 i 个模式的 MATCH 指令的 pattern 为 i；roots 不能为空
+			std::unique_ptr<RegexProgram> compileProgramSet(const std::vector<const RegexNode*>& roots);
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_PROGRAM_H_
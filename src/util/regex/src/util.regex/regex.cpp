@@ -0,0 +1,144 @@
+#include "regex.h"
+#include "parser.h"
+#include "program.h"
+#include "dfa.h"
+#include "prefilter.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			Regex::Regex(const std::string& pattern, int flags) : source(pattern)
+			{
+				RegexParser parser(source, flags);
+				RegexNodePtr root = parser.parse();
+
+				forward = compileProgram(*root, false);
+				reverse = compileProgram(*root, true);
+
+				bool lazy = (flags & REGEX_LAZY) != 0;
+				forwardDFA.reset(new RegexDFA(*forward, true, false, lazy));
+				longestDFA.reset(new RegexDFA(*forward, true, true, lazy));
+				reverseDFA.reset(new RegexDFA(*reverse, false, false, lazy));
+
+				// 必需的字符串用于在扫描前排除不可能匹配的输入，前缀还能让正向扫描跳到候选位置
+				RegexLiterals literals = extractLiterals(*root);
+				required = literals.required;
+				forwardDFA->setPrefix(literals.prefix);
+				longestDFA->setPrefix(literals.prefix);
+			}
+
+
+			// RegexProgram 与 RegexDFA 在这里才是完整类型
+			Regex::~Regex()
+			{
+			}
+
+
+			bool Regex::match(const char* data, size_t size) const
+			{
+				// 反向锚定扫描整个输入，能在位置 0 结束即完全匹配
+				return reverseDFA->scanReverse(data, size, size, 0) == 0;
+			}
+
+
+			bool Regex::match(const std::string& text) const
+			{
+				return match(text.data(), text.size());
+			}
+
+
+			bool Regex::search(const char* data, size_t size) const
+			{
+				if (!required.empty() && regexFindLiteral(data, size, 0, required) == std::string::npos)
+				{
+					return false;
+				}
+				return forwardDFA->scanForward(data, size, 0, true) != std::string::npos;
+			}
+
+
+			bool Regex::search(const std::string& text) const
+			{
+				return search(text.data(), text.size());
+			}
+
+
+			bool Regex::search(const char* data, size_t size, RegexMatch& result, size_t from) const
+			{
+				if (from > size)
+				{
+					return false;
+				}
+
+				if (!required.empty() && regexFindLiteral(data, size, from, required) == std::string::npos)
+				{
+					return false;
+				}
+
+				// 先判断是否存在匹配，多数不匹配的输入只需扫描一遍
+				if (forwardDFA->scanForward(data, size, from, true) == std::string::npos)
+				{
+					return false;
+				}
+
+				// 最左最长匹配的结束位置，再从结束位置反向找到最早的开始位置
+				size_t end = longestDFA->scanForward(data, size, from, false);
+				size_t begin = reverseDFA->scanReverse(data, size, end, from);
+
+				result.begin = begin;
+				result.end = end;
+				return true;
+			}
+
+
+			bool Regex::search(const std::string& text, RegexMatch& result, size_t from) const
+			{
+				return search(text.data(), text.size(), result, from);
+			}
+
+
+			std::vector<RegexMatch> Regex::searchAll(const std::string& text) const
+			{
+				std::vector<RegexMatch> matches;
+				RegexMatch found;
+				size_t from = 0;
+
+				while (search(text, found, from))
+				{
+					matches.push_back(found);
+
+					// 空匹配后前进一个字节，避免在同一位置反复匹配
+					from = found.end > found.begin ? found.end : found.end + 1;
+					if (from > text.size())
+					{
+						break;
+					}
+				}
+				return matches;
+			}
+
+
+			std::string Regex::pattern() const
+			{
+				return source;
+			}
+
+
+			bool Regex::isDFACompiled() const
+			{
+				return forwardDFA->isCompiled() && longestDFA->isCompiled() && reverseDFA->isCompiled();
+			}
+
+
+			size_t Regex::stateCount() const
+			{
+				return forwardDFA->stateCount() + longestDFA->stateCount() + reverseDFA->stateCount();
+			}
+
+
+		};
+	};
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_REGEX_H_
+#define _TFC_UTIL_REGEX_REGEX_H_
+
+#define REGEX_RET_OK 0
+
+// 括号不匹配
+#define REGEX_ERR_UNMATCHED_PAREN 2
+
+// 字符类 `[' 没有结束
+#define REGEX_ERR_UNMATCHED_BRACKET 3
+
+// 重复次数写法错误，或重复的对象为空
+#define REGEX_ERR_BAD_REPEAT 4
+
+// 转义序列错误
+#define REGEX_ERR_BAD_ESCAPE 5
+
+// 字符范围错误，如 [z-a]
+#define REGEX_ERR_BAD_RANGE 6
+
+// 不支持的语法（反向引用、环视、\b 等无法用有限自动机实现的特性）
+#define REGEX_ERR_UNSUPPORTED 7
+
+// 模式展开后过大
+#define REGEX_ERR_TOO_COMPLEX 8
+
+// 模式集合在 compile() 之前被使用
+#define REGEX_ERR_NOT_COMPILED 9
+
+// 忽略大小写（仅 ASCII）
+#define REGEX_ICASE 1
+
+// 不预先构建 DFA，匹配时按需构造状态，编译时间与模式长度成正比
+#define REGEX_LAZY 2
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <exception>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			class RegexException : std::exception {
+				int _errno;
+				std::string _info;
+			public:
+				RegexException(int errtype, std::string info) : _errno(errtype), _info(info) {}
+				~RegexException() {}
+				inline int errtype()
+				{
+					return _errno;
+				}
+				inline std::string info()
+				{
+					return _info;
+				}
+			};
+
+
+			// 一次匹配的位置，[begin, end)
+			struct RegexMatch
+			{
+				size_t begin;
+				size_t end;
+			};
+
+
+			struct RegexProgram;
+			class RegexDFA;
+
+
+			/*
+			* 基于有限自动机的正则表达式
+			* 语法是 ECMAScript 的子集，按字节匹配：模式先解析为语法树，再编译为 NFA，
+			* 匹配时通过子集构造得到的 DFA 进行，时间与输入长度成线性关系，不会回溯。
+			* 匹配位置采用最左最长语义；不支持捕获组内容、反向引用和环视
+			*/
+			class Regex
+			{
+			public:
+				Regex(const std::string& pattern, int flags = 0);
+				~Regex();
+
+				Regex(const Regex&) = delete;
+				Regex& operator=(const Regex&) = delete;
+
+			public:
+
+				// 整个输入与模式完全匹配
+				bool match(const char* data, size_t size) const;
+				bool match(const std::string& text) const;
+
+				// 输入中存在匹配
+				bool search(const char* data, size_t size) const;
+				bool search(const std::string& text) const;
+
+				// 从 from 开始查找最左最长的匹配
+				bool search(const char* data, size_t size, RegexMatch& result, size_t from = 0) const;
+				bool search(const std::string& text, RegexMatch& result, size_t from = 0) const;
+
+				// 依次查找所有不重叠的匹配
+				std::vector<RegexMatch> searchAll(const std::string& text) const;
+
+				std::string pattern() const;
+
+				// 状态数超过上限或指定 REGEX_LAZY 时 DFA 不会完整构建，匹配时按需构造状态
+				bool isDFACompiled() const;
+
+				// 当前缓存的 DFA 状态数
+				size_t stateCount() const;
+
+			private:
+				std::string source;
+				std::unique_ptr<RegexProgram> forward;
+				std::unique_ptr<RegexProgram> reverse;
+				std::unique_ptr<RegexDFA> forwardDFA;      // 判断是否匹配
+				std::unique_ptr<RegexDFA> longestDFA;      // 查找最左最长匹配的结束位置
+				std::unique_ptr<RegexDFA> reverseDFA;      // 从结束位置反向查找开始位置
+				std::string required;                      // 每个匹配都包含的字符串，用于预先过滤
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_REGEX_H_
@@ -0,0 +1,134 @@
+#include "regex_set.h"
+#include "parser.h"
+#include "program.h"
+#include "dfa.h"
+#include "aho_corasick.h"
+
+#include <algorithm>
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+			RegexSet::RegexSet(int flags) : flags(flags), compiled(false), patternCount(0)
+			{
+				literalMatcher.reset(new RegexAhoCorasick((flags & REGEX_ICASE) != 0));
+			}
+
+
+			// RegexNode、RegexProgram 与 RegexDFA 在这里才是完整类型
+			RegexSet::~RegexSet()
+			{
+			}
+
+
+			int RegexSet::addLiteral(const std::string& literal)
+			{
+				literalMatcher->add(literal);
+				literalIds.push_back(patternCount);
+				compiled = false;
+				return patternCount++;
+			}
+
+
+			int RegexSet::add(const std::string& pattern)
+			{
+				// 立即解析，语法错误在加入时就抛出
+				RegexParser parser(pattern, flags);
+				regexRoots.push_back(parser.parse());
+				regexIds.push_back(patternCount);
+				compiled = false;
+				return patternCount++;
+			}
+
+
+			void RegexSet::compile()
+			{
+				literalMatcher->build();
+
+				combinedDFA.reset();
+				combined.reset();
+				reverseDFAs.clear();
+				reversePrograms.clear();
+
+				if (!regexRoots.empty())
+				{
+					std::vector<const RegexNode*> roots;
+					for (auto it = regexRoots.begin(); it != regexRoots.end(); ++it)
+					{
+						roots.push_back(it->get());
+					}
+					combined = compileProgramSet(roots);
+					combinedDFA.reset(new RegexDFA(*combined, true, false));
+
+					// 反向 DFA 只在该模式匹配时才会用到，按需构造
+					for (auto it = regexRoots.begin(); it != regexRoots.end(); ++it)
+					{
+						reversePrograms.push_back(compileProgram(**it, true));
+						reverseDFAs.push_back(std::unique_ptr<RegexDFA>(new RegexDFA(*reversePrograms.back(), false, false, true)));
+					}
+				}
+				compiled = true;
+			}
+
+
+			size_t RegexSet::size() const
+			{
+				return patternCount;
+			}
+
+
+			std::vector<RegexSetMatch> RegexSet::search(const char* data, size_t size) const
+			{
+				if (!compiled)
+				{
+					throw RegexException(REGEX_ERR_NOT_COMPILED, "RegexSet::compile() must be called before search");
+				}
+
+				std::vector<RegexSetMatch> result;
+				std::vector<size_t> firstEnd;
+
+				if (literalMatcher->size() > 0)
+				{
+					literalMatcher->scan(data, size, firstEnd);
+					for (size_t i = 0; i < firstEnd.size(); ++i)
+					{
+						if (firstEnd[i] != std::string::npos)
+						{
+							RegexSetMatch found = { literalIds[i], firstEnd[i] - literalMatcher->literalLength(static_cast<int>(i)), firstEnd[i] };
+							result.push_back(found);
+						}
+					}
+				}
+
+				if (combinedDFA)
+				{
+					combinedDFA->scanPatterns(data, size, firstEnd);
+					for (size_t i = 0; i < firstEnd.size(); ++i)
+					{
+						if (firstEnd[i] != std::string::npos)
+						{
+							// 以该位置结束的最左匹配
+							size_t begin = reverseDFAs[i]->scanReverse(data, size, firstEnd[i], 0);
+							RegexSetMatch found = { regexIds[i], begin, firstEnd[i] };
+							result.push_back(found);
+						}
+					}
+				}
+
+				std::sort(result.begin(), result.end(), [](const RegexSetMatch& a, const RegexSetMatch& b) { return a.pattern < b.pattern; });
+				return result;
+			}
+
+
+			std::vector<RegexSetMatch> RegexSet::search(const std::string& text) const
+			{
+				return search(text.data(), text.size());
+			}
+
+
+		};
+	};
+};
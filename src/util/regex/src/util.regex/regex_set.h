@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_REGEX_SET_H_
+#define _TFC_UTIL_REGEX_REGEX_SET_H_
+
+#include "regex.h"
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			// 集合中某个模式的一次匹配，[begin, end)
+			struct RegexSetMatch
+			{
+				int pattern;
+				size_t begin;
+				size_t end;
+			};
+
+
+			struct RegexNode;
+			class RegexAhoCorasick;
+
+
+			/*
+			* 多模式匹配
+			* 字符串模式编译进一个 Aho-Corasick 自动机，正则模式编译进一个合并的 DFA，
+			* 一次扫描即可得到所有匹配的模式，时间与输入长度成正比，与模式的个数无关。
+			* 每个匹配的模式报告结束位置最早的一次匹配；正则模式的开始位置再由该模式的反向 DFA 求出
+			*/
+			class RegexSet
+			{
+			public:
+				RegexSet(int flags = 0);
+				~RegexSet();
+
+				RegexSet(const RegexSet&) = delete;
+				RegexSet& operator=(const RegexSet&) = delete;
+
+			public:
+
+				// 加入模式，返回模式编号；编号按加入顺序从 0 开始，两种模式共用
+				int addLiteral(const std::string& literal);
+				int add(const std::string& pattern);
+
+				// 加入模式之后、匹配之前调用
+				void compile();
+
+				size_t size() const;
+
+				// 所有匹配的模式，按模式编号排序
+				std::vector<RegexSetMatch> search(const char* data, size_t size) const;
+				std::vector<RegexSetMatch> search(const std::string& text) const;
+
+			private:
+				int flags;
+				bool compiled;
+				int patternCount;
+
+				std::vector<int> literalIds;       // 字符串在 literalMatcher 中的编号 -> 模式编号
+				std::unique_ptr<RegexAhoCorasick> literalMatcher;
+
+				std::vector<int> regexIds;         // 正则在合并程序中的编号 -> 模式编号
+				std::vector<std::unique_ptr<RegexNode>> regexRoots;
+				std::unique_ptr<RegexProgram> combined;
+				std::unique_ptr<RegexDFA> combinedDFA;
+				std::vector<std::unique_ptr<RegexProgram>> reversePrograms;
+				std::vector<std::unique_ptr<RegexDFA>> reverseDFAs;
+
+			};
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_REGEX_SET_H_
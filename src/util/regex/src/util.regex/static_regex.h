@@ -0,0 +1,740 @@
+#pragma once
+
+#ifndef _TFC_UTIL_REGEX_STATIC_REGEX_H_
+#define _TFC_UTIL_REGEX_STATIC_REGEX_H_
+
+#include "regex.h"
+
+// 编译期正则表达式最多包含的字符位置数（展开重复之后）
+#define REGEX_STATIC_MAX_POSITIONS 64
+
+/*
+* 声明一个编译期模式，例如：
+*	TFC_REGEX_PATTERN(KeyName, "[A-Za-z_][A-Za-z0-9_.]*");
+*	StaticRegex<KeyName>::match(key);
+*/
+#define TFC_REGEX_PATTERN(name, literal) \
+	struct name \
+	{ \
+		static constexpr const char* value = literal; \
+	}
+
+namespace tfc
+{
+	namespace util
+	{
+		namespace regex
+		{
+
+			// 编译期可用的 256 位字节集合
+			struct StaticRegexCharSet
+			{
+				uint64_t bits[4];
+
+				constexpr StaticRegexCharSet() : bits{ 0, 0, 0, 0 } {}
+
+				constexpr bool test(unsigned char c) const
+				{
+					return ((bits[c >> 6] >> (c & 63)) & 1) != 0;
+				}
+
+				constexpr void set(unsigned char c)
+				{
+					bits[c >> 6] |= static_cast<uint64_t>(1) << (c & 63);
+				}
+
+				constexpr void setRange(int lo, int hi)
+				{
+					for (int c = lo; c <= hi; ++c)
+					{
+						set(static_cast<unsigned char>(c));
+					}
+				}
+
+				constexpr void merge(const StaticRegexCharSet& other)
+				{
+					for (int i = 0; i < 4; ++i)
+					{
+						bits[i] |= other.bits[i];
+					}
+				}
+
+				constexpr void invert()
+				{
+					for (int i = 0; i < 4; ++i)
+					{
+						bits[i] = ~bits[i];
+					}
+				}
+			};
+
+
+			/*
+			* Glushkov 自动机：每个字符位置是一个状态，没有空转移
+			* 状态集合用一个 64 位整数表示，读入字节 c 后的状态为
+			* (follow[p] 对当前所有位置 p 的并集) & accept[c]
+			*/
+			struct StaticRegexAutomaton
+			{
+				int positions;
+				uint64_t first;       // 可以作为第一个字节的位置
+				uint64_t last;        // 可以作为最后一个字节的位置
+				bool nullable;        // 是否匹配空串
+				bool anchorBegin;     // 模式以 ^ 开头
+				bool anchorEnd;       // 模式以 $ 结尾
+				uint64_t follow[REGEX_STATIC_MAX_POSITIONS];
+				uint64_t accept[256];
+
+				constexpr StaticRegexAutomaton()
+					: positions(0), first(0), last(0), nullable(false), anchorBegin(false), anchorEnd(false), follow{}, accept{}
+				{
+				}
+			};
+
+
+			// 子表达式的 first/last 集合
+			struct StaticRegexFragment
+			{
+				uint64_t first;
+				uint64_t last;
+				bool nullable;
+
+				constexpr StaticRegexFragment(uint64_t _first, uint64_t _last, bool _nullable)
+					: first(_first), last(_last), nullable(_nullable)
+				{
+				}
+			};
+
+
+			/*
+			* 在编译期解析模式，语法与 Regex 相同，但 ^ 只能出现在开头、$ 只能出现在结尾，
+			* 且顶层不能同时使用 | 与锚点。错误在常量求值中抛出，表现为编译错误
+			*/
+			class StaticRegexBuilder
+			{
+			public:
+				constexpr StaticRegexBuilder(const char* _pattern, int _flags)
+					: pattern(_pattern), pos(0), flags(_flags), automaton()
+				{
+				}
+
+				constexpr StaticRegexAutomaton build()
+				{
+					if (pattern[pos] == '^')
+					{
+						automaton.anchorBegin = true;
+						pos++;
+					}
+
+					int branches = 0;
+					StaticRegexFragment root = parseAlternate(branches);
+					if (pattern[pos] == '$' && pattern[pos + 1] == '\0')
+					{
+						automaton.anchorEnd = true;
+						pos++;
+					}
+					if (pattern[pos] == ')')
+					{
+						throw RegexException(REGEX_ERR_UNMATCHED_PAREN, "unmatched `)'");
+					}
+					if (pattern[pos] != '\0')
+					{
+						throw RegexException(REGEX_ERR_UNSUPPORTED, "anchors are only supported at the ends of a static pattern");
+					}
+					if (branches > 1 && (automaton.anchorBegin || automaton.anchorEnd))
+					{
+						throw RegexException(REGEX_ERR_UNSUPPORTED, "top-level `|' cannot be combined with anchors in a static pattern");
+					}
+
+					automaton.first = root.first;
+					automaton.last = root.last;
+					automaton.nullable = root.nullable;
+					return automaton;
+				}
+
+			private:
+				constexpr bool atTerminator() const
+				{
+					char c = pattern[pos];
+					return c == '\0' || c == '|' || c == ')' || (c == '$' && pattern[pos + 1] == '\0');
+				}
+
+				constexpr StaticRegexFragment parseAlternate(int& branches)
+				{
+					StaticRegexFragment result = parseConcat();
+					branches = 1;
+					while (pattern[pos] == '|')
+					{
+						pos++;
+						StaticRegexFragment next = parseConcat();
+						result.first |= next.first;
+						result.last |= next.last;
+						result.nullable = result.nullable || next.nullable;
+						branches++;
+					}
+					return result;
+				}
+
+				constexpr void link(uint64_t from, uint64_t to)
+				{
+					for (int p = 0; p < automaton.positions; ++p)
+					{
+						if ((from >> p) & 1)
+						{
+							automaton.follow[p] |= to;
+						}
+					}
+				}
+
+				constexpr StaticRegexFragment concat(const StaticRegexFragment& a, const StaticRegexFragment& b)
+				{
+					link(a.last, b.first);
+					return StaticRegexFragment(
+						a.nullable ? (a.first | b.first) : a.first,
+						b.nullable ? (a.last | b.last) : b.last,
+						a.nullable && b.nullable);
+				}
+
+				constexpr StaticRegexFragment parseConcat()
+				{
+					StaticRegexFragment result(0, 0, true);
+					while (!atTerminator())
+					{
+						result = concat(result, parseRepeat());
+					}
+					return result;
+				}
+
+				constexpr StaticRegexFragment parseRepeat()
+				{
+					char c = pattern[pos];
+					if (c == '*' || c == '+' || c == '?')
+					{
+						throw RegexException(REGEX_ERR_BAD_REPEAT, "nothing to repeat");
+					}
+					if (c == '{' && isDigit(pattern[pos + 1]))
+					{
+						throw RegexException(REGEX_ERR_BAD_REPEAT, "nothing to repeat");
+					}
+					if (c == '^' || c == '$')
+					{
+						throw RegexException(REGEX_ERR_UNSUPPORTED, "anchors are only supported at the ends of a static pattern");
+					}
+
+					size_t atomBegin = pos;
+					StaticRegexFragment atom = parseAtom();
+
+					int min = 1, max = 1;
+					c = pattern[pos];
+					if (c == '*')
+					{
+						min = 0;
+						max = -1;
+						pos++;
+					}
+					else if (c == '+')
+					{
+						min = 1;
+						max = -1;
+						pos++;
+					}
+					else if (c == '?')
+					{
+						min = 0;
+						max = 1;
+						pos++;
+					}
+					else if (c == '{')
+					{
+						pos++;
+						if (!isDigit(pattern[pos]))
+						{
+							throw RegexException(REGEX_ERR_BAD_REPEAT, "bad repeat count");
+						}
+						min = parseNumber();
+						max = min;
+						if (pattern[pos] == ',')
+						{
+							pos++;
+							max = -1;
+							if (pattern[pos] != '}')
+							{
+								if (!isDigit(pattern[pos]))
+								{
+									throw RegexException(REGEX_ERR_BAD_REPEAT, "bad repeat count");
+								}
+								max = parseNumber();
+							}
+						}
+						if (pattern[pos] != '}')
+						{
+							throw RegexException(REGEX_ERR_BAD_REPEAT, "unterminated `{'");
+						}
+						pos++;
+						if (max != -1 && max < min)
+						{
+							throw RegexException(REGEX_ERR_BAD_REPEAT, "repeat count out of order");
+						}
+					}
+					else
+					{
+						return atom;
+					}
+
+					// 非贪婪不影响是否匹配
+					if (pattern[pos] == '?')
+					{
+						pos++;
+					}
+					if (pattern[pos] == '*' || pattern[pos] == '+' || pattern[pos] == '?')
+					{
+						throw RegexException(REGEX_ERR_BAD_REPEAT, "nested quantifier");
+					}
+					size_t atomEnd = pos;
+
+					// 每多一次重复就重新解析一遍原子，得到新的字符位置
+					StaticRegexFragment result(0, 0, true);
+					int copies = max == -1 ? (min > 0 ? min : 1) : max;
+					for (int i = 0; i < copies; ++i)
+					{
+						StaticRegexFragment copy = atom;
+						if (i > 0)
+						{
+							pos = atomBegin;
+							copy = parseAtom();
+						}
+						if (i >= min)
+						{
+							copy.nullable = true;
+						}
+						if (max == -1 && i == copies - 1)
+						{
+							// x* 与 x{n,} 的最后一份可以无限重复
+							link(copy.last, copy.first);
+						}
+						result = concat(result, copy);
+					}
+					if (copies == 0)
+					{
+						// x{0} 丢弃已经分配的位置，它们不可到达
+						result = StaticRegexFragment(0, 0, true);
+					}
+
+					pos = atomEnd;
+					return result;
+				}
+
+				constexpr StaticRegexFragment parseAtom()
+				{
+					char c = pattern[pos];
+					if (c == '(')
+					{
+						pos++;
+						if (pattern[pos] == '?')
+						{
+							if (pattern[pos + 1] != ':')
+							{
+								throw RegexException(REGEX_ERR_UNSUPPORTED, "lookaround is not supported");
+							}
+							pos += 2;
+						}
+						int branches = 0;
+						StaticRegexFragment inner = parseAlternate(branches);
+						if (pattern[pos] != ')')
+						{
+							throw RegexException(REGEX_ERR_UNMATCHED_PAREN, "missing `)'");
+						}
+						pos++;
+						return inner;
+					}
+
+					StaticRegexCharSet set;
+					if (c == '[')
+					{
+						set = parseClass();
+					}
+					else if (c == '.')
+					{
+						set.set('\n');
+						set.set('\r');
+						set.invert();
+						pos++;
+					}
+					else if (c == '\\')
+					{
+						pos++;
+						if (pattern[pos] == 'u' && parseHexAt(pos + 1, 4) >= 0x80)
+						{
+							throw RegexException(REGEX_ERR_UNSUPPORTED, "non-ASCII \\u is not supported in a static pattern");
+						}
+						int single = parseEscape(set);
+						if (single >= 0)
+						{
+							set.set(static_cast<unsigned char>(single));
+						}
+					}
+					else
+					{
+						set.set(static_cast<unsigned char>(c));
+						pos++;
+					}
+					return position(set);
+				}
+
+				// 分配一个新的字符位置
+				constexpr StaticRegexFragment position(StaticRegexCharSet set)
+				{
+					if (automaton.positions >= REGEX_STATIC_MAX_POSITIONS)
+					{
+						throw RegexException(REGEX_ERR_TOO_COMPLEX, "static pattern has too many positions");
+					}
+					if (flags & REGEX_ICASE)
+					{
+						for (int c = 'A'; c <= 'Z'; ++c)
+						{
+							if (set.test(static_cast<unsigned char>(c)) || set.test(static_cast<unsigned char>(c + 32)))
+							{
+								set.set(static_cast<unsigned char>(c));
+								set.set(static_cast<unsigned char>(c + 32));
+							}
+						}
+					}
+
+					int p = automaton.positions++;
+					uint64_t bit = static_cast<uint64_t>(1) << p;
+					for (int c = 0; c < 256; ++c)
+					{
+						if (set.test(static_cast<unsigned char>(c)))
+						{
+							automaton.accept[c] |= bit;
+						}
+					}
+					return StaticRegexFragment(bit, bit, false);
+				}
+
+				constexpr StaticRegexCharSet parseClass()
+				{
+					StaticRegexCharSet set;
+					bool negate = false;
+					bool first = true;
+
+					pos++;
+					if (pattern[pos] == '^')
+					{
+						negate = true;
+						pos++;
+					}
+
+					for (;;)
+					{
+						char c = pattern[pos];
+						if (c == '\0')
+						{
+							throw RegexException(REGEX_ERR_UNMATCHED_BRACKET, "missing `]'");
+						}
+						if (c == ']' && !first)
+						{
+							pos++;
+							break;
+						}
+						first = false;
+
+						int lo = parseClassChar(set);
+						if (lo < 0)
+						{
+							continue;
+						}
+
+						if (pattern[pos] == '-' && pattern[pos + 1] != ']' && pattern[pos + 1] != '\0')
+						{
+							pos++;
+							StaticRegexCharSet unused;
+							int hi = parseClassChar(unused);
+							if (hi < 0)
+							{
+								throw RegexException(REGEX_ERR_BAD_RANGE, "character class in range");
+							}
+							if (hi < lo)
+							{
+								throw RegexException(REGEX_ERR_BAD_RANGE, "range out of order");
+							}
+							set.setRange(lo, hi);
+						}
+						else
+						{
+							set.set(static_cast<unsigned char>(lo));
+						}
+					}
+
+					if (negate)
+					{
+						// 忽略大小写要在取反之前展开
+						if (flags & REGEX_ICASE)
+						{
+							for (int c = 'A'; c <= 'Z'; ++c)
+							{
+								if (set.test(static_cast<unsigned char>(c)) || set.test(static_cast<unsigned char>(c + 32)))
+								{
+									set.set(static_cast<unsigned char>(c));
+									set.set(static_cast<unsigned char>(c + 32));
+								}
+							}
+						}
+						set.invert();
+					}
+					return set;
+				}
+
+				// 读入字符类中的一项，单个字符返回其值，\d 这样的集合并入 set 后返回 -1
+				constexpr int parseClassChar(StaticRegexCharSet& set)
+				{
+					char c = pattern[pos];
+					if (c != '\\')
+					{
+						pos++;
+						return static_cast<unsigned char>(c);
+					}
+
+					pos++;
+					if (pattern[pos] == 'b')
+					{
+						pos++;
+						return '\b';
+					}
+					if (pattern[pos] == 'u' && parseHexAt(pos + 1, 4) >= 0x80)
+					{
+						throw RegexException(REGEX_ERR_UNSUPPORTED, "non-ASCII \\u in character class is not supported");
+					}
+
+					StaticRegexCharSet escaped;
+					int single = parseEscape(escaped);
+					if (single < 0)
+					{
+						set.merge(escaped);
+					}
+					return single;
+				}
+
+				// 解析 `\' 之后的转义，集合写入 set 并返回 -1，单个字符返回其值
+				constexpr int parseEscape(StaticRegexCharSet& set)
+				{
+					char c = pattern[pos];
+					if (c == '\0')
+					{
+						throw RegexException(REGEX_ERR_BAD_ESCAPE, "trailing `\\'");
+					}
+					pos++;
+
+					switch (c)
+					{
+					case 'd': case 'D':
+						set.setRange('0', '9');
+						break;
+					case 'w': case 'W':
+						set.setRange('a', 'z');
+						set.setRange('A', 'Z');
+						set.setRange('0', '9');
+						set.set('_');
+						break;
+					case 's': case 'S':
+						set.set(' ');
+						set.setRange('\t', '\r');
+						break;
+					case 't': return '\t';
+					case 'n': return '\n';
+					case 'r': return '\r';
+					case 'f': return '\f';
+					case 'v': return '\v';
+					case '0':
+						if (isDigit(pattern[pos]))
+						{
+							throw RegexException(REGEX_ERR_BAD_ESCAPE, "octal escape is not supported");
+						}
+						return 0;
+					case 'x':
+						pos += 2;
+						return parseHexAt(pos - 2, 2);
+					case 'u':
+						pos += 4;
+						return parseHexAt(pos - 4, 4);
+					case 'c':
+						if ((pattern[pos] >= 'a' && pattern[pos] <= 'z') || (pattern[pos] >= 'A' && pattern[pos] <= 'Z'))
+						{
+							return pattern[pos++] % 32;
+						}
+						throw RegexException(REGEX_ERR_BAD_ESCAPE, "bad control escape");
+					case 'b': case 'B':
+						throw RegexException(REGEX_ERR_UNSUPPORTED, "word boundary is not supported");
+					default:
+						if (isDigit(c))
+						{
+							throw RegexException(REGEX_ERR_UNSUPPORTED, "backreference is not supported");
+						}
+						if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+						{
+							throw RegexException(REGEX_ERR_BAD_ESCAPE, "unknown escape");
+						}
+						return static_cast<unsigned char>(c);
+					}
+
+					if (c == 'D' || c == 'W' || c == 'S')
+					{
+						set.invert();
+					}
+					return -1;
+				}
+
+				constexpr int parseHexAt(size_t at, int digits) const
+				{
+					int value = 0;
+					for (int i = 0; i < digits; ++i)
+					{
+						char c = pattern[at + i];
+						int digit = c >= '0' && c <= '9' ? c - '0'
+							: c >= 'a' && c <= 'f' ? c - 'a' + 10
+							: c >= 'A' && c <= 'F' ? c - 'A' + 10
+							: -1;
+						if (digit < 0)
+						{
+							throw RegexException(REGEX_ERR_BAD_ESCAPE, "bad hex escape");
+						}
+						value = value * 16 + digit;
+					}
+					return value;
+				}
+
+				constexpr int parseNumber()
+				{
+					int value = 0;
+					while (isDigit(pattern[pos]))
+					{
+						value = value * 10 + (pattern[pos] - '0');
+						if (value > REGEX_STATIC_MAX_POSITIONS)
+						{
+							throw RegexException(REGEX_ERR_TOO_COMPLEX, "repeat count too large for a static pattern");
+						}
+						pos++;
+					}
+					return value;
+				}
+
+				static constexpr bool isDigit(char c)
+				{
+					return c >= '0' && c <= '9';
+				}
+
+			private:
+				const char* pattern;
+				size_t pos;
+				int flags;
+				StaticRegexAutomaton automaton;
+
+			};
+
+
+			constexpr StaticRegexAutomaton compileStaticRegex(const char* pattern, int flags)
+			{
+				return StaticRegexBuilder(pattern, flags).build();
+			}
+
+
+			/*
+			* 编译期正则表达式
+			* Pattern 是带有 static constexpr const char* value 的类型（见 TFC_REGEX_PATTERN），
+			* 模式在编译期解析为 Glushkov 自动机，匹配时没有编译步骤，也不分配内存。
+			* 结果与同一模式的 Regex 相同
+			*/
+			template <class Pattern, int Flags = 0>
+			class StaticRegex
+			{
+			public:
+
+				// 整个输入与模式完全匹配
+				static bool match(const char* data, size_t size)
+				{
+					if (size == 0)
+					{
+						return automaton.nullable;
+					}
+
+					const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+					uint64_t state = automaton.first & automaton.accept[text[0]];
+					for (size_t i = 1; i < size && state; ++i)
+					{
+						state = advance(state) & automaton.accept[text[i]];
+					}
+					return (state & automaton.last) != 0;
+				}
+
+				static bool match(const std::string& text)
+				{
+					return match(text.data(), text.size());
+				}
+
+				// 输入中存在匹配
+				static bool search(const char* data, size_t size)
+				{
+					if (automaton.nullable && !automaton.anchorEnd)
+					{
+						return true;
+					}
+					if (automaton.anchorBegin && automaton.anchorEnd)
+					{
+						return match(data, size);
+					}
+					if (automaton.nullable && size == 0)
+					{
+						return true;
+					}
+
+					const unsigned char* text = reinterpret_cast<const unsigned char*>(data);
+					uint64_t state = 0;
+					for (size_t i = 0; i < size; ++i)
+					{
+						// 非锚定时每个位置都可以重新开始
+						uint64_t restart = automaton.anchorBegin && i > 0 ? 0 : automaton.first;
+						state = (advance(state) | restart) & automaton.accept[text[i]];
+						if (!automaton.anchorEnd && (state & automaton.last))
+						{
+							return true;
+						}
+						if (automaton.anchorBegin && !state)
+						{
+							return false;
+						}
+					}
+					return automaton.nullable || (state & automaton.last) != 0;
+				}
+
+				static bool search(const std::string& text)
+				{
+					return search(text.data(), text.size());
+				}
+
+			private:
+				static inline uint64_t advance(uint64_t state)
+				{
+					uint64_t next = 0;
+					for (int p = 0; p < automaton.positions; ++p)
+					{
+						next |= automaton.follow[p] & (static_cast<uint64_t>(0) - ((state >> p) & 1));
+					}
+					return next;
+				}
+
+			private:
+				static constexpr StaticRegexAutomaton automaton = compileStaticRegex(Pattern::value, Flags);
+
+			};
+
+
+			template <class Pattern, int Flags>
+			constexpr StaticRegexAutomaton StaticRegex<Pattern, Flags>::automaton;
+
+
+		};
+	};
+};
+
+
+#endif // !_TFC_UTIL_REGEX_STATIC_REGEX_H_